@@ -0,0 +1,1894 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <thread>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <set>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <malloc.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "sentence_disambiguation.h"
+#include "tokenizer.h"
+#include "neural_network.h"
+#include "trainer.h"
+#include "trie.h"
+#include "radix_trie.h"
+#include "louds_trie.h"
+#include "frozen_trie.h"
+#include "ngram.h"
+#include "synthetic_corpus.h"
+#include "instrumentation.h"
+#include "prediction_server.h"
+#include "prediction_client.h"
+#include "sharded_trie.h"
+#include "overlay_trie.h"
+#include "update_journal.h"
+
+using namespace std;
+
+/* Benchmark driver, built separately from main.cpp against the same sources by `make benchmark`.
+ * Usage: ./benchmark <name> [arguments]. Each benchmark prints one line of results per configuration. */
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* Returns whether the two taggers hold the same vocabulary, in the same order, with the same counts. */
+static bool same_counts(const PartOfSpeechTagger &a, const PartOfSpeechTagger &b) {
+	if (a.num_words() != b.num_words()) {
+		return false;
+	}
+
+	for (int i = 0; i < a.num_words(); ++i) {
+		if (a.get_word(i) != b.get_word(i) || memcmp(a.get_pos_counts(a.get_word(i)), b.get_pos_counts(b.get_word(i)), POS_LEN * sizeof(int)) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Reads the Brown corpus serially, then in parallel with 1, 2, 4, ... threads, reporting files/sec and tokens/sec and
+ * checking that every run produces the same counts as the serial reader. */
+static void benchmark_brown_corpus(const string path, int max_threads) {
+	vector<string> files;
+	PartOfSpeechTagger::list_brown_corpus_files(path, &files);
+
+	PartOfSpeechTagger serial;
+	auto start = chrono::steady_clock::now();
+	serial.read_brown_corpus(path);
+	double elapsed = seconds_since(start);
+	cout << "brown_corpus serial: " << files.size() / elapsed << " files/sec, " << elapsed << " s" << endl;
+
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		PartOfSpeechTagger parallel;
+		start = chrono::steady_clock::now();
+		long tokens = parallel.read_brown_corpus(path, threads);
+		elapsed = seconds_since(start);
+
+		cout << "brown_corpus threads=" << threads << ": " << files.size() / elapsed << " files/sec, " << tokens / elapsed
+			 << " tokens/sec, " << elapsed << " s" << (same_counts(serial, parallel) ? "" : " (MISMATCH with serial reader)") << endl;
+	}
+}
+
+/* Byte-at-a-time tokenizer, as PartOfSpeechTagger::tokenize was implemented before Tokenizer, kept as a baseline. */
+static vector<string> reference_tokenize(const string &s) {
+	vector<string> ret;
+
+	bool decimal_point_flag = false;
+	int start;
+	for (int i = 0; i < (int) s.length(); ) {
+		if (isalpha(s[i])) {
+			start = i;
+			while (isalpha(s[++i]));
+			ret.push_back(s.substr(start, i - start));
+		} else if (isdigit(s[i]) || s[i] == '-') {
+			if (s[i] == '-' && !isdigit(s[i + 1])) {
+				ret.push_back(s.substr(i++, 1));
+				continue;
+			}
+
+			start = i;
+			while (isdigit(s[++i]) || s[i] == '.') {
+				if (s[i] == '.') {
+					if (decimal_point_flag) {
+						break;
+					}
+					decimal_point_flag = true;
+				}
+			}
+
+			decimal_point_flag = false;
+			ret.push_back(s.substr(start, i - start));
+		} else {
+			ret.push_back(s.substr(i++, 1));
+		}
+	}
+
+	return ret;
+}
+
+/* strtok-based splitting, as used by the corpus readers before Tokenizer, kept as a baseline. */
+static vector<string> reference_split(string s, const char *delims) {
+	vector<string> ret;
+	for (char *token = strtok(&s[0], delims); token != NULL; token = strtok(NULL, delims)) {
+		ret.push_back(token);
+	}
+
+	return ret;
+}
+
+/* Runs f the given number of times over a text of the given size, printing the throughput in GB/s. */
+template <class Function>
+static void report_throughput(const string name, size_t bytes, int iterations, Function f) {
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		f();
+	}
+	double elapsed = seconds_since(start);
+
+	cout << name << ": " << bytes * (double) iterations / elapsed / 1e9 << " GB/s" << endl;
+}
+
+/* Compares Tokenizer against the byte-at-a-time functions it replaced on the contents of the given file. */
+static void benchmark_tokenizer(const string path, int iterations) {
+	ifstream file (path);
+	stringstream contents;
+	contents << file.rdbuf();
+	string text = contents.str();
+	string blank (text.length(), ' ');
+
+	size_t count = 0;
+	vector<string_view> spans;
+	Tokenizer splitter (" \t\n");
+
+	report_throughput("tokenize reference", text.length(), iterations, [&] { count += reference_tokenize(text).size(); });
+	report_throughput("tokenize simd", text.length(), iterations, [&] { spans.clear(); Tokenizer::tokenize(text, &spans); count += spans.size(); });
+	report_throughput("split reference", text.length(), iterations, [&] { count += reference_split(text, " \t\n").size(); });
+	report_throughput("split simd", text.length(), iterations, [&] { spans.clear(); splitter.split(text, &spans); count += spans.size(); });
+	report_throughput("is_whitespace reference", blank.length(), iterations, [&] {
+		bool whitespace = true;
+		for (char c : blank) {
+			whitespace &= isspace(c) != 0;
+		}
+		count += whitespace;
+	});
+	report_throughput("is_whitespace simd", blank.length(), iterations, [&] { count += Tokenizer::is_whitespace(blank); });
+
+	cerr << "(" << count << " tokens)" << endl; // Keeps the work above observable
+}
+
+/* Streams the given text file through the sentence splitter in 1 MB blocks, as corpus ingestion would, and reports MB/s
+ * with punctuation rules only and, given a Brown corpus to train the tagger on, with neural net scoring. The net is
+ * untrained, so only its speed is meaningful. */
+static void benchmark_sentences(const string path, const string brown_path) {
+	const size_t block_size = 1 << 20;
+
+	ifstream file (path);
+	stringstream contents;
+	contents << file.rdbuf();
+	string text = contents.str();
+
+	auto split = [&](const string name, function<size_t(string_view, bool, vector<string_view> *)> get_sentences) {
+		vector<string_view> sentences;
+		size_t num_sentences = 0;
+		string block;
+
+		auto start = chrono::steady_clock::now();
+		for (size_t pos = 0; pos < text.length(); pos += block_size) {
+			block.append(text, pos, block_size);
+			bool final = pos + block_size >= text.length();
+
+			sentences.clear();
+			size_t used = get_sentences(block, final, &sentences);
+			num_sentences += sentences.size();
+			block.erase(0, used);
+		}
+		double elapsed = seconds_since(start);
+
+		cout << "sentences " << name << ": " << text.length() / elapsed / 1e6 << " MB/s, " << num_sentences << " sentences" << endl;
+	};
+
+	split("rules", [](string_view block, bool final, vector<string_view> *ret) { return Sentence::get_sentences(block, final, ret); });
+
+	if (!brown_path.empty()) {
+		PartOfSpeechTagger tagger;
+		tagger.read_brown_corpus(brown_path, thread::hardware_concurrency());
+
+		int layer_counts[] = {Sentence::input_size, 10, 1};
+		NeuralNetwork net (layer_counts, 3);
+		split("net", [&](string_view block, bool final, vector<string_view> *ret) { return Sentence::get_sentences(block, final, tagger, net, ret); });
+	}
+}
+
+/* Compares samples/sec of per-sample feedforward against feedforward_batch, and of training with per-sample against
+ * minibatch updates, for the sentence boundary topology and a larger one. */
+static void benchmark_network(int num_samples) {
+	vector<vector<int>> topologies = {{Sentence::input_size, 10, 1}, {256, 256, 64}};
+
+	for (vector<int> &topology : topologies) {
+		NeuralNetwork net (topology.data(), topology.size());
+		int inputs = topology.front(), outputs = topology.back();
+
+		vector<pair<ARRAY, ARRAY>> samples (num_samples);
+		AlignedArray batch_inputs ((size_t) num_samples * inputs), batch_outputs ((size_t) num_samples * outputs);
+		for (int i = 0; i < num_samples; ++i) {
+			samples[i].first.resize(inputs);
+			samples[i].second.assign(outputs, 0.5);
+			for (int j = 0; j < inputs; ++j) {
+				samples[i].first[j] = batch_inputs[(size_t) i * inputs + j] = (double) rand() / RAND_MAX;
+			}
+		}
+
+		string name = "network ";
+		for (size_t l = 0; l < topology.size(); ++l) {
+			name += (l ? "-" : "") + to_string(topology[l]);
+		}
+
+		double checksum = 0.0;
+		auto start = chrono::steady_clock::now();
+		for (const pair<ARRAY, ARRAY> &sample : samples) {
+			checksum += net.feedforward(sample.first)[0];
+		}
+		cout << name << " feedforward: " << num_samples / seconds_since(start) << " samples/sec" << endl;
+
+		for (int batch_size : {16, 256}) {
+			start = chrono::steady_clock::now();
+			for (int i = 0; i < num_samples; i += batch_size) {
+				int size = min(batch_size, num_samples - i);
+				net.feedforward_batch(&batch_inputs[(size_t) i * inputs], size, &batch_outputs[(size_t) i * outputs]);
+			}
+			checksum += batch_outputs[0];
+			cout << name << " feedforward_batch " << batch_size << ": " << num_samples / seconds_since(start) << " samples/sec" << endl;
+		}
+
+		for (int batch_size : {1, 32}) {
+			start = chrono::steady_clock::now();
+			net.train(samples, 1, batch_size);
+			cout << name << " train batch " << batch_size << ": " << num_samples / seconds_since(start) << " samples/sec" << endl;
+		}
+
+		cerr << "(" << checksum << ")" << endl;
+	}
+}
+
+/* Reports epochs/sec of Trainer for 1, 2, 4, ... threads on the sine-fit samples of main.cpp and, given a Brown corpus,
+ * on sentence boundary samples, along with the loss reached. */
+static void benchmark_training(const string brown_path, int max_threads, int epochs) {
+	vector<pair<string, vector<pair<ARRAY, ARRAY>>>> datasets;
+
+	vector<pair<ARRAY, ARRAY>> sine (10000);
+	for (pair<ARRAY, ARRAY> &sample : sine) {
+		double x = (double) rand() / RAND_MAX;
+		sample = make_pair(ARRAY(1, x), ARRAY(1, sin(x)));
+	}
+	datasets.push_back(make_pair("sine", sine));
+
+	if (!brown_path.empty()) {
+		PartOfSpeechTagger tagger;
+		tagger.read_brown_corpus(brown_path, thread::hardware_concurrency());
+
+		vector<pair<ARRAY, ARRAY>> boundaries;
+		Sentence::training_samples(brown_path, tagger, &boundaries);
+		if (boundaries.empty()) {
+			throw runtime_error("No sentence boundary candidates in " + brown_path);
+		}
+		datasets.push_back(make_pair("sentence_boundary", boundaries));
+	}
+
+	for (const auto &dataset : datasets) {
+		int inputs = dataset.second[0].first.size();
+		for (int threads = 1; threads <= max_threads; threads *= 2) {
+			srand(1);
+			int layer_counts[] = {inputs, inputs == 1 ? 3 : 10, 1};
+			NeuralNetwork net (layer_counts, 3);
+			Adam optimizer (0.01);
+			Trainer trainer (net, optimizer, 256, threads);
+
+			auto start = chrono::steady_clock::now();
+			double loss = trainer.train(dataset.second, epochs);
+			double elapsed = seconds_since(start);
+
+			cout << "training " << dataset.first << " threads=" << threads << ": " << epochs / elapsed << " epochs/sec, loss "
+				 << loss << " (" << dataset.second.size() << " samples)" << endl;
+		}
+	}
+}
+
+/* Compares the sentence boundary net in double precision against its float32 and int8 frozen copies: nanoseconds per
+ * candidate, largest output difference, how often the three-way decision differs from the double net's, and accuracy on
+ * the labels. Candidates come from a Brown corpus if given, and are otherwise random descriptor rows labelled by a fixed
+ * rule. */
+static void benchmark_inference(const string brown_path) {
+	vector<pair<ARRAY, ARRAY>> samples;
+	if (!brown_path.empty()) {
+		PartOfSpeechTagger tagger;
+		tagger.read_brown_corpus(brown_path, thread::hardware_concurrency());
+		Sentence::training_samples(brown_path, tagger, &samples);
+	} else {
+		samples.resize(20000);
+		for (pair<ARRAY, ARRAY> &sample : samples) {
+			sample.first.resize(Sentence::input_size);
+			for (double &x : sample.first) {
+				x = (double) rand() / RAND_MAX;
+			}
+			sample.second = ARRAY(1, sample.first[0] + sample.first[POS_LEN] > sample.first[2 * POS_LEN] + 0.5 ? 1.0 : 0.0);
+		}
+	}
+	if (samples.empty()) {
+		throw runtime_error("No sentence boundary candidates in " + brown_path);
+	}
+
+	NeuralNetwork net = Sentence::train_net(samples, 20);
+	size_t n = samples.size();
+
+	/* Reference outputs and decisions of the double precision net, one candidate per call as when serving. */
+	vector<double> reference (n);
+	auto start = chrono::steady_clock::now();
+	for (size_t i = 0; i < n; ++i) {
+		net.feedforward_batch(samples[i].first.data(), 1, &reference[i]);
+	}
+	double elapsed = seconds_since(start);
+
+	auto decide = [](double output) { return output > 0.7 ? 1 : (output < 0.2 ? -1 : 0); };
+	auto accuracy = [&](function<int(size_t)> decision) {
+		size_t correct = 0;
+		for (size_t i = 0; i < n; ++i) {
+			correct += (decision(i) >= 0) == (samples[i].second[0] > 0.5);
+		}
+		return (double) correct / n;
+	};
+
+	cout << "inference double: " << elapsed / n * 1e9 << " ns/candidate, accuracy "
+		 << accuracy([&](size_t i) { return decide(reference[i]); }) << " (" << n << " candidates)" << endl;
+
+	InferenceNetwork::Precision precisions[] = {InferenceNetwork::FLOAT32, InferenceNetwork::INT8};
+	for (InferenceNetwork::Precision precision : precisions) {
+		InferenceNetwork frozen = Sentence::freeze_net(net, precision);
+		string name = precision == InferenceNetwork::FLOAT32 ? "float32" : "int8";
+
+		vector<int> decisions (n);
+		start = chrono::steady_clock::now();
+		for (size_t i = 0; i < n; ++i) {
+			decisions[i] = frozen.classify(samples[i].first.data());
+		}
+		elapsed = seconds_since(start);
+
+		double largest_difference = 0.0, output;
+		size_t disagreements = 0;
+		for (size_t i = 0; i < n; ++i) {
+			frozen.feedforward(samples[i].first.data(), &output);
+			largest_difference = max(largest_difference, abs(output - reference[i]));
+			disagreements += decisions[i] != decide(reference[i]);
+		}
+
+		cout << "inference " << name << ": " << elapsed / n * 1e9 << " ns/candidate, max output difference "
+			 << largest_difference << ", " << disagreements << " decisions changed, accuracy "
+			 << accuracy([&](size_t i) { return decisions[i]; }) << ", " << frozen.memory_size() << " bytes" << endl;
+	}
+}
+
+/* Compares the startup cost of building the part-of-speech tagger from a Brown corpus with loading it from a model file,
+ * and reports the load time of a model of the sentence boundary net. */
+static void benchmark_models(const string brown_path) {
+	string tagger_path = "benchmark_tagger.model", network_path = "benchmark_network.model";
+
+	PartOfSpeechTagger tagger;
+	auto start = chrono::steady_clock::now();
+	tagger.read_brown_corpus(brown_path, thread::hardware_concurrency());
+	double read_time = seconds_since(start);
+
+	tagger.save(tagger_path);
+	PartOfSpeechTagger loaded;
+	start = chrono::steady_clock::now();
+	loaded.load(tagger_path);
+	double load_time = seconds_since(start);
+
+	cout << "models tagger: corpus " << read_time << "s, model file " << load_time << "s (" << tagger.num_words()
+		 << " words)" << (same_counts(tagger, loaded) ? "" : ", MISMATCH") << endl;
+
+	int layer_counts[] = {Sentence::input_size, 10, 1};
+	NeuralNetwork net (layer_counts, 3), net_loaded (layer_counts, 3);
+	net.save(network_path);
+	start = chrono::steady_clock::now();
+	net_loaded.load(network_path);
+	load_time = seconds_since(start);
+
+	bool same = memcmp(net.get_parameters(), net_loaded.get_parameters(), net.num_parameters() * sizeof(double)) == 0;
+	cout << "models network: model file " << load_time << "s (" << net.num_parameters() << " parameters)"
+		 << (same ? "" : ", MISMATCH") << endl;
+
+	remove(tagger_path.c_str());
+	remove(network_path.c_str());
+}
+
+/* Counts the nodes of a character-per-node trie and estimates its heap footprint: each node is its own allocation, plus
+ * whatever its children container allocates, a std::map entry per child for the default alphabet. */
+template <class NodeType>
+static void trie_footprint(const NodeType &root, size_t *nodes, size_t *bytes) {
+	const size_t allocation_overhead = 16;
+	vector<const NodeType *> stack (1, &root);
+	*nodes = 0;
+	*bytes = 0;
+	while (!stack.empty()) {
+		const NodeType *n = stack.back();
+		stack.pop_back();
+
+		++*nodes;
+		*bytes += sizeof(NodeType) + allocation_overhead + n->heap_bytes();
+		n->for_each_child([&](char, NodeType *child) { stack.push_back(child); });
+	}
+}
+
+/* Returns the words of a dictionary file in the format of Trie::insert_from_file, with weights. */
+static vector<string> dictionary_words(const string dictionary_path) {
+	vector<string> words;
+	ifstream dictionary (dictionary_path);
+	string line;
+	getline(dictionary, line);
+	while (getline(dictionary, line)) {
+		string_view word = Tokenizer().first_token(line);
+		if (!word.empty()) {
+			words.push_back(string(word));
+		}
+	}
+	if (words.empty()) {
+		throw runtime_error("No words in " + dictionary_path);
+	}
+
+	return words;
+}
+
+/* Compares Trie with RadixTrie on a dictionary file in the format of Trie::insert_from_file, with weights: build time,
+ * node count, memory, and mean autocomplete and autocorrect latency over queries drawn from the dictionary. Autocomplete
+ * and autocorrect results are checked to be the same words in the same order. */
+static void benchmark_tries(const string dictionary_path, int num_queries) {
+	auto start = chrono::steady_clock::now();
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+	double trie_build = seconds_since(start);
+
+	start = chrono::steady_clock::now();
+	RadixTrie radix;
+	radix.insert_from_file(dictionary_path, true);
+	double radix_build = seconds_since(start);
+
+	vector<string> words = dictionary_words(dictionary_path);
+
+	/* Queries: prefixes of up to two characters for autocomplete, and words with one character substituted for
+	 * autocorrect. */
+	vector<string> prefixes, typos;
+	mt19937 generator (1);
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = words[generator() % words.size()];
+		prefixes.push_back(word.substr(0, min((size_t) 2, word.length())));
+
+		string typo = word;
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	size_t trie_nodes, trie_bytes;
+	trie_footprint(trie.root, &trie_nodes, &trie_bytes);
+	RadixTrie::Stats stats = radix.stats();
+
+	size_t checksum = 0, mismatches = 0;
+	vector<vector<string>> trie_completions;
+	start = chrono::steady_clock::now();
+	for (const string &prefix : prefixes) {
+		trie_completions.push_back(trie.autocomplete(prefix, 10));
+	}
+	double trie_complete = seconds_since(start) / num_queries;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		vector<string> completions = radix.autocomplete(prefixes[i], 10);
+		checksum += completions.size();
+		mismatches += completions != trie_completions[i];
+	}
+	double radix_complete = seconds_since(start) / num_queries;
+
+	vector<vector<string>> trie_corrections;
+	start = chrono::steady_clock::now();
+	for (const string &typo : typos) {
+		trie_corrections.push_back(trie.autocorrect(typo, 2));
+	}
+	double trie_correct = seconds_since(start) / num_queries;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		mismatches += radix.autocorrect(typos[i], 2) != trie_corrections[i];
+	}
+	double radix_correct = seconds_since(start) / num_queries;
+
+	cout << "tries trie: " << words.size() << " words, " << trie_nodes << " nodes, ~" << trie_bytes << " bytes, build "
+		 << trie_build << "s, autocomplete " << trie_complete * 1e6 << " us, autocorrect " << trie_correct * 1e6 << " us" << endl;
+	cout << "tries radix: " << stats.words << " words, " << stats.nodes << " nodes, " << stats.memory_bytes << " bytes, build "
+		 << radix_build << "s, autocomplete " << radix_complete * 1e6 << " us, autocorrect " << radix_correct * 1e6 << " us ("
+		 << mismatches << " mismatches, checksum " << checksum << ")" << endl;
+}
+
+/* Compares the LOUDS encoding of a dictionary with the Trie it is built from and with a RadixTrie: bits per node, memory,
+ * and mean latency of get_weight over every word, and of autocomplete and autocorrect over queries drawn from the
+ * dictionary. Every word is checked to keep its weight, and autocomplete and autocorrect results to be the same words in
+ * the same order. */
+static void benchmark_louds(const string dictionary_path, int num_queries) {
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+	RadixTrie radix;
+	radix.insert_from_file(dictionary_path, true);
+
+	auto start = chrono::steady_clock::now();
+	LoudsTrie louds (trie);
+	double louds_build = seconds_since(start);
+
+	vector<string> words = dictionary_words(dictionary_path);
+	vector<string> prefixes, typos;
+	mt19937 generator (1);
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = words[generator() % words.size()];
+		prefixes.push_back(word.substr(0, min((size_t) 2, word.length())));
+
+		string typo = word;
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	size_t trie_nodes, trie_bytes;
+	trie_footprint(trie.root, &trie_nodes, &trie_bytes);
+	RadixTrie::Stats stats = radix.stats();
+
+	/* Lookups over every word, in a shuffled order so that consecutive lookups don't share a path. */
+	vector<string> lookups = words;
+	shuffle(lookups.begin(), lookups.end(), generator);
+
+	size_t mismatches = 0;
+	double sum = 0;
+	start = chrono::steady_clock::now();
+	for (const string &word : lookups) {
+		sum += trie.get_weight(word);
+	}
+	double trie_lookup = seconds_since(start) / lookups.size();
+
+	start = chrono::steady_clock::now();
+	for (const string &word : lookups) {
+		sum += radix.get_weight(word);
+	}
+	double radix_lookup = seconds_since(start) / lookups.size();
+
+	start = chrono::steady_clock::now();
+	for (const string &word : lookups) {
+		sum += louds.get_weight(word);
+	}
+	double louds_lookup = seconds_since(start) / lookups.size();
+
+	for (const string &word : words) {
+		mismatches += !louds.contains(word) || louds.get_weight(word) != trie.get_weight(word);
+	}
+
+	vector<vector<string>> radix_completions;
+	start = chrono::steady_clock::now();
+	for (const string &prefix : prefixes) {
+		radix_completions.push_back(radix.autocomplete(prefix, 10));
+	}
+	double radix_complete = seconds_since(start) / num_queries;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		vector<string> completions = louds.autocomplete(prefixes[i], 10);
+		sum += completions.size();
+		mismatches += completions != radix_completions[i];
+	}
+	double louds_complete = seconds_since(start) / num_queries;
+
+	vector<vector<string>> radix_corrections;
+	start = chrono::steady_clock::now();
+	for (const string &typo : typos) {
+		radix_corrections.push_back(radix.autocorrect(typo, 2));
+	}
+	double radix_correct = seconds_since(start) / num_queries;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		mismatches += louds.autocorrect(typos[i], 2) != radix_corrections[i];
+	}
+	double louds_correct = seconds_since(start) / num_queries;
+
+	cout << "louds trie: " << trie_nodes << " nodes, ~" << trie_bytes << " bytes (" << trie_bytes * 8.0 / trie_nodes
+		 << " bits/node), get_weight " << trie_lookup * 1e9 << " ns" << endl;
+	cout << "louds radix: " << stats.nodes << " nodes, " << stats.memory_bytes << " bytes (" << stats.memory_bytes * 8.0 / trie_nodes
+		 << " bits/trie node), get_weight " << radix_lookup * 1e9 << " ns, autocomplete " << radix_complete * 1e6
+		 << " us, autocorrect " << radix_correct * 1e6 << " us" << endl;
+	cout << "louds louds: " << louds.num_nodes() << " nodes, " << louds.memory_bytes() << " bytes (" << louds.memory_bytes() * 8.0 / louds.num_nodes()
+		 << " bits/node), build " << louds_build << "s, get_weight " << louds_lookup * 1e9 << " ns, autocomplete " << louds_complete * 1e6
+		 << " us, autocorrect " << louds_correct * 1e6 << " us (" << mismatches << " mismatches, checksum " << sum << ")" << endl;
+}
+
+/* Opens a counter of last-level cache misses in user space for the calling thread, returning its descriptor, or -1 where
+ * perf events are unavailable (e.g. in a virtual machine, or with a restrictive kernel.perf_event_paranoid). */
+static int open_cache_miss_counter(void) {
+	perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = PERF_TYPE_HARDWARE;
+	attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+	attributes.disabled = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+/* Runs f once, returning its duration in seconds and storing in *misses the cache misses it incurred, or -1 if counter is
+ * -1. */
+static double measure(int counter, const function<void (void)> &f, long long *misses) {
+	if (counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	auto start = chrono::steady_clock::now();
+	f();
+	double ret = seconds_since(start);
+
+	*misses = -1;
+	if (counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(counter, misses, sizeof(*misses)) != sizeof(*misses)) {
+			*misses = -1;
+		}
+	}
+
+	return ret;
+}
+
+/* Compares autocomplete and autocorrect on a Trie with FrozenTrie copies of it in different layouts: breadth first
+ * throughout, depth first throughout, three breadth-first levels over depth-first subtrees, and the same guided by a query
+ * log. Reports mean latency and cache misses per query. Queries are words drawn in proportion to their weights, as typed
+ * text would be, truncated to two characters for autocomplete and with one character substituted for autocorrect; the
+ * log is read from a file of one query per line if given, and is otherwise a separate draw from the same distribution.
+ * All layouts are checked to give the same results as Trie, in the same order. Note that Trie::autocomplete also differs
+ * in algorithm, carrying each entry's word in its queue. */
+static void benchmark_frozen(const string dictionary_path, int num_queries, const string log_path) {
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+
+	vector<string> words = dictionary_words(dictionary_path);
+	vector<double> weights;
+	for (const string &word : words) {
+		weights.push_back(max(trie.get_weight(word), 0.0) + 1);
+	}
+	discrete_distribution<size_t> typed (weights.begin(), weights.end());
+
+	vector<string> prefixes, typos, query_log;
+	mt19937 generator (1);
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = words[typed(generator)];
+		prefixes.push_back(word.substr(0, min((size_t) 2, word.length())));
+
+		string typo = word;
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	if (!log_path.empty()) {
+		ifstream log (log_path);
+		string line;
+		while (getline(log, line)) {
+			query_log.push_back(line);
+		}
+	} else {
+		mt19937 log_generator (2);
+		for (int i = 0; i < 10 * num_queries; ++i) {
+			query_log.push_back(words[typed(log_generator)]);
+		}
+	}
+
+	int counter = open_cache_miss_counter();
+	if (counter < 0) {
+		cout << "frozen: cache miss counter unavailable (" << strerror(errno) << "), reporting latency only" << endl;
+	}
+
+	vector<vector<string>> expected_completions (num_queries), expected_corrections (num_queries);
+	long long complete_misses, correct_misses;
+	size_t checksum = 0, mismatches = 0;
+	double complete = measure(counter, [&]() {
+		for (int i = 0; i < num_queries; ++i) {
+			expected_completions[i] = trie.autocomplete(prefixes[i], 10);
+			checksum += expected_completions[i].size();
+		}
+	}, &complete_misses);
+	double correct = measure(counter, [&]() {
+		for (int i = 0; i < num_queries; ++i) {
+			expected_corrections[i] = trie.autocorrect(typos[i], 2);
+		}
+	}, &correct_misses);
+
+	auto report = [&](const string name, size_t bytes) {
+		cout << "frozen " << name << ": " << bytes << " bytes, autocomplete " << complete / num_queries * 1e6 << " us";
+		if (counter >= 0) {
+			cout << " (" << (double) complete_misses / num_queries << " misses)";
+		}
+		cout << ", autocorrect " << correct / num_queries * 1e6 << " us";
+		if (counter >= 0) {
+			cout << " (" << (double) correct_misses / num_queries << " misses)";
+		}
+		cout << endl;
+	};
+	size_t trie_nodes, trie_bytes;
+	trie_footprint(trie.root, &trie_nodes, &trie_bytes);
+	report("trie", trie_bytes);
+
+	vector<tuple<string, int, bool>> layouts = {make_tuple("bfs", numeric_limits<int>::max(), false), make_tuple("dfs", 0, false),
+		make_tuple("hybrid", 3, false), make_tuple("guided", 3, true)};
+	for (const auto &layout : layouts) {
+		FrozenTrie frozen (trie, get<1>(layout), get<2>(layout) ? query_log : vector<string>());
+
+		vector<vector<string>> completions (num_queries), corrections (num_queries);
+		complete = measure(counter, [&]() {
+			for (int i = 0; i < num_queries; ++i) {
+				completions[i] = frozen.autocomplete(prefixes[i], 10);
+			}
+		}, &complete_misses);
+		correct = measure(counter, [&]() {
+			for (int i = 0; i < num_queries; ++i) {
+				corrections[i] = frozen.autocorrect(typos[i], 2);
+			}
+		}, &correct_misses);
+
+		for (int i = 0; i < num_queries; ++i) {
+			mismatches += completions[i] != expected_completions[i];
+			mismatches += corrections[i] != expected_corrections[i];
+		}
+
+		report(get<0>(layout), frozen.memory_bytes());
+	}
+
+	if (counter >= 0) {
+		close(counter);
+	}
+	cout << "frozen: " << mismatches << " mismatches, checksum " << checksum << endl;
+}
+
+/* Compares the two autocorrect engines of Trie, the trie walk and the deletion index, by word length and distance:
+ * mean latency of each, and whether they return the same suggestions. Queries are dictionary words with as many
+ * characters substituted as the distance. Also reports the index's build time and memory. */
+static void benchmark_deletion_index(const string dictionary_path, int num_queries) {
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+	vector<string> words = dictionary_words(dictionary_path);
+
+	auto start = chrono::steady_clock::now();
+	trie.build_deletion_index(2);
+	cout << "deletion index: built in " << seconds_since(start) << "s" << endl;
+
+	mt19937 generator (1);
+	vector<pair<int, int>> buckets = {{1, 4}, {5, 6}, {7, 8}, {9, 10}, {11, 14}, {15, 64}};
+	for (int distance = 1; distance <= 2; ++distance) {
+		for (const pair<int, int> &bucket : buckets) {
+			vector<string> bucket_words;
+			for (const string &word : words) {
+				if ((int) word.length() >= bucket.first && (int) word.length() <= bucket.second) {
+					bucket_words.push_back(word);
+				}
+			}
+			if (bucket_words.empty()) {
+				continue;
+			}
+
+			vector<string> typos;
+			for (int i = 0; i < num_queries; ++i) {
+				string typo = bucket_words[generator() % bucket_words.size()];
+				for (int j = 0; j < distance; ++j) {
+					typo[generator() % typo.length()] = 'a' + generator() % 26;
+				}
+				typos.push_back(typo);
+			}
+
+			vector<vector<string>> walked;
+			start = chrono::steady_clock::now();
+			for (const string &typo : typos) {
+				walked.push_back(trie.autocorrect(typo, distance, TRIE_WALK));
+			}
+			double walk = seconds_since(start) / num_queries;
+
+			size_t mismatches = 0;
+			start = chrono::steady_clock::now();
+			for (int i = 0; i < num_queries; ++i) {
+				mismatches += trie.autocorrect(typos[i], distance, DELETION_INDEX) != walked[i];
+			}
+			double index = seconds_since(start) / num_queries;
+
+			cout << "deletion distance " << distance << ", length " << bucket.first << "-" << bucket.second << ": trie walk "
+				 << walk * 1e6 << " us, deletion index " << index * 1e6 << " us (" << mismatches << " mismatches)" << endl;
+		}
+	}
+}
+
+/* Node::get_weight as it was before it became exception-free, kept as a baseline: a word whose last character is missing
+ * made get_child throw. */
+static double throwing_get_weight(const Node *n, const string word) {
+	if (word.length() == 1) {
+		return n->get_child(word[0])->get_weight();
+	}
+
+	return n->contains_key(word[0]) ? throwing_get_weight(n->get_child(word[0]), word.substr(1)) : -1;
+}
+
+/* Measures Trie::get_weight on the tokens of a text, separately for tokens in the dictionary and not: with the old
+ * throwing lookup, with the exception-free one, and with the membership filter in front. Without a text file, generates a
+ * typo-heavy one: 60% dictionary words drawn by weight, 30% of them with one character substituted, 10% capitalized
+ * names. */
+static void benchmark_filter(const string dictionary_path, const string text_path) {
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+
+	vector<string> tokens;
+	if (!text_path.empty()) {
+		ifstream text (text_path);
+		string line;
+		vector<string_view> line_tokens;
+		Tokenizer tokenizer;
+		while (getline(text, line)) {
+			line_tokens.clear();
+			tokenizer.split(line, &line_tokens);
+			for (string_view token : line_tokens) {
+				tokens.push_back(string(token));
+			}
+		}
+	} else {
+		vector<string> words = dictionary_words(dictionary_path);
+		vector<double> weights;
+		for (const string &word : words) {
+			weights.push_back(max(trie.get_weight(word), 0.0) + 1);
+		}
+		discrete_distribution<size_t> typed (weights.begin(), weights.end());
+
+		mt19937 generator (1);
+		for (int i = 0; i < 200000; ++i) {
+			int kind = generator() % 10;
+			string token = words[typed(generator)];
+			if (kind >= 6 && kind < 9) {
+				token[generator() % token.length()] = 'a' + generator() % 26;
+			} else if (kind == 9) {
+				token = string(1, 'A' + generator() % 26);
+				for (int j = generator() % 8 + 2; j > 0; --j) {
+					token.push_back('a' + generator() % 26);
+				}
+			}
+			tokens.push_back(token);
+		}
+	}
+
+	vector<string> hits, misses;
+	for (const string &token : tokens) {
+		(trie.contains(token) ? hits : misses).push_back(token);
+	}
+	if (tokens.empty()) {
+		throw runtime_error("No tokens to look up");
+	}
+
+	auto time_lookups = [](const vector<string> &lookups, const function<double (const string &)> &lookup, double *checksum) {
+		auto start = chrono::steady_clock::now();
+		for (const string &word : lookups) {
+			*checksum += lookup(word);
+		}
+		return lookups.empty() ? 0 : seconds_since(start) / lookups.size() * 1e9;
+	};
+
+	double checksum = 0;
+	auto throwing = [&](const string &word) {
+		try {
+			return throwing_get_weight(&trie.root, word);
+		} catch (const runtime_error &e) {
+			return -1.0;
+		}
+	};
+	auto plain = [&](const string &word) { return trie.get_weight(word); };
+
+	double throwing_hit = time_lookups(hits, throwing, &checksum), throwing_miss = time_lookups(misses, throwing, &checksum);
+	double plain_hit = time_lookups(hits, plain, &checksum), plain_miss = time_lookups(misses, plain, &checksum);
+
+	auto start = chrono::steady_clock::now();
+	trie.build_membership_filter(0.01);
+	double build = seconds_since(start);
+	double filtered_hit = time_lookups(hits, plain, &checksum), filtered_miss = time_lookups(misses, plain, &checksum);
+
+	size_t mismatches = 0;
+	for (const string &word : misses) {
+		mismatches += trie.contains(word);
+	}
+	for (const string &word : hits) {
+		mismatches += !trie.contains(word);
+	}
+
+	cout << "filter: " << tokens.size() << " tokens, " << misses.size() * 100.0 / tokens.size() << "% misses, filter built in "
+		 << build << "s" << endl;
+	cout << "filter throwing: hit " << throwing_hit << " ns, miss " << throwing_miss << " ns" << endl;
+	cout << "filter exception-free: hit " << plain_hit << " ns, miss " << plain_miss << " ns" << endl;
+	cout << "filter filtered: hit " << filtered_hit << " ns, miss " << filtered_miss << " ns (" << mismatches << " mismatches, checksum "
+		 << checksum << ")" << endl;
+}
+
+/* Writes one JSON line summarizing the given samples of a benchmark, in the given unit: their count, mean, percentiles
+ * (nearest rank) and maximum. */
+static void report_samples(ostream &out, const string name, vector<double> samples, const string unit) {
+	if (samples.empty()) {
+		return;
+	}
+
+	sort(samples.begin(), samples.end());
+	auto percentile = [&](double p) { return samples[max((size_t) ceil(p / 100 * samples.size()), (size_t) 1) - 1]; };
+	double mean = 0;
+	for (double sample : samples) {
+		mean += sample / samples.size();
+	}
+
+	out << "{\"benchmark\":\"" << name << "\",\"unit\":\"" << unit << "\",\"samples\":" << samples.size() << ",\"mean\":" << mean
+		<< ",\"p50\":" << percentile(50) << ",\"p90\":" << percentile(90) << ",\"p99\":" << percentile(99) << ",\"p999\":"
+		<< percentile(99.9) << ",\"max\":" << samples.back() << "}" << endl;
+}
+
+/* Runs f on each of the given inputs, timing every call separately, and reports the latencies in the given unit ("ns",
+ * "us" or "ms"). Each sample includes the cost of reading the clock, about 20 ns. */
+template <typename Input, typename Function>
+static void time_each(ostream &out, const string name, const vector<Input> &inputs, const string unit, Function f) {
+	double scale = unit == "ns" ? 1e9 : unit == "us" ? 1e6 : 1e3;
+	vector<double> samples;
+	for (const Input &input : inputs) {
+		auto start = chrono::steady_clock::now();
+		f(input);
+		samples.push_back(seconds_since(start) * scale);
+	}
+
+	report_samples(out, name, samples, unit);
+}
+
+/* Runs reproducible benchmarks of every hot path on synthetic data, writing one JSON line per benchmark (to the given
+ * file, or standard output) so that runs on different versions can be compared. The first line describes the run. The
+ * dictionary, text and Brown corpus come from SyntheticCorpus with a fixed seed, in a temporary directory removed
+ * afterwards, and scale multiplies their sizes. Benchmarks:
+ *     trie.insert_from_file              ms per build of a Trie from the dictionary
+ *     trie.contains.hit, .miss           ns per lookup of dictionary words, and of typos of them not in it
+ *     trie.autocomplete.short, .long     us per top-10 query, for prefixes of 1-2 characters, and all but the last one
+ *     trie.autocorrect.d1, .d2, .d3      us per trie walk, for words with as many edits as the distance
+ *     trie.autocorrect_index.d1, .d2     the same through the deletion index
+ *     trie.insert_from_raw_text          ms per pass over the text, into a fresh Trie
+ *     ngram.initialize                   ms per trigram model built from the text
+ *     ngram.probability                  ns per trigram probability from the text's distribution
+ *     pos.read_brown_corpus, .threads4   ms per read of the corpus, serially and with 4 threads
+ *     network.feedforward                ns per sample, through the sentence boundary topology
+ *     network.train                      ms per epoch over 1000 samples, in minibatches of 32 */
+static void benchmark_suite(double scale, const string output_path) {
+	const uint64_t seed = 1;
+	ofstream output_file;
+	if (!output_path.empty()) {
+		output_file.open(output_path);
+	}
+	ostream &out = output_path.empty() ? cout : output_file;
+
+	char directory_template[] = "/tmp/predictive-text-benchmark-XXXXXX";
+	if (mkdtemp(directory_template) == NULL) {
+		throw runtime_error("Unable to create a temporary directory");
+	}
+	string directory = directory_template, dictionary_path = directory + "/dictionary.txt", text_path = directory + "/text.txt",
+		brown_path = directory + "/brown";
+
+	int vocabulary = max((int) (20000 * scale), 100), num_sentences = max((int) (5000 * scale), 10);
+	SyntheticCorpus corpus (vocabulary, seed);
+	corpus.write_dictionary(dictionary_path);
+	corpus.write_text(text_path, num_sentences);
+	corpus.write_brown_corpus(brown_path, 20, max(num_sentences / 20, 1));
+	srand(seed);
+
+	out << "{\"suite\":\"predictive-text\",\"format\":1,\"seed\":" << seed << ",\"scale\":" << scale << ",\"vocabulary\":"
+		<< vocabulary << ",\"sentences\":" << num_sentences << ",\"compiler\":\"" << __VERSION__ << "\"}" << endl;
+
+	/* Tries. */
+	vector<int> repetitions (5);
+	time_each(out, "trie.insert_from_file", repetitions, "ms", [&](int) {
+		Trie trie;
+		trie.insert_from_file(dictionary_path, true);
+	});
+
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+
+	const int num_queries = 2000;
+	vector<string> hits, misses, short_prefixes, long_prefixes;
+	vector<vector<string>> typos (4);
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = corpus.get_word(corpus.sample_word());
+		hits.push_back(word);
+		short_prefixes.push_back(word.substr(0, 1 + i % 2));
+		long_prefixes.push_back(word.substr(0, max(word.length(), (size_t) 2) - 1));
+		for (int d = 1; d <= 3; ++d) {
+			typos[d].push_back(corpus.typo(word, d));
+		}
+	}
+	while ((int) misses.size() < num_queries) {
+		string typo = corpus.typo(corpus.get_word(corpus.sample_word()), 1);
+		if (!trie.contains(typo)) {
+			misses.push_back(typo);
+		}
+	}
+
+	double checksum = 0;
+	time_each(out, "trie.contains.hit", hits, "ns", [&](const string &word) { checksum += trie.contains(word); });
+	time_each(out, "trie.contains.miss", misses, "ns", [&](const string &word) { checksum += trie.contains(word); });
+	time_each(out, "trie.autocomplete.short", short_prefixes, "us", [&](const string &prefix) {
+		checksum += trie.autocomplete(prefix, 10).size();
+	});
+	time_each(out, "trie.autocomplete.long", long_prefixes, "us", [&](const string &prefix) {
+		checksum += trie.autocomplete(prefix, 10).size();
+	});
+	for (int d = 1; d <= 3; ++d) {
+		vector<string> queries (typos[d].begin(), typos[d].begin() + (d == 3 ? num_queries / 10 : num_queries));
+		time_each(out, "trie.autocorrect.d" + to_string(d), queries, "us", [&](const string &typo) {
+			checksum += trie.autocorrect(typo, d, TRIE_WALK).size();
+		});
+	}
+
+	trie.build_deletion_index(2);
+	for (int d = 1; d <= 2; ++d) {
+		time_each(out, "trie.autocorrect_index.d" + to_string(d), typos[d], "us", [&](const string &typo) {
+			checksum += trie.autocorrect(typo, d, DELETION_INDEX).size();
+		});
+	}
+
+	time_each(out, "trie.insert_from_raw_text", vector<int>(3), "ms", [&](int) {
+		Trie raw;
+		raw.insert_from_raw_text(text_path);
+	});
+
+	/* N-gram model. */
+	time_each(out, "ngram.initialize", vector<int>(3), "ms", [&](int) {
+		NgramModel model (3);
+		model.initialize(vector<string>(1, text_path));
+	});
+
+	NgramModel model (3);
+	model.initialize(vector<string>(1, text_path));
+	vector<pair<Ngram, string>> trigrams;
+	while ((int) trigrams.size() < num_queries) {
+		vector<pair<string, string>> sentence = corpus.sentence();
+		for (size_t i = 0; i + 3 < sentence.size() && (int) trigrams.size() < num_queries; ++i) {
+			trigrams.push_back(make_pair(Ngram(2, {sentence[i].first, sentence[i + 1].first}), sentence[i + 2].first));
+		}
+	}
+	time_each(out, "ngram.probability", trigrams, "ns", [&](const pair<Ngram, string> &trigram) {
+		checksum += model.probability(trigram.first, trigram.second) > 0;
+	});
+
+	/* Part-of-speech tagger. */
+	time_each(out, "pos.read_brown_corpus", vector<int>(3), "ms", [&](int) {
+		PartOfSpeechTagger tagger;
+		tagger.read_brown_corpus(brown_path);
+	});
+	time_each(out, "pos.read_brown_corpus.threads4", vector<int>(3), "ms", [&](int) {
+		PartOfSpeechTagger tagger;
+		tagger.read_brown_corpus(brown_path, 4);
+	});
+
+	/* Neural network. */
+	int topology[] = {Sentence::input_size, 10, 1};
+	NeuralNetwork net (topology, 3);
+	vector<pair<ARRAY, ARRAY>> samples (1000);
+	for (pair<ARRAY, ARRAY> &sample : samples) {
+		for (int j = 0; j < Sentence::input_size; ++j) {
+			sample.first.push_back((double) rand() / RAND_MAX);
+		}
+		sample.second.assign(1, sample.first[0] > 0.5 ? 1.0 : 0.0);
+	}
+	time_each(out, "network.feedforward", samples, "ns", [&](const pair<ARRAY, ARRAY> &sample) {
+		checksum += net.feedforward(sample.first)[0];
+	});
+	time_each(out, "network.train", vector<int>(5), "ms", [&](int) { net.train(samples, 1, 32); });
+
+	vector<string> files;
+	PartOfSpeechTagger::list_brown_corpus_files(brown_path, &files);
+	for (const string &file : files) {
+		remove(file.c_str());
+	}
+	remove(brown_path.c_str());
+	remove(dictionary_path.c_str());
+	remove(text_path.c_str());
+	remove(directory.c_str());
+
+	cerr << "(" << checksum << ")" << endl;
+}
+
+/* Runs autocomplete and autocorrect queries from several threads, and n-gram probabilities, on synthetic data, then
+ * prints the counters of the slowest autocorrect on the main thread and the instrumentation report. Compile with
+ * -DINSTRUMENTATION for the report to hold anything; comparing the mean latency printed with and without it gives the
+ * instrumentation's overhead. */
+static void benchmark_instrumentation(int num_threads) {
+#ifndef INSTRUMENTATION
+	cout << "instrumentation: compiled out; rebuild with -DINSTRUMENTATION for counters and histograms" << endl;
+#endif
+
+	SyntheticCorpus corpus (20000, 1);
+	Trie trie;
+	for (size_t rank = 0; rank < corpus.vocabulary_size(); ++rank) {
+		trie.insert(corpus.get_word(rank), corpus.get_weight(rank));
+	}
+
+	const int queries_per_thread = 500;
+	vector<vector<string>> prefixes (num_threads), typos (num_threads);
+	for (int t = 0; t < num_threads; ++t) {
+		for (int i = 0; i < queries_per_thread; ++i) {
+			const string &word = corpus.get_word(corpus.sample_word());
+			prefixes[t].push_back(word.substr(0, 1 + i % 2));
+			typos[t].push_back(corpus.typo(word, 1 + i % 2));
+		}
+	}
+
+	/* Trie queries only read the trie, apart from the deletion index and filter, which aren't built here. */
+	vector<double> seconds (num_threads);
+	QueryStats slowest;
+	memset(&slowest, 0, sizeof(slowest));
+	auto run = [&](int t) {
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < queries_per_thread; ++i) {
+			trie.autocomplete(prefixes[t][i], 10);
+			trie.autocorrect(typos[t][i], 1 + i % 2);
+			if (t == 0 && Instrumentation::last_query().nanoseconds > slowest.nanoseconds) {
+				slowest = Instrumentation::last_query();
+			}
+		}
+		seconds[t] = seconds_since(start);
+	};
+
+	vector<thread> threads;
+	for (int t = 1; t < num_threads; ++t) {
+		threads.push_back(thread(run, t));
+	}
+	run(0);
+	for (thread &t : threads) {
+		t.join();
+	}
+
+	char text_path[] = "/tmp/predictive-text-instrumentation-XXXXXX";
+	int fd = mkstemp(text_path);
+	if (fd < 0) {
+		throw runtime_error("Unable to create a temporary file");
+	}
+	close(fd);
+	corpus.write_text(text_path, 2000);
+
+	NgramModel model (3);
+	model.initialize(vector<string>(1, text_path));
+	remove(text_path);
+	for (int i = 0; i < 1000; ++i) {
+		vector<pair<string, string>> sentence = corpus.sentence();
+		model.probability(Ngram(2, {sentence[0].first, sentence[1].first}), sentence[2].first);
+	}
+
+	double mean = 0;
+	for (double s : seconds) {
+		mean += s / num_threads / (2 * queries_per_thread);
+	}
+	cout << "instrumentation: " << num_threads << " threads, mean " << mean * 1e6 << " us per trie query" << endl;
+	cout << "instrumentation: slowest autocorrect on thread 0: " << slowest.nanoseconds / 1000 << " us";
+	for (int c = 0; c < NUM_COUNTERS; ++c) {
+		cout << ", " << Instrumentation::counter_name((Counter) c) << " " << slowest.counters[c];
+	}
+	cout << endl;
+	Instrumentation::report(cout);
+}
+
+/* Builds a trigram model through NgramModel::initialize from a small text whose counts are known, with n-grams repeated
+ * within a paragraph and across the two, and returns how many next-word probabilities come out wrong. */
+static int ngram_mismatches(void) {
+	char text_path[] = "/tmp/predictive-text-ngrams-XXXXXX";
+	int fd = mkstemp(text_path);
+	if (fd < 0) {
+		throw runtime_error("Unable to create a temporary file");
+	}
+	close(fd);
+	ofstream text (text_path);
+	text << "The cat sat. The cat ran. The dog sat." << endl << "The dog ran." << endl;
+	text.close();
+
+	NgramModel model (3);
+	model.initialize(vector<string>(1, text_path));
+	remove(text_path);
+
+	const vector<tuple<string, string, string, double>> expected = {
+		make_tuple("<s>", "The", "cat", 0.5), make_tuple("<s>", "The", "dog", 0.5), make_tuple("<s>", "The", "bird", 0),
+		make_tuple("The", "cat", "sat.", 0.5), make_tuple("The", "cat", "ran.", 0.5), make_tuple("The", "dog", "sat.", 0.5),
+		make_tuple("cat", "sat.", "</s>", 1), make_tuple("dog", "ran.", "</s>", 1)
+	};
+	int mismatches = 0;
+	for (const auto &it : expected) {
+		mismatches += model.probability(Ngram(2, {get<0>(it), get<1>(it)}), get<2>(it)) != get<3>(it);
+	}
+
+	return mismatches;
+}
+
+/* Serves synthetic data through a PredictionServer on a temporary socket to 1, 2, 4, ... up to max_clients concurrent
+ * clients, each on its own thread and connection, keeping the given number of requests in flight. Prints requests per
+ * second and the mean batch size the server formed at each client count, after the cost of answering the same requests
+ * in process, on one thread and without the socket. Requests are half autocomplete, a quarter autocorrect and a quarter
+ * next word. First checks that the n-gram model behind next word requests counts a known text correctly. */
+static void benchmark_server(int max_clients, int depth) {
+	cout << "server: " << ngram_mismatches() << " mismatched next word probabilities on a known text" << endl;
+
+	SyntheticCorpus corpus (20000, 1);
+	Trie trie;
+	for (size_t rank = 0; rank < corpus.vocabulary_size(); ++rank) {
+		trie.insert(corpus.get_word(rank), corpus.get_weight(rank));
+	}
+	trie.build_deletion_index();
+
+	char text_path[] = "/tmp/predictive-text-server-XXXXXX";
+	int fd = mkstemp(text_path);
+	if (fd < 0) {
+		throw runtime_error("Unable to create a temporary file");
+	}
+	close(fd);
+	corpus.write_text(text_path, 2000);
+	NgramModel model (3);
+	model.initialize(vector<string>(1, text_path));
+	remove(text_path);
+
+	const int num_requests = 2000, requests_per_client = 4000;
+	vector<PredictionRequest> requests;
+	for (int i = 0; i < num_requests; ++i) {
+		const string &word = corpus.get_word(corpus.sample_word());
+		if (i % 4 < 2) {
+			requests.push_back(PredictionRequest {0, AUTOCOMPLETE_REQUEST, 5, {}, word.substr(0, 1 + i % 3)});
+		} else if (i % 4 == 2) {
+			requests.push_back(PredictionRequest {0, AUTOCORRECT_REQUEST, (uint8_t) (1 + i % 2), {}, corpus.typo(word, 1)});
+		} else {
+			vector<pair<string, string>> sentence = corpus.sentence();
+			requests.push_back(PredictionRequest {0, NEXT_WORD_REQUEST, 5, {sentence[1].first, sentence[2].first}, word.substr(0, 1)});
+		}
+	}
+
+	string socket_path = "/tmp/predictive-text-benchmark-" + to_string(getpid()) + ".sock";
+	PredictionServer server (&trie, &model, socket_path);
+	size_t checksum = 0;
+	auto start = chrono::steady_clock::now();
+	for (const PredictionRequest &request : requests) {
+		checksum += server.answer(request).words.size();
+	}
+	cout << "server: in process, " << seconds_since(start) / num_requests * 1e6 << " us per request" << endl;
+
+	thread loop (&PredictionServer::run, &server);
+	for (int num_clients = 1; num_clients <= max_clients; num_clients *= 2) {
+		uint64_t requests_before = server.get_num_requests(), batches_before = server.get_num_batches();
+		vector<size_t> checksums (num_clients, 0);
+		vector<thread> clients;
+		start = chrono::steady_clock::now();
+		for (int c = 0; c < num_clients; ++c) {
+			clients.push_back(thread([&, c]() {
+				PredictionClient client (socket_path);
+				int sent = 0, received = 0;
+				while (received < requests_per_client) {
+					while (sent < requests_per_client && sent - received < depth) {
+						client.send(requests[(c * 7919 + sent++) % num_requests]);
+					}
+					checksums[c] += client.receive().words.size();
+					++received;
+				}
+			}));
+		}
+		for (thread &t : clients) {
+			t.join();
+		}
+		double elapsed = seconds_since(start);
+
+		for (size_t sum : checksums) {
+			checksum += sum;
+		}
+		cout << "server: " << num_clients << " clients, " << depth << " in flight each: "
+			 << num_clients * requests_per_client / elapsed << " requests/s, mean batch "
+			 << (double) (server.get_num_requests() - requests_before) / (server.get_num_batches() - batches_before) << endl;
+	}
+	server.stop();
+	loop.join();
+
+	cerr << "(" << checksum << ")" << endl;
+}
+
+/* Splits a dictionary file, in the format of Trie::insert_from_file with weights, across 1, 2, 4, ... up to max_shards
+ * worker processes, and at each shard count has the given number of client threads, each with its own ShardRouter, run
+ * autocomplete queries for two-letter prefixes and autocorrect queries for words with one letter substituted. Prints
+ * queries per second, and checks the routed results, in full and cut to the best correction, against a single Trie. */
+static void benchmark_shards(const string dictionary_path, int max_shards, int num_clients, int num_queries) {
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+	vector<string> words = dictionary_words(dictionary_path);
+	vector<string> prefixes, typos;
+	mt19937 generator (1);
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = words[generator() % words.size()];
+		prefixes.push_back(word.substr(0, min((size_t) 2, word.length())));
+
+		string typo = word;
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	string socket_prefix = "/tmp/predictive-text-shard-" + to_string(getpid());
+	for (int num_shards = 1; num_shards <= max_shards; num_shards *= 2) {
+		ShardedTrie shards (dictionary_path, num_shards, socket_prefix);
+
+		int mismatches = 0;
+		{
+			ShardRouter router (shards);
+			for (int i = 0; i < min(num_queries, 100); ++i) {
+				mismatches += router.autocomplete(prefixes[i], 10) != trie.autocomplete(prefixes[i], 10);
+				vector<string> corrections = trie.autocorrect(typos[i], 1);
+				mismatches += router.autocorrect(typos[i], 1) != corrections;
+
+				/* Truncating must keep the best corrections, the heaviest among the nearest. */
+				corrections.resize(min(corrections.size(), (size_t) 1));
+				mismatches += router.autocorrect(typos[i], 1, 1) != corrections;
+			}
+		}
+
+		vector<thread> clients;
+		auto start = chrono::steady_clock::now();
+		for (int c = 0; c < num_clients; ++c) {
+			clients.push_back(thread([&, c]() {
+				ShardRouter router (shards);
+				for (int i = c; i < num_queries; i += num_clients) {
+					router.autocomplete(prefixes[i], 10);
+					router.autocorrect(typos[i], 1);
+				}
+			}));
+		}
+		for (thread &t : clients) {
+			t.join();
+		}
+		double elapsed = seconds_since(start);
+
+		cout << "shards: " << shards.num_shards() << " shards, " << num_clients << " clients: " << 2 * num_queries / elapsed
+			 << " queries/s, " << mismatches << " mismatches against a single trie" << endl;
+	}
+}
+
+/* Returns the bytes currently allocated on the heap. */
+static size_t heap_bytes(void) { return mallinfo2().uordblks; }
+
+/* Gives each of the given number of users an OverlayTrie over one base Trie read from a dictionary file, in the format of
+ * Trie::insert_from_file with weights, and makes the given number of changes in each: half insertions of new words, a
+ * quarter reweightings of base words and a quarter removals. Prints the heap each overlay takes against what a deep copy
+ * of the base per user would, and the latency of autocomplete and autocorrect through an overlay and on the base. Checks
+ * that corrections tied in distance and weight across the base and an overlay come out as from a materialized trie. */
+static void benchmark_overlays(const string dictionary_path, int num_users, int changes_per_user) {
+	size_t before = heap_bytes();
+	shared_ptr<Trie> base (new Trie());
+	base->insert_from_file(dictionary_path, true);
+	base->build_deletion_index();
+	size_t base_bytes = heap_bytes() - before;
+
+	before = heap_bytes();
+	size_t copy_bytes;
+	{
+		Trie copy;
+		copy.root = base->root;
+		copy_bytes = heap_bytes() - before;
+	}
+
+	vector<string> words = dictionary_words(dictionary_path);
+	mt19937 generator (1);
+	before = heap_bytes();
+	vector<OverlayTrie> overlays;
+	overlays.reserve(num_users);
+	for (int u = 0; u < num_users; ++u) {
+		overlays.push_back(OverlayTrie(base));
+		for (int i = 0; i < changes_per_user; ++i) {
+			string word = words[generator() % words.size()];
+			if (i % 4 < 2) {
+				word[generator() % word.length()] = 'a' + generator() % 26;
+				overlays.back().insert(word, generator() % 100000);
+			} else if (i % 4 == 2) {
+				overlays.back().insert(word, generator() % 100000);
+			} else {
+				overlays.back().remove(word);
+			}
+		}
+	}
+	size_t overlay_bytes = heap_bytes() - before;
+
+	cout << "overlays: base " << base_bytes << " bytes (trie alone " << copy_bytes << "); " << num_users << " users with "
+		 << changes_per_user << " changes: " << overlay_bytes / num_users << " bytes each, " << base_bytes + overlay_bytes
+		 << " in all against " << base_bytes + (size_t) num_users * copy_bytes << " for a copy per user" << endl;
+
+	const int num_queries = 1000;
+	vector<string> prefixes, typos;
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = words[generator() % words.size()];
+		prefixes.push_back(word.substr(0, min((size_t) 2, word.length())));
+		string typo = word;
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	size_t checksum = 0;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		checksum += base->autocomplete(prefixes[i], 10).size();
+	}
+	double base_complete = seconds_since(start) / num_queries;
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		checksum += overlays[i % num_users].autocomplete(prefixes[i], 10).size();
+	}
+	double overlay_complete = seconds_since(start) / num_queries;
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		checksum += base->autocorrect(typos[i], 1).size();
+	}
+	double base_correct = seconds_since(start) / num_queries;
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		checksum += overlays[i % num_users].autocorrect(typos[i], 1).size();
+	}
+	double overlay_correct = seconds_since(start) / num_queries;
+
+	/* Check corrections that tie across the layers against a materialized trie: for some typos, give one new word and one
+	 * reweighted base word at the same distance the weight of the best base correction. */
+	OverlayTrie tied (base);
+	Trie materialized;
+	materialized.root = base->root;
+	vector<string> tied_typos;
+	for (int i = 0; i < num_queries && tied_typos.size() < 20; ++i) {
+		vector<string> corrections = base->autocorrect(typos[i], 1);
+		if (corrections.size() < 2) {
+			continue;
+		}
+		double weight = base->get_weight(corrections[0]);
+		for (size_t j = 0; j < typos[i].length(); ++j) {
+			string word = typos[i];
+			word[j] = word[j] == 'a' ? 'b' : 'a';
+			if (!base->contains(word)) {
+				tied.insert(word, weight);
+				materialized.insert(word, weight);
+				break;
+			}
+		}
+		tied.insert(corrections[1], weight);
+		materialized.insert(corrections[1], weight);
+		tied_typos.push_back(typos[i]);
+	}
+	int mismatches = 0;
+	for (const string &typo : tied_typos) {
+		mismatches += tied.autocorrect(typo, 1) != materialized.autocorrect(typo, 1);
+	}
+
+	cout << "overlays: autocomplete " << base_complete * 1e6 << " us on the base, " << overlay_complete * 1e6
+		 << " us through an overlay; autocorrect " << base_correct * 1e6 << " us on the base, " << overlay_correct * 1e6
+		 << " us through an overlay (" << mismatches << " of " << tied_typos.size() << " tied corrections mismatched)" << endl;
+	cerr << "(" << checksum << ")" << endl;
+}
+
+/* Completes the given number of prefixes of words from a dictionary file, in the format of Trie::insert_from_file with
+ * weights, each with one letter changed, three ways: with fuzzy_autocomplete, with autocorrect on the prefix followed by
+ * autocomplete on every correction, and with a plain autocomplete of the unchanged prefix. Prints the latency of each and
+ * how many of the second way's results are duplicates. */
+static void benchmark_fuzzy(const string dictionary_path, int num_queries) {
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+	vector<string> words = dictionary_words(dictionary_path);
+	mt19937 generator (1);
+	const int k = 10, max_distance = 1;
+
+	vector<string> prefixes, typos;
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = words[generator() % words.size()];
+		prefixes.push_back(word.substr(0, min((size_t) 4, word.length())));
+		string typo = prefixes.back();
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	size_t checksum = 0;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		checksum += trie.fuzzy_autocomplete(typos[i], max_distance, k).size();
+	}
+	double fuzzy = seconds_since(start) / num_queries;
+
+	size_t completions = 0, duplicates = 0;
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		set<string> seen;
+		for (const string &correction : trie.autocorrect(typos[i], max_distance)) {
+			for (const string &completion : trie.autocomplete(correction, k)) {
+				++completions;
+				duplicates += !seen.insert(completion).second;
+			}
+		}
+		checksum += seen.size();
+	}
+	double loop = seconds_since(start) / num_queries;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < num_queries; ++i) {
+		checksum += trie.autocomplete(prefixes[i], k).size();
+	}
+	double plain = seconds_since(start) / num_queries;
+
+	cout << "fuzzy: top " << k << " within " << max_distance << " of " << num_queries << " prefixes: fuzzy_autocomplete "
+		 << fuzzy * 1e6 << " us, autocorrect then autocomplete " << loop * 1e6 << " us (" << duplicates << " of "
+		 << completions << " results duplicates), plain autocomplete " << plain * 1e6 << " us (checksum " << checksum << ")"
+		 << endl;
+}
+
+/* Builds a trie of the given instantiation of BasicTrie from (word, weight) pairs and times its queries, printing a line
+ * of benchmark_alphabets: footprint, build time, and mean autocomplete, get_weight and autocorrect latency. The first
+ * call fills in the expected results; later ones count the queries whose results differ from them. */
+template <class TrieType>
+static void measure_alphabet(const string name, const vector<pair<string, double>> &entries, const vector<string> &prefixes,
+		const vector<string> &typos, vector<vector<string>> *completions, vector<double> *weights,
+		vector<vector<string>> *corrections) {
+	const int k = 10, max_distance = 1;
+	bool expected = completions->empty();
+
+	auto start = chrono::steady_clock::now();
+	TrieType trie;
+	for (const auto &entry : entries) {
+		trie.insert(entry.first, entry.second);
+	}
+	double build = seconds_since(start);
+	size_t nodes, bytes;
+	trie_footprint(trie.root, &nodes, &bytes);
+
+	vector<vector<string>> got_completions;
+	start = chrono::steady_clock::now();
+	for (const string &prefix : prefixes) {
+		got_completions.push_back(trie.autocomplete(prefix, k));
+	}
+	double autocomplete = seconds_since(start) / prefixes.size();
+
+	vector<double> got_weights;
+	start = chrono::steady_clock::now();
+	for (size_t i = 0; i < prefixes.size(); ++i) {
+		got_weights.push_back(trie.get_weight(entries[i * entries.size() / prefixes.size()].first));
+	}
+	double get_weight = seconds_since(start) / prefixes.size();
+
+	vector<vector<string>> got_corrections;
+	start = chrono::steady_clock::now();
+	for (const string &typo : typos) {
+		got_corrections.push_back(trie.autocorrect(typo, max_distance));
+	}
+	double autocorrect = seconds_since(start) / typos.size();
+
+	int mismatches = 0;
+	if (expected) {
+		*completions = got_completions;
+		*weights = got_weights;
+		*corrections = got_corrections;
+	} else {
+		for (size_t i = 0; i < prefixes.size(); ++i) {
+			mismatches += got_completions[i] != (*completions)[i] || got_weights[i] != (*weights)[i];
+		}
+		for (size_t i = 0; i < typos.size(); ++i) {
+			mismatches += got_corrections[i] != (*corrections)[i];
+		}
+	}
+
+	cout << "alphabets " << name << ": " << nodes << " nodes, " << bytes << " bytes (" << (double) bytes / nodes
+		 << " per node, node " << sizeof(typename TrieType::Node) << "), build " << build << "s, autocomplete "
+		 << autocomplete * 1e6 << " us, get_weight " << get_weight * 1e6 << " us, autocorrect " << autocorrect * 1e6
+		 << " us, " << mismatches << " mismatches" << endl;
+}
+
+/* Compares the instantiations of BasicTrie compiled in trie.cpp on the lowercase words of a dictionary file in the format
+ * of Trie::insert_from_file, with weights, which should be whole numbers for the uint32_t instantiation to agree: the
+ * default over any byte with double weights, then ASCII, then lowercase letters with double, float and uint32_t
+ * weights. Results are checked against the default. */
+static void benchmark_alphabets(const string dictionary_path, int num_queries) {
+	vector<pair<string, double>> entries;
+	ifstream dictionary (dictionary_path);
+	string line, word;
+	double weight;
+	getline(dictionary, line);
+	while (dictionary >> word >> weight) {
+		if (all_of(word.begin(), word.end(), [](char c) { return LowercaseAlphabet::index(c) >= 0; })) {
+			entries.push_back(make_pair(word, weight));
+		}
+	}
+	if (entries.empty()) {
+		throw runtime_error("No lowercase words in " + dictionary_path);
+	}
+
+	mt19937 generator (1);
+	vector<string> prefixes, typos;
+	for (int i = 0; i < num_queries; ++i) {
+		const string &word = entries[generator() % entries.size()].first;
+		prefixes.push_back(word.substr(0, min((size_t) 3, word.length())));
+		string typo = word;
+		typo[generator() % typo.length()] = 'a' + generator() % 26;
+		typos.push_back(typo);
+	}
+
+	vector<vector<string>> completions, corrections;
+	vector<double> weights;
+	measure_alphabet<Trie>("byte/double", entries, prefixes, typos, &completions, &weights, &corrections);
+	measure_alphabet<BasicTrie<AsciiAlphabet, double>>("ascii/double", entries, prefixes, typos, &completions, &weights, &corrections);
+	measure_alphabet<BasicTrie<LowercaseAlphabet, double>>("lowercase/double", entries, prefixes, typos, &completions, &weights, &corrections);
+	measure_alphabet<BasicTrie<LowercaseAlphabet, float>>("lowercase/float", entries, prefixes, typos, &completions, &weights, &corrections);
+	measure_alphabet<BasicTrie<LowercaseAlphabet, uint32_t>>("lowercase/uint32_t", entries, prefixes, typos, &completions, &weights, &corrections);
+}
+
+/* Removes a directory and the files in it. */
+static void remove_directory(const string directory) {
+	DIR *dir = opendir(directory.c_str());
+	if (dir != NULL) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL) {
+			if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+				remove((directory + "/" + entry->d_name).c_str());
+			}
+		}
+		closedir(dir);
+	}
+	remove(directory.c_str());
+}
+
+/* Journals the given number of weight updates to words of a dictionary file, in the format of Trie::insert_from_file with
+ * weights, from 1, 2, 4, ... up to the given number of threads, each syncing after every update. Prints the update rate
+ * and the updates covered by each sync, against the cost of saving a whole snapshot, then the time to reopen the journal
+ * before and after compacting it, against rebuilding the trie from the dictionary file. */
+static void benchmark_journal(const string dictionary_path, int num_changes, int max_threads) {
+	char directory_template[] = "/tmp/predictive-text-journal-XXXXXX";
+	if (mkdtemp(directory_template) == NULL) {
+		throw runtime_error("Unable to create a temporary directory");
+	}
+	string directory = directory_template;
+
+	auto start = chrono::steady_clock::now();
+	Trie base;
+	base.insert_from_file(dictionary_path, true);
+	double rebuild = seconds_since(start);
+	start = chrono::steady_clock::now();
+	base.save(directory + "/trie.model");
+	double snapshot = seconds_since(start);
+	remove((directory + "/trie.model").c_str());
+	cout << "journal: rebuilding from the dictionary takes " << rebuild * 1e3 << " ms, saving a snapshot " << snapshot * 1e3
+		 << " ms" << endl;
+
+	vector<string> words = dictionary_words(dictionary_path);
+	for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+		string journal_directory = directory + "/journal-" + to_string(num_threads);
+		Trie trie;
+		trie.root = base.root;
+		unique_ptr<UpdateJournal> journal (new UpdateJournal(journal_directory, &trie, NULL, numeric_limits<size_t>::max()));
+
+		mutex writer;
+		vector<thread> threads;
+		start = chrono::steady_clock::now();
+		for (int t = 0; t < num_threads; ++t) {
+			threads.push_back(thread([&, t]() {
+				mt19937 generator (t);
+				for (int i = t; i < num_changes; i += num_threads) {
+					uint64_t sequence;
+					{
+						lock_guard<mutex> guard (writer);
+						sequence = journal->record(words[generator() % words.size()]);
+					}
+					journal->sync(sequence);
+				}
+			}));
+		}
+		for (thread &t : threads) {
+			t.join();
+		}
+		double seconds = seconds_since(start);
+		size_t journal_bytes = journal->get_segment_bytes();
+		uint64_t num_syncs = journal->get_num_syncs();
+		journal.reset();
+
+		/* Reopen with the whole journal to replay, then compact and reopen with none. */
+		start = chrono::steady_clock::now();
+		Trie replayed;
+		journal.reset(new UpdateJournal(journal_directory, &replayed));
+		double replay = seconds_since(start);
+		start = chrono::steady_clock::now();
+		journal->compact();
+		journal->wait_for_compaction();
+		double compaction = seconds_since(start);
+		journal.reset();
+
+		start = chrono::steady_clock::now();
+		Trie restored;
+		journal.reset(new UpdateJournal(journal_directory, &restored));
+		double reopen = seconds_since(start);
+		journal.reset();
+
+		int mismatches = 0;
+		for (size_t i = 0; i < words.size(); i += 97) {
+			mismatches += replayed.get_weight(words[i]) != trie.get_weight(words[i]) || restored.get_weight(words[i]) != trie.get_weight(words[i]);
+		}
+		remove_directory(journal_directory);
+
+		cout << "journal: " << num_threads << " threads: " << num_changes / seconds << " synced updates/s, "
+			 << (double) num_changes / num_syncs << " per sync, " << journal_bytes / num_changes << " bytes each; reopen "
+			 << replay * 1e3 << " ms with the journal, " << reopen * 1e3 << " ms after a " << compaction * 1e3
+			 << " ms compaction (" << mismatches << " mismatches)" << endl;
+	}
+
+	remove_directory(directory);
+}
+
+/* Scales every weight in the trie, and every max weight with it, by the given positive factor: the full-trie rewrite a
+ * decaying count needs when its weights are stored as they are. */
+static void scale_weights(Trie *trie, double factor) {
+	vector<Node *> stack (1, &trie->root);
+	while (!stack.empty()) {
+		Node *n = stack.back();
+		stack.pop_back();
+
+		if (n->is_end()) {
+			n->set_weight(n->get_weight() * factor);
+		}
+		if (Node::get_max_weight(n) != - numeric_limits<double>::infinity()) {
+			Node::set_max_weight(n, Node::get_max_weight(n) * factor);
+		}
+		for (const auto &it : n->get_children()) {
+			stack.push_back(it.second);
+		}
+	}
+}
+
+/* Records the given number of occurrences a day, for the given number of days, of words drawn with a skew towards the
+ * start of a dictionary file, in the format of Trie::insert_from_file, into two tries whose counts halve every week: one
+ * in decay mode, and one whose weights are all scaled down at the end of each day. Prints the cost of a recorded
+ * occurrence in each and of the daily rescaling, and checks that both give the same weights and completions. */
+static void benchmark_decay(const string dictionary_path, int num_days, int per_day) {
+	vector<string> words = dictionary_words(dictionary_path);
+	const double half_life = 7;
+	mt19937 generator (1);
+	vector<string> occurrences;
+	for (int i = 0; i < per_day; ++i) {
+		occurrences.push_back(words[generator() % (generator() % words.size() + 1)]);
+	}
+
+	Trie lazy, eager;
+	lazy.enable_decay(half_life);
+	double lazy_seconds = 0, eager_seconds = 0, rescale_seconds = 0;
+	for (int day = 0; day < num_days; ++day) {
+		shuffle(occurrences.begin(), occurrences.end(), generator);
+
+		auto start = chrono::steady_clock::now();
+		lazy.set_time(day);
+		for (const string &word : occurrences) {
+			lazy.record(word);
+		}
+		lazy_seconds += seconds_since(start);
+
+		start = chrono::steady_clock::now();
+		for (const string &word : occurrences) {
+			eager.record(word);
+		}
+		eager_seconds += seconds_since(start);
+
+		start = chrono::steady_clock::now();
+		scale_weights(&eager, pow(0.5, 1 / half_life));
+		rescale_seconds += seconds_since(start);
+	}
+	lazy.set_time(num_days);
+
+	/* Compare weights, and completions of every prefix of up to three letters in use. */
+	double max_error = 0;
+	set<string> prefixes;
+	for (const string &word : words) {
+		if (eager.contains(word)) {
+			max_error = max(max_error, fabs(lazy.get_weight(word) - eager.get_weight(word)) / eager.get_weight(word));
+		}
+		prefixes.insert(word.substr(0, 1));
+		prefixes.insert(word.substr(0, 2));
+		prefixes.insert(word.substr(0, 3));
+	}
+	int mismatches = 0;
+	for (const string &prefix : prefixes) {
+		mismatches += lazy.autocomplete(prefix, 10) != eager.autocomplete(prefix, 10);
+	}
+
+	double num_records = (double) num_days * per_day;
+	cout << "decay: " << num_days << " days of " << per_day << " occurrences: record " << lazy_seconds / num_records * 1e9
+		 << " ns lazily, " << eager_seconds / num_records * 1e9 << " ns plus " << rescale_seconds / num_days * 1e3
+		 << " ms a day rescaling eagerly (" << (eager_seconds + rescale_seconds) / lazy_seconds << "x in all)" << endl;
+	cout << "decay: largest relative weight difference " << max_error << ", " << mismatches << " of " << prefixes.size()
+		 << " prefixes complete differently" << endl;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " brown <corpus directory> [max threads]" << endl;
+		cerr << "       " << argv[0] << " tokenize <text file> [iterations]" << endl;
+		cerr << "       " << argv[0] << " sentences <text file> [corpus directory]" << endl;
+		cerr << "       " << argv[0] << " network [samples]" << endl;
+		cerr << "       " << argv[0] << " training [corpus directory] [max threads]" << endl;
+		cerr << "       " << argv[0] << " inference [corpus directory]" << endl;
+		cerr << "       " << argv[0] << " models <corpus directory>" << endl;
+		cerr << "       " << argv[0] << " tries <dictionary> [queries]" << endl;
+		cerr << "       " << argv[0] << " louds <dictionary> [queries]" << endl;
+		cerr << "       " << argv[0] << " frozen <dictionary> [queries] [query log]" << endl;
+		cerr << "       " << argv[0] << " deletion <dictionary> [queries]" << endl;
+		cerr << "       " << argv[0] << " filter <dictionary> [text file]" << endl;
+		cerr << "       " << argv[0] << " suite [scale] [output file]" << endl;
+		cerr << "       " << argv[0] << " instrumentation [threads]" << endl;
+		cerr << "       " << argv[0] << " server [max clients] [requests in flight per client]" << endl;
+		cerr << "       " << argv[0] << " shards <dictionary> [max shards] [clients] [queries]" << endl;
+		cerr << "       " << argv[0] << " overlays <dictionary> [users] [changes per user]" << endl;
+		cerr << "       " << argv[0] << " decay <dictionary> [days] [occurrences per day]" << endl;
+		cerr << "       " << argv[0] << " fuzzy <dictionary> [queries]" << endl;
+		cerr << "       " << argv[0] << " journal <dictionary> [updates] [max threads]" << endl;
+		cerr << "       " << argv[0] << " alphabets <dictionary> [queries]" << endl;
+		return 1;
+	}
+
+	string name = argv[1];
+	if (name == "brown" && argc >= 3) {
+		benchmark_brown_corpus(argv[2], argc >= 4 ? atoi(argv[3]) : 8);
+	} else if (name == "tokenize" && argc >= 3) {
+		benchmark_tokenizer(argv[2], argc >= 4 ? atoi(argv[3]) : 10);
+	} else if (name == "sentences" && argc >= 3) {
+		benchmark_sentences(argv[2], argc >= 4 ? argv[3] : "");
+	} else if (name == "network") {
+		benchmark_network(argc >= 3 ? atoi(argv[2]) : 20000);
+	} else if (name == "training") {
+		benchmark_training(argc >= 3 ? argv[2] : "", argc >= 4 ? atoi(argv[3]) : 8, 20);
+	} else if (name == "inference") {
+		benchmark_inference(argc >= 3 ? argv[2] : "");
+	} else if (name == "models" && argc >= 3) {
+		benchmark_models(argv[2]);
+	} else if (name == "tries" && argc >= 3) {
+		benchmark_tries(argv[2], argc >= 4 ? atoi(argv[3]) : 1000);
+	} else if (name == "louds" && argc >= 3) {
+		benchmark_louds(argv[2], argc >= 4 ? atoi(argv[3]) : 1000);
+	} else if (name == "frozen" && argc >= 3) {
+		benchmark_frozen(argv[2], argc >= 4 ? atoi(argv[3]) : 1000, argc >= 5 ? argv[4] : "");
+	} else if (name == "deletion" && argc >= 3) {
+		benchmark_deletion_index(argv[2], argc >= 4 ? atoi(argv[3]) : 1000);
+	} else if (name == "filter" && argc >= 3) {
+		benchmark_filter(argv[2], argc >= 4 ? argv[3] : "");
+	} else if (name == "suite") {
+		benchmark_suite(argc >= 3 ? atof(argv[2]) : 1.0, argc >= 4 ? argv[3] : "");
+	} else if (name == "instrumentation") {
+		benchmark_instrumentation(argc >= 3 ? atoi(argv[2]) : 4);
+	} else if (name == "server") {
+		benchmark_server(argc >= 3 ? atoi(argv[2]) : 64, argc >= 4 ? max(atoi(argv[3]), 1) : 1);
+	} else if (name == "shards" && argc >= 3) {
+		benchmark_shards(argv[2], argc >= 4 ? atoi(argv[3]) : 8, argc >= 5 ? max(atoi(argv[4]), 1) : 8, argc >= 6 ? atoi(argv[5]) : 2000);
+	} else if (name == "overlays" && argc >= 3) {
+		benchmark_overlays(argv[2], argc >= 4 ? max(atoi(argv[3]), 1) : 10000, argc >= 5 ? atoi(argv[4]) : 20);
+	} else if (name == "decay" && argc >= 3) {
+		benchmark_decay(argv[2], argc >= 4 ? max(atoi(argv[3]), 1) : 365, argc >= 5 ? atoi(argv[4]) : 20000);
+	} else if (name == "fuzzy" && argc >= 3) {
+		benchmark_fuzzy(argv[2], argc >= 4 ? max(atoi(argv[3]), 1) : 1000);
+	} else if (name == "journal" && argc >= 3) {
+		benchmark_journal(argv[2], argc >= 4 ? max(atoi(argv[3]), 1) : 20000, argc >= 5 ? max(atoi(argv[4]), 1) : 8);
+	} else if (name == "alphabets" && argc >= 3) {
+		benchmark_alphabets(argv[2], argc >= 4 ? max(atoi(argv[3]), 1) : 1000);
+	} else {
+		cerr << "Unknown benchmark '" << name << "'" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef BEST_FIRST_H
+#define BEST_FIRST_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <cstddef>
+
+using namespace std;
+
+/* Best first search for the top k completions below a node, shared by the tries that cache the maximum weight below
+ * every node (RadixTrie, LoudsTrie and FrozenTrie). Nodes are whatever indices the trie uses, and the trie is seen
+ * through two functions:
+ *     label(x)                  the label of the edge into node x, which is never empty below the root of the search
+ *     expand(x, word, child)    calls word(weight) if x ends a word, then child(c, max_weight) for each child c of x, in
+ *                               order of the first byte of its label
+ * Subtrees are expanded by their maximum weight, and a word is emitted once no unexpanded subtree could hold a heavier
+ * one, so the words come out ordered by descending weight, then alphabetically, as from Trie::autocomplete. start is the
+ * word spelled by the path to root. */
+template <class Label, class Expand>
+vector<string> best_first_completions(const string start, size_t root, double max_weight, int k, Label label, Expand expand) {
+	vector<string> ret;
+
+	/* Each entry is a node reached by the search, along with the entry of its parent, from which its word is rebuilt, and
+	 * its depth in the search. */
+	struct Entry {
+		size_t node;
+		int parent, depth;
+	};
+	vector<Entry> entries (1, Entry {root, -1, 0});
+
+	auto word_of = [&](int e) {
+		vector<string_view> labels;
+		for (; e > 0; e = entries[e].parent) {
+			labels.push_back(label(entries[e].node));
+		}
+
+		string word = start;
+		for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+			word.append(*it);
+		}
+		return word;
+	};
+
+	/* Compares the words of two entries without building them: an ancestor's word is a prefix of its descendants', and
+	 * otherwise the words differ first in the labels of the children of their deepest common ancestor, whose first
+	 * bytes differ. */
+	auto compare_words = [&](int a, int b) {
+		int order = 0;
+		for (; entries[a].depth > entries[b].depth; a = entries[a].parent) {
+			order = 1;
+		}
+		for (; entries[b].depth > entries[a].depth; b = entries[b].parent) {
+			order = -1;
+		}
+		if (a == b) {
+			return order;
+		}
+		while (entries[a].parent != entries[b].parent) {
+			a = entries[a].parent;
+			b = entries[b].parent;
+		}
+		return (unsigned char) label(entries[a].node)[0] < (unsigned char) label(entries[b].node)[0] ? -1 : 1;
+	};
+
+	/* Queue items are (priority, whether the item is a finished word, entry). At equal priority the alphabetically first
+	 * entry comes out first, a word before the node ending in it. */
+	auto after = [&](const tuple<double, bool, int> &a, const tuple<double, bool, int> &b) {
+		if (get<0>(a) != get<0>(b)) {
+			return get<0>(a) < get<0>(b);
+		}
+		int order = compare_words(get<2>(a), get<2>(b));
+		return order != 0 ? order > 0 : !get<1>(a) && get<1>(b);
+	};
+	priority_queue<tuple<double, bool, int>, vector<tuple<double, bool, int>>, decltype(after)> queue (after);
+	queue.push(make_tuple(max_weight, false, 0));
+	while (!queue.empty() && (int) ret.size() < k) {
+		double priority;
+		bool is_word;
+		int e;
+		tie(priority, is_word, e) = queue.top();
+		queue.pop();
+
+		if (is_word) {
+			ret.push_back(word_of(e));
+			continue;
+		}
+
+		auto word = [&](double weight) { queue.push(make_tuple(weight, true, e)); };
+		auto child = [&](size_t c, double child_max_weight) {
+			entries.push_back(Entry {c, e, entries[e].depth + 1});
+			queue.push(make_tuple(child_max_weight, false, (int) entries.size() - 1));
+		};
+		expand(entries[e].node, word, child);
+	}
+
+	return ret;
+}
+
+#endif
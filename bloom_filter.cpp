@@ -0,0 +1,86 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "bloom_filter.h"
+
+using namespace std;
+
+const int max_hashes = 16;
+
+/* Begin CountingBloomFilter class. */
+
+/* Sizes the filter to hold the given number of strings with the given false positive rate: m = -n ln(p) / ln(2)^2
+ * counters and k = (m / n) ln(2) hashes. */
+CountingBloomFilter::CountingBloomFilter(size_t capacity, double false_positive_rate /* = 0.01 */) {
+	if (false_positive_rate <= 0 || false_positive_rate >= 1) {
+		throw runtime_error("False positive rate must lie strictly between 0 and 1");
+	}
+
+	double n = max(capacity, (size_t) 1);
+	this->num_counters = max((size_t) ceil(-n * log(false_positive_rate) / (log(2) * log(2))), (size_t) 64);
+	this->num_hashes = min(max((int) round(this->num_counters / n * log(2)), 1), max_hashes);
+	this->counters.assign((this->num_counters + 15) / 16, 0);
+}
+
+int CountingBloomFilter::get_num_hashes(void) const { return this->num_hashes; }
+
+size_t CountingBloomFilter::memory_bytes(void) const { return this->counters.capacity() * sizeof(uint64_t); }
+
+/* Stores in p the num_hashes counter positions of the given string, computed as h1 + i h2 from two halves of a mixed
+ * 64-bit hash and reduced to the number of counters by multiplication rather than division. */
+void CountingBloomFilter::positions(string_view s, size_t *p) const {
+	uint64_t h = hash<string_view>()(s);
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL; // splitmix64 finalizer, as std::hash may be weak in its high bits
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+
+	uint32_t h1 = h, h2 = (h >> 32) | 1;
+	for (int i = 0; i < this->num_hashes; ++i) {
+		uint32_t combined = h1 + i * h2;
+		p[i] = ((uint64_t) combined * this->num_counters) >> 32;
+	}
+}
+
+void CountingBloomFilter::add(string_view s) {
+	size_t p[max_hashes];
+	this->positions(s, p);
+	for (int i = 0; i < this->num_hashes; ++i) {
+		uint64_t &word = this->counters[p[i] / 16];
+		int shift = p[i] % 16 * 4;
+		if (((word >> shift) & 0xf) != 0xf) {
+			word += 1ULL << shift;
+		}
+	}
+}
+
+/* Removes a string previously added. Removing one that wasn't added may make the filter forget others. */
+void CountingBloomFilter::remove(string_view s) {
+	size_t p[max_hashes];
+	this->positions(s, p);
+	for (int i = 0; i < this->num_hashes; ++i) {
+		uint64_t &word = this->counters[p[i] / 16];
+		int shift = p[i] % 16 * 4;
+		uint64_t count = (word >> shift) & 0xf;
+		if (count != 0 && count != 0xf) {
+			word -= 1ULL << shift;
+		}
+	}
+}
+
+bool CountingBloomFilter::possibly_contains(string_view s) const {
+	size_t p[max_hashes];
+	this->positions(s, p);
+	for (int i = 0; i < this->num_hashes; ++i) {
+		if (((this->counters[p[i] / 16] >> (p[i] % 16 * 4)) & 0xf) == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* End CountingBloomFilter class. */
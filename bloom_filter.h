@@ -0,0 +1,45 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Counting Bloom filter over strings: a set membership test which may answer yes for a string never added (with about the
+ * false positive rate it was sized for) but never answers no for one that was. Each string maps to num_hashes of the
+ * filter's 4-bit counters, derived from one 64-bit hash by double hashing; adding increments them, removing decrements
+ * them, and a string may be present only if all of its counters are nonzero. A counter that reaches 15 stays there, since
+ * it can no longer tell how many strings it counts, which can only cause false positives. */
+class CountingBloomFilter {
+	private:
+		vector<uint64_t> counters; // 16 counters per word
+		size_t num_counters;
+		int num_hashes;
+
+		void positions(string_view, size_t *) const;
+
+	public:
+		// Constructors
+
+		CountingBloomFilter(size_t, double = 0.01);
+
+		// Getters
+
+		int get_num_hashes(void) const;
+
+		size_t memory_bytes(void) const;
+
+		// Functionality
+
+		void add(string_view);
+
+		void remove(string_view);
+
+		bool possibly_contains(string_view) const;
+};
+
+#endif
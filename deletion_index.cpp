@@ -0,0 +1,235 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "deletion_index.h"
+
+using namespace std;
+
+/* Begin DeletionIndex class. */
+
+DeletionIndex::DeletionIndex(int max_distance /* = 2 */) : max_distance(max_distance), num_live(0), side_postings(0) {
+	if (max_distance < 0) {
+		throw runtime_error("Deletion index distance must be non-negative");
+	}
+}
+
+int DeletionIndex::get_max_distance(void) const { return this->max_distance; }
+
+size_t DeletionIndex::size(void) const { return this->num_live; }
+
+size_t DeletionIndex::memory_bytes(void) const {
+	size_t ret = this->table.capacity() * sizeof(Slot) + this->arena.capacity() * sizeof(uint32_t) + this->live.capacity() / 8;
+	for (const string &word : this->words) {
+		ret += sizeof(string) + (word.capacity() > 15 ? word.capacity() + 1 : 0);
+	}
+	ret += this->ids.size() * (sizeof(pair<string, uint32_t>) + 2 * sizeof(void *));
+	for (const auto &it : this->side_table) {
+		ret += sizeof(it) + 2 * sizeof(void *) + it.second.capacity() * sizeof(uint32_t);
+	}
+
+	return ret;
+}
+
+/* Static function. */
+uint64_t DeletionIndex::hash(string_view s) { return std::hash<string_view>()(s); }
+
+/* Stores in *v the given word and every distinct string obtained by deleting up to d of its characters. */
+void DeletionIndex::deletions(const string word, int d, vector<string> *v) const {
+	v->assign(1, word);
+	size_t level_start = 0;
+	for (int i = 0; i < d; ++i) {
+		size_t level_end = v->size();
+		for (size_t k = level_start; k < level_end; ++k) {
+			for (size_t j = 0; j < (*v)[k].length(); ++j) {
+				if (j > 0 && (*v)[k][j] == (*v)[k][j - 1]) {
+					continue; // Deleting either of a run of equal characters gives the same string
+				}
+				string variant = (*v)[k];
+				variant.erase(j, 1);
+				v->push_back(variant);
+			}
+		}
+
+		/* Strings at different levels have different lengths, so only this level can hold duplicates. */
+		sort(v->begin() + level_end, v->end());
+		v->erase(unique(v->begin() + level_end, v->end()), v->end());
+		level_start = level_end;
+	}
+}
+
+/* Rebuilds the flat table and arena from the live words, renumbering them and emptying the side table. */
+void DeletionIndex::rebuild(void) {
+	vector<string> words;
+	for (size_t id = 0; id < this->words.size(); ++id) {
+		if (this->live[id]) {
+			words.push_back(move(this->words[id]));
+		}
+	}
+
+	this->words = move(words);
+	this->live.assign(this->words.size(), true);
+	this->ids.clear();
+	for (size_t id = 0; id < this->words.size(); ++id) {
+		this->ids[this->words[id]] = id;
+	}
+	this->num_live = this->words.size();
+	this->side_table.clear();
+	this->side_postings = 0;
+
+	/* Gather (key, word ID) postings, grouped by key. */
+	vector<pair<uint64_t, uint32_t>> postings;
+	vector<string> variants;
+	for (size_t id = 0; id < this->words.size(); ++id) {
+		this->deletions(this->words[id], this->max_distance, &variants);
+		for (const string &variant : variants) {
+			postings.push_back(make_pair(hash(variant), id));
+		}
+	}
+	sort(postings.begin(), postings.end());
+	postings.erase(unique(postings.begin(), postings.end()), postings.end());
+	if (postings.size() > numeric_limits<uint32_t>::max()) {
+		throw runtime_error("Deletion index too large");
+	}
+
+	size_t num_keys = 0;
+	for (size_t i = 0; i < postings.size(); ++i) {
+		num_keys += i == 0 || postings[i].first != postings[i - 1].first;
+	}
+
+	size_t capacity = 16;
+	while (capacity < 2 * num_keys) {
+		capacity *= 2;
+	}
+	this->table.assign(capacity, Slot {0, 0, 0});
+	this->arena.resize(postings.size());
+	this->arena.shrink_to_fit();
+
+	for (size_t i = 0; i < postings.size();) {
+		size_t slot = postings[i].first & (capacity - 1);
+		while (this->table[slot].count != 0) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+
+		this->table[slot] = Slot {postings[i].first, (uint32_t) i, 0};
+		for (; i < postings.size() && postings[i].first == this->table[slot].key; ++i) {
+			this->arena[i] = postings[i].second;
+			++this->table[slot].count;
+		}
+	}
+}
+
+/* Replaces the contents of the index with the given words. */
+void DeletionIndex::build(const vector<string> &words) {
+	this->words.clear();
+	this->live.clear();
+	this->ids.clear();
+	for (const string &word : words) {
+		if (this->ids.find(word) == this->ids.end()) {
+			this->ids[word] = this->words.size();
+			this->words.push_back(word);
+			this->live.push_back(true);
+		}
+	}
+
+	this->rebuild();
+}
+
+/* Adds the word to the index, returning whether it was absent. */
+bool DeletionIndex::insert(const string word) {
+	auto it = this->ids.find(word);
+	if (it != this->ids.end()) {
+		if (this->live[it->second]) {
+			return false;
+		}
+
+		this->live[it->second] = true; // Its postings are still in place
+		++this->num_live;
+		return true;
+	}
+
+	uint32_t id = this->words.size();
+	this->ids[word] = id;
+	this->words.push_back(word);
+	this->live.push_back(true);
+	++this->num_live;
+
+	vector<string> variants;
+	this->deletions(word, this->max_distance, &variants);
+	for (const string &variant : variants) {
+		this->side_table[hash(variant)].push_back(id);
+	}
+	this->side_postings += variants.size();
+
+	if (this->side_postings > max(this->arena.size() / 4, (size_t) 1024)) {
+		this->rebuild();
+	}
+
+	return true;
+}
+
+/* Removes the word from the index, returning whether it was present. */
+bool DeletionIndex::remove(const string word) {
+	auto it = this->ids.find(word);
+	if (it == this->ids.end() || !this->live[it->second]) {
+		return false;
+	}
+
+	this->live[it->second] = false;
+	--this->num_live;
+	return true;
+}
+
+/* Returns the words of the index which may be within the given distance of the given word, in no particular order. Every
+ * word within the distance is returned, along with others which share a deletion variant with it, and the caller is
+ * expected to check the distances. */
+vector<string> DeletionIndex::candidates(const string word, int max_distance) const {
+	if (max_distance > this->max_distance) {
+		throw runtime_error("Deletion index built for distance " + to_string(this->max_distance) + ", queried for distance "
+			+ to_string(max_distance));
+	}
+
+	vector<string> variants;
+	this->deletions(word, max_distance, &variants);
+
+	vector<uint32_t> ids;
+	for (const string &variant : variants) {
+		uint64_t key = hash(variant);
+		if (!this->table.empty()) {
+			size_t mask = this->table.size() - 1;
+			for (size_t slot = key & mask; this->table[slot].count != 0; slot = (slot + 1) & mask) {
+				if (this->table[slot].key == key) {
+					const uint32_t *postings = this->arena.data() + this->table[slot].offset;
+					ids.insert(ids.end(), postings, postings + this->table[slot].count);
+					break;
+				}
+			}
+		}
+
+		auto it = this->side_table.find(key);
+		if (it != this->side_table.end()) {
+			ids.insert(ids.end(), it->second.begin(), it->second.end());
+		}
+	}
+
+	sort(ids.begin(), ids.end());
+	ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+	vector<string> ret;
+	for (uint32_t id : ids) {
+		const string &candidate = this->words[id];
+		if (this->live[id] && (int) candidate.length() - (int) word.length() <= max_distance
+			&& (int) word.length() - (int) candidate.length() <= max_distance) {
+			ret.push_back(candidate);
+		}
+	}
+
+	return ret;
+}
+
+/* End DeletionIndex class. */
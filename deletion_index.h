@@ -0,0 +1,72 @@
+#ifndef DELETION_INDEX_H
+#define DELETION_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Symmetric delete index (as in SymSpell) for finding the dictionary words within a small Levenshtein distance of a word.
+ * Any two strings within distance d of each other can both be reduced to a common string by deleting at most d
+ * characters from each, so the index maps every deletion variant of every word, up to max_distance deletions, to the
+ * words it came from; a query then looks up its own deletion variants and gets back a superset of its matches, which the
+ * caller verifies.
+ *
+ * Variants are keyed by a 64-bit hash in a flat, open-addressed table, whose slots point into one arena of word IDs.
+ * Words inserted after the last build go to a side table, and removed words are only marked dead; once the side table
+ * holds more than a quarter as many postings as the arena (and at least 1024), the next insert rebuilds both into the
+ * arena. Distinct variants whose hashes collide share a posting list, which only adds candidates. */
+class DeletionIndex {
+	private:
+		struct Slot {
+			uint64_t key; // Hash of the deletion variant
+			uint32_t offset; // First posting in the arena
+			uint32_t count; // 0 for an empty slot
+		};
+
+		int max_distance;
+		vector<string> words; // Indexed by word ID
+		vector<bool> live;
+		unordered_map<string, uint32_t> ids;
+		size_t num_live;
+
+		vector<Slot> table; // Size is a power of two, or zero before the first build
+		vector<uint32_t> arena;
+		unordered_map<uint64_t, vector<uint32_t>> side_table;
+		size_t side_postings;
+
+		static uint64_t hash(string_view);
+
+		void deletions(const string, int, vector<string> *) const;
+
+		void rebuild(void);
+
+	public:
+		// Constructors
+
+		DeletionIndex(int = 2);
+
+		// Getters
+
+		int get_max_distance(void) const;
+
+		size_t size(void) const;
+
+		size_t memory_bytes(void) const;
+
+		// Functionality
+
+		void build(const vector<string> &);
+
+		bool insert(const string);
+
+		bool remove(const string);
+
+		vector<string> candidates(const string, int) const;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include <string>
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "frozen_trie.h"
+#include "trie.h"
+#include "best_first.h"
+
+using namespace std;
+
+/* Begin FrozenTrie class. */
+
+/* Copies the given trie, laying out its top top_levels levels breadth first and the subtrees below them depth first,
+ * hottest first according to query_log if one is given. */
+FrozenTrie::FrozenTrie(const Trie &trie, int top_levels /* = 3 */, const vector<string> &query_log /* = vector<string>() */) {
+	/* Number the nodes of the trie breadth first, so that the children of node x are numbered first_children[x] onwards. */
+	vector<const Node *> order (1, &trie.root);
+	vector<char> labels (1, '\0');
+	vector<size_t> first_children, parents (1, 0);
+	vector<int> depths (1, 0);
+	for (size_t x = 0; x < order.size(); ++x) {
+		first_children.push_back(order.size());
+		for (const auto &it : order[x]->get_children()) {
+			order.push_back(it.second);
+			labels.push_back(it.first);
+			parents.push_back(x);
+			depths.push_back(depths[x] + 1);
+		}
+	}
+	first_children.push_back(order.size());
+
+	if (order.size() > numeric_limits<uint32_t>::max()) {
+		throw runtime_error("Trie too large to freeze");
+	}
+
+	auto num_children = [&](size_t x) { return first_children[x + 1] - first_children[x]; };
+
+	/* Maximum weight below each node, accumulated from the leaves up. */
+	vector<double> max_weights (order.size(), - numeric_limits<double>::infinity());
+	for (size_t x = order.size(); x-- > 0;) {
+		if (order[x]->is_end()) {
+			max_weights[x] = max(max_weights[x], order[x]->get_weight());
+		}
+		if (x > 0) {
+			max_weights[parents[x]] = max(max_weights[parents[x]], max_weights[x]);
+		}
+	}
+
+	/* Count how many logged queries pass through each node. */
+	vector<size_t> hits (order.size(), 0);
+	for (const string &query : query_log) {
+		size_t x = 0;
+		++hits[x];
+		for (size_t i = 0; i < query.length(); ++i) {
+			size_t c = first_children[x];
+			while (c < first_children[x + 1] && labels[c] != query[i]) {
+				++c;
+			}
+			if (c == first_children[x + 1]) {
+				break;
+			}
+			x = c;
+			++hits[x];
+		}
+	}
+
+	auto hottest_first = [&](vector<size_t> *v) {
+		stable_sort(v->begin(), v->end(), [&](size_t a, size_t b) { return hits[a] > hits[b]; });
+	};
+
+	/* Assign slots. Placing a node's children reserves a consecutive run of slots for them, in label order. */
+	vector<uint32_t> slots (order.size());
+	uint32_t next_slot = 1;
+	auto place_children = [&](size_t x) {
+		for (size_t c = first_children[x]; c < first_children[x + 1]; ++c) {
+			slots[c] = next_slot++;
+		}
+	};
+
+	slots[0] = 0;
+	vector<size_t> frontier; // Roots of the subtrees below the top levels
+	if (top_levels <= 0) {
+		frontier.push_back(0);
+	} else {
+		queue<size_t> top;
+		top.push(0);
+		while (!top.empty()) {
+			size_t x = top.front();
+			top.pop();
+
+			place_children(x);
+			for (size_t c = first_children[x]; c < first_children[x + 1]; ++c) {
+				if (depths[c] < top_levels) {
+					top.push(c);
+				} else {
+					frontier.push_back(c);
+				}
+			}
+		}
+	}
+
+	hottest_first(&frontier);
+	function<void (size_t)> place_subtree = [&](size_t x) {
+		place_children(x);
+
+		vector<size_t> children;
+		for (size_t c = first_children[x]; c < first_children[x + 1]; ++c) {
+			children.push_back(c);
+		}
+		hottest_first(&children);
+		for (size_t c : children) {
+			place_subtree(c);
+		}
+	};
+	for (size_t x : frontier) {
+		place_subtree(x);
+	}
+
+	this->nodes.resize(order.size());
+	for (size_t x = 0; x < order.size(); ++x) {
+		FrozenNode &node = this->nodes[slots[x]];
+		node.weight = order[x]->is_end() ? order[x]->get_weight() : 0;
+		node.max_weight = max_weights[x];
+		node.first_child = num_children(x) > 0 ? slots[first_children[x]] : 0;
+		node.num_children = num_children(x);
+		node.label = labels[x];
+		node.end = order[x]->is_end();
+	}
+}
+
+size_t FrozenTrie::num_nodes(void) const { return this->nodes.size(); }
+
+size_t FrozenTrie::memory_bytes(void) const { return this->nodes.capacity() * sizeof(FrozenNode); }
+
+/* Returns the slot of the child of the node in slot x along the given character, or -1 if there is none. */
+long FrozenTrie::child(size_t x, char c) const {
+	auto begin = this->nodes.begin() + this->nodes[x].first_child, end = begin + this->nodes[x].num_children;
+	auto it = lower_bound(begin, end, c, [](const FrozenNode &node, char c) { return node.label < c; });
+	return it != end && it->label == c ? it - this->nodes.begin() : -1;
+}
+
+/* Returns the slot of the node reached by the given word, or -1 if it leads off the trie. */
+long FrozenTrie::find(const string word) const {
+	long x = 0;
+	for (size_t i = 0; i < word.length() && x >= 0; ++i) {
+		x = this->child(x, word[i]);
+	}
+
+	return x;
+}
+
+bool FrozenTrie::contains(const string word) const {
+	long x = this->find(word);
+	return x >= 0 && this->nodes[x].end;
+}
+
+/* Returns the weight of the word, or -1 if it isn't present. */
+double FrozenTrie::get_weight(const string word) const {
+	long x = this->find(word);
+	return x >= 0 && this->nodes[x].end ? this->nodes[x].weight : -1;
+}
+
+/* Returns the top k words, ordered by descending weight, then alphabetically, which complete the given prefix, expanding
+ * subtrees best first by their maximum weight through best_first_completions. */
+vector<string> FrozenTrie::autocomplete(const string prefix, int k) const {
+	long start = this->find(prefix);
+	if (start < 0) {
+		return vector<string>();
+	}
+
+	return best_first_completions(prefix, start, this->nodes[start].max_weight, k,
+		[&](size_t x) { return string_view(&this->nodes[x].label, 1); },
+		[&](size_t x, auto word, auto child) {
+			const FrozenNode &node = this->nodes[x];
+			if (node.end) {
+				word(node.weight);
+			}
+			for (size_t c = node.first_child; c < node.first_child + node.num_children; ++c) {
+				child(c, this->nodes[c].max_weight);
+			}
+		});
+}
+
+/* Returns the words within the given Levenshtein distance of the given word, ordered by distance, then by descending
+ * weight, then alphabetically. */
+vector<string> FrozenTrie::autocorrect(const string word, int max_distance) const {
+	int num_columns = word.length() + 1;
+	vector<int> rows (num_columns);
+	for (int j = 0; j < num_columns; ++j) {
+		rows[j] = j;
+	}
+
+	vector<tuple<string, double, int>> suggestions;
+	string current;
+	for (size_t c = this->nodes[0].first_child; c < this->nodes[0].first_child + this->nodes[0].num_children; ++c) {
+		this->autocorrect_helper(&suggestions, word, c, &current, &rows, max_distance);
+	}
+
+	return Trie::rank_suggestions(word, suggestions);
+}
+
+/* Private helper function. Adds the row of the Levenshtein distance table for the node in slot x below the rows of its
+ * ancestors, one row per character of current, and recurses into its children while some entry stays within
+ * max_distance. */
+void FrozenTrie::autocorrect_helper(vector<tuple<string, double, int>> *v, const string word, size_t x, string *current, vector<int> *rows,
+	int max_distance) const {
+	int num_columns = word.length() + 1;
+	size_t depth = current->length();
+	if (rows->size() < (depth + 2) * num_columns) {
+		rows->resize((depth + 2) * num_columns);
+	}
+
+	const int *prev_row = rows->data() + depth * num_columns;
+	int *curr_row = rows->data() + (depth + 1) * num_columns;
+	const FrozenNode &node = this->nodes[x];
+
+	curr_row[0] = prev_row[0] + 1;
+	int min_dist = curr_row[0];
+	for (int j = 1; j < num_columns; ++j) {
+		curr_row[j] = min(min(curr_row[j - 1], prev_row[j]) + 1, prev_row[j - 1] + (word[j - 1] == node.label ? 0 : 1));
+		min_dist = min(min_dist, curr_row[j]);
+	}
+
+	current->push_back(node.label);
+	if (node.end && curr_row[num_columns - 1] <= max_distance) {
+		v->push_back(make_tuple(*current, node.weight, curr_row[num_columns - 1]));
+	}
+
+	if (min_dist <= max_distance) {
+		for (size_t c = node.first_child; c < node.first_child + node.num_children; ++c) {
+			this->autocorrect_helper(v, word, c, current, rows, max_distance);
+		}
+	}
+	current->pop_back();
+}
+
+/* End FrozenTrie class. */
@@ -0,0 +1,67 @@
+#ifndef FROZEN_TRIE_H
+#define FROZEN_TRIE_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <cstdint>
+#include <cstddef>
+#include "trie.h"
+
+using namespace std;
+
+/* Read-only copy of a built Trie with every node relocated into one array, in an order chosen so that the nodes a query
+ * visits together sit close together in memory. Node::insert allocates each node separately, in insertion order, so the
+ * top of a trie built from an alphabetical word list ends up spread across the whole heap.
+ *
+ * The children of a node always occupy consecutive slots, sorted by label, so that a lookup reads one contiguous group.
+ * The groups of the top top_levels levels, which every query passes through, are laid out breadth first at the front of
+ * the array. Each subtree below them is then laid out depth first, group after group, so a walk down it moves forward
+ * through one region instead of jumping between levels. With top_levels = 0 the whole trie is depth first; with a value
+ * past the longest word, breadth first.
+ *
+ * Given a log of past queries, the subtrees are placed hottest first, both among the subtrees below the top levels and
+ * among the children of each node, so that frequently typed prefixes share cache lines and pages with each other. Sibling
+ * groups stay sorted by label; only the order of the regions they lead to changes. */
+class FrozenTrie {
+	private:
+		struct FrozenNode {
+			double weight;
+			double max_weight; // Maximum weight of the words at or below this node, -infinity if there are none
+			uint32_t first_child; // Slot of the first child; the others follow it
+			uint16_t num_children;
+			char label; // Character on the edge into this node
+			bool end;
+		};
+
+		vector<FrozenNode> nodes; // nodes[0] is the root
+
+		long child(size_t, char) const;
+
+		long find(const string) const;
+
+		void autocorrect_helper(vector<tuple<string, double, int>> *, const string, size_t, string *, vector<int> *, int) const;
+
+	public:
+		// Constructors
+
+		FrozenTrie(const Trie &, int = 3, const vector<string> & = vector<string>());
+
+		// Getters
+
+		size_t num_nodes(void) const;
+
+		size_t memory_bytes(void) const;
+
+		// Functionality
+
+		bool contains(const string) const;
+
+		double get_weight(const string) const;
+
+		vector<string> autocomplete(const string, int) const;
+
+		vector<string> autocorrect(const string, int) const;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include "hyperparameter_search.h"
+
+using namespace std;
+
+string optimizer_name(OptimizerKind kind) {
+	switch (kind) {
+		case SGD_OPTIMIZER:
+			return "sgd";
+		case MOMENTUM_OPTIMIZER:
+			return "momentum";
+		case NESTEROV_OPTIMIZER:
+			return "nesterov";
+		case ADAM_OPTIMIZER:
+			return "adam";
+		case BOLD_DRIVER_OPTIMIZER:
+			return "bold driver";
+	}
+
+	throw runtime_error("Unknown optimizer");
+}
+
+/* Begin NetworkConfiguration struct. */
+
+string NetworkConfiguration::to_string(void) const {
+	ostringstream description;
+	description << "hidden {";
+	for (size_t i = 0; i < this->hidden_layers.size(); ++i) {
+		description << (i > 0 ? ", " : "") << this->hidden_layers[i];
+	}
+	description << "}, " << optimizer_name(this->optimizer) << ", learning rate " << this->learning_rate << ", batch "
+				<< this->batch_size;
+
+	return description.str();
+}
+
+/* End NetworkConfiguration struct. */
+
+/* Begin HyperparameterSearch class. */
+
+HyperparameterSearch::Candidate::Candidate(const NetworkConfiguration &configuration, int *layer_counts, int num_layers)
+	: configuration(configuration), net(layer_counts, num_layers) {
+	this->optimizer = HyperparameterSearch::make_optimizer(configuration.optimizer, configuration.learning_rate);
+	this->trainer.reset(new Trainer(this->net, *this->optimizer, configuration.batch_size, 1));
+	this->result.configuration = configuration;
+	this->result.validation_error = 0.0;
+	this->result.epochs = 0;
+	this->result.training_seconds = 0.0;
+}
+
+HyperparameterSearch::HyperparameterSearch(int num_threads) : pool(num_threads) {}
+
+unique_ptr<Optimizer> HyperparameterSearch::make_optimizer(OptimizerKind kind, double learning_rate) {
+	switch (kind) {
+		case SGD_OPTIMIZER:
+			return unique_ptr<Optimizer>(new SGD(learning_rate));
+		case MOMENTUM_OPTIMIZER:
+			return unique_ptr<Optimizer>(new Momentum(learning_rate));
+		case NESTEROV_OPTIMIZER:
+			return unique_ptr<Optimizer>(new Momentum(learning_rate, 0.9, true));
+		case ADAM_OPTIMIZER:
+			return unique_ptr<Optimizer>(new Adam(learning_rate));
+		case BOLD_DRIVER_OPTIMIZER:
+			return unique_ptr<Optimizer>(new BoldDriver(learning_rate));
+	}
+
+	throw runtime_error("Unknown optimizer");
+}
+
+void HyperparameterSearch::add_topology(const vector<int> hidden_layers) { this->topologies.push_back(hidden_layers); }
+
+void HyperparameterSearch::add_optimizer(OptimizerKind kind) { this->optimizers.push_back(kind); }
+
+void HyperparameterSearch::add_learning_rate(double learning_rate) {
+	if (learning_rate <= 0.0) {
+		throw runtime_error("Learning rate must be positive");
+	}
+
+	this->learning_rates.push_back(learning_rate);
+}
+
+void HyperparameterSearch::add_batch_size(int batch_size) {
+	if (batch_size <= 0) {
+		throw runtime_error("Batch size must be positive");
+	}
+
+	this->batch_sizes.push_back(batch_size);
+}
+
+/* Size of the grid; a dimension left empty counts as its single default value. */
+int HyperparameterSearch::num_configurations(void) const {
+	return max((size_t) 1, this->topologies.size()) * max((size_t) 1, this->optimizers.size())
+		 * max((size_t) 1, this->learning_rates.size()) * max((size_t) 1, this->batch_sizes.size());
+}
+
+/* Runs successive halving over every configuration of the grid. The first rung trains each configuration for min_epochs
+ * epochs, and each later rung keeps the best 1/eta of the survivors and trains them until they have seen eta times as many
+ * epochs as in the previous rung, continuing the same networks rather than restarting them. The search ends when a single
+ * configuration is left or max_epochs is reached. Dimensions of the space that were never given default to one hidden
+ * layer of 10 units, Adam, a learning rate of 0.01 and batches of 32.
+ *
+ * Returns a result for every configuration, best first: configurations that survived longer rank ahead of those stopped
+ * earlier, and ties are broken by validation error, so the front is the winner of the final rung. */
+vector<SearchResult> HyperparameterSearch::search(const vector<pair<ARRAY, ARRAY>> &training,
+	const vector<pair<ARRAY, ARRAY>> &validation, int min_epochs /* = 1 */, int eta /* = 3 */, int max_epochs /* = 100 */) {
+	if (training.empty() || validation.empty()) {
+		throw runtime_error("Search needs both training and validation samples");
+	} else if (min_epochs <= 0 || eta < 2 || max_epochs < min_epochs) {
+		throw runtime_error("Invalid successive halving schedule");
+	}
+
+	vector<vector<int>> topologies = this->topologies.empty() ? vector<vector<int>>(1, vector<int>(1, 10)) : this->topologies;
+	vector<OptimizerKind> optimizers = this->optimizers.empty() ? vector<OptimizerKind>(1, ADAM_OPTIMIZER) : this->optimizers;
+	vector<double> learning_rates = this->learning_rates.empty() ? vector<double>(1, 0.01) : this->learning_rates;
+	vector<int> batch_sizes = this->batch_sizes.empty() ? vector<int>(1, 32) : this->batch_sizes;
+
+	/* Build every candidate up front, on this thread, since network initialization and the trainers' shuffling seeds
+	 * draw from rand(). */
+	int inputs = training[0].first.size(), outputs = training[0].second.size();
+	vector<unique_ptr<Candidate>> candidates;
+	for (const vector<int> &hidden_layers : topologies) {
+		vector<int> layer_counts (1, inputs);
+		layer_counts.insert(layer_counts.end(), hidden_layers.begin(), hidden_layers.end());
+		layer_counts.push_back(outputs);
+
+		for (OptimizerKind optimizer : optimizers) {
+			for (double learning_rate : learning_rates) {
+				for (int batch_size : batch_sizes) {
+					NetworkConfiguration configuration = {hidden_layers, optimizer, learning_rate, batch_size};
+					candidates.push_back(unique_ptr<Candidate>(new Candidate(configuration, layer_counts.data(), layer_counts.size())));
+				}
+			}
+		}
+	}
+
+	vector<Candidate *> survivors;
+	for (const unique_ptr<Candidate> &candidate : candidates) {
+		survivors.push_back(candidate.get());
+	}
+
+	for (int target = min_epochs; ; target = min(target * eta, max_epochs)) {
+		this->pool.parallel_for(survivors.size(), [&](int i, int) {
+			Candidate &candidate = *survivors[i];
+			auto start = chrono::steady_clock::now();
+			candidate.trainer->train(training, target - candidate.result.epochs);
+			candidate.result.training_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			candidate.result.epochs = target;
+			candidate.result.validation_error = candidate.net.error(validation);
+		});
+
+		/* Diverged networks produce NaN errors, which must sort last rather than poison the comparison. */
+		sort(survivors.begin(), survivors.end(), [](const Candidate *a, const Candidate *b) {
+			double x = a->result.validation_error, y = b->result.validation_error;
+			return x == x && (y != y || x < y);
+		});
+
+		if (survivors.size() == 1 || target >= max_epochs) {
+			break;
+		}
+		survivors.resize((survivors.size() + eta - 1) / eta);
+	}
+
+	vector<SearchResult> results;
+	for (const unique_ptr<Candidate> &candidate : candidates) {
+		results.push_back(candidate->result);
+	}
+	stable_sort(results.begin(), results.end(), [](const SearchResult &a, const SearchResult &b) {
+		if (a.epochs != b.epochs) {
+			return a.epochs > b.epochs;
+		}
+		double x = a.validation_error, y = b.validation_error;
+		return x == x && (y != y || x < y);
+	});
+
+	return results;
+}
+
+/* End HyperparameterSearch class. */
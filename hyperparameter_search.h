@@ -0,0 +1,86 @@
+#ifndef HYPERPARAMETER_SEARCH_H
+#define HYPERPARAMETER_SEARCH_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <memory>
+#include <thread>
+#include "neural_network.h"
+#include "trainer.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+enum OptimizerKind { SGD_OPTIMIZER, MOMENTUM_OPTIMIZER, NESTEROV_OPTIMIZER, ADAM_OPTIMIZER, BOLD_DRIVER_OPTIMIZER };
+
+/* One point of the search space. hidden_layers lists the hidden layer sizes only; the input and output sizes come from the
+ * data. */
+struct NetworkConfiguration {
+	vector<int> hidden_layers;
+	OptimizerKind optimizer;
+	double learning_rate;
+	int batch_size;
+
+	string to_string(void) const;
+};
+
+/* Outcome of one configuration: the validation error (MSE) it reached, how many epochs it was trained before being stopped
+ * or winning, and the wall-clock seconds spent training it. */
+struct SearchResult {
+	NetworkConfiguration configuration;
+	double validation_error;
+	int epochs;
+	double training_seconds;
+};
+
+/* Grid search over network topologies and optimizer settings with successive halving. Every configuration in the grid is
+ * trained for a few epochs, the best 1/eta of them by validation error keep training for eta times as many epochs, and so
+ * on until one is left or the epoch budget is spent. Candidates train in parallel, one per thread, over training and
+ * validation samples that are shared read-only between threads. */
+class HyperparameterSearch {
+	private:
+		struct Candidate {
+			NetworkConfiguration configuration;
+			NeuralNetwork net;
+			unique_ptr<Optimizer> optimizer;
+			unique_ptr<Trainer> trainer;
+			SearchResult result;
+
+			Candidate(const NetworkConfiguration &, int *, int);
+		};
+
+		vector<vector<int>> topologies;
+		vector<OptimizerKind> optimizers;
+		vector<double> learning_rates;
+		vector<int> batch_sizes;
+		ThreadPool pool;
+
+		static unique_ptr<Optimizer> make_optimizer(OptimizerKind, double);
+
+	public:
+		// Constructors
+
+		HyperparameterSearch(int = thread::hardware_concurrency());
+
+		// Search space
+
+		void add_topology(const vector<int>);
+
+		void add_optimizer(OptimizerKind);
+
+		void add_learning_rate(double);
+
+		void add_batch_size(int);
+
+		int num_configurations(void) const;
+
+		// Functionality
+
+		vector<SearchResult> search(const vector<pair<ARRAY, ARRAY>> &, const vector<pair<ARRAY, ARRAY>> &, int = 1, int = 3,
+			int = 100);
+};
+
+string optimizer_name(OptimizerKind);
+
+#endif
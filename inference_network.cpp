@@ -0,0 +1,297 @@
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+#include "inference_network.h"
+
+using namespace std;
+
+static inline float sigmoid(float x) { return 1.0f / (1.0f + expf(-x)); }
+
+/* Dot product of two float rows whose length n is a multiple of InferenceNetwork::lane_width. */
+static inline float dot(const float *a, const float *b, int n) {
+#if defined(__AVX2__) && defined(__FMA__)
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+	for (int i = 0; i < n; i += 16) {
+		sum0 = _mm256_fmadd_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i), sum0);
+		sum1 = _mm256_fmadd_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8), sum1);
+	}
+
+	__m256 sum = _mm256_add_ps(sum0, sum1);
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+	return _mm_cvtss_f32(half);
+#else
+	/* Separate partial sums, so that consecutive additions don't wait on each other. */
+	float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	for (int i = 0; i < n; i += 4) {
+		for (int j = 0; j < 4; ++j) {
+			sum[j] += a[i + j] * b[i + j];
+		}
+	}
+
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+}
+
+/* Dot product of a row of int8 weights with a row of activations in [0, 127], n being a multiple of
+ * InferenceNetwork::lane_width. */
+static inline int32_t dot(const int8_t *weights, const uint8_t *activations, int n) {
+#if defined(__AVX2__) && defined(__FMA__)
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+	for (int i = 0; i < n; i += 32) {
+		__m256i pairs = _mm256_maddubs_epi16(_mm256_load_si256((const __m256i *) (activations + i)), _mm256_load_si256((const __m256i *) (weights + i)));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+	}
+
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(half);
+#else
+	int32_t sum[4] = {0, 0, 0, 0};
+	for (int i = 0; i < n; i += 4) {
+		for (int j = 0; j < 4; ++j) {
+			sum[j] += (int32_t) weights[i + j] * activations[i + j];
+		}
+	}
+
+	return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
+}
+
+/* Smallest and largest of n floats, n being a multiple of InferenceNetwork::lane_width. */
+static inline void value_range(const float *x, int n, float *lowest, float *highest) {
+#if defined(__AVX2__) && defined(__FMA__)
+	__m256 low = _mm256_load_ps(x), high = low;
+	for (int i = 8; i < n; i += 8) {
+		__m256 v = _mm256_load_ps(x + i);
+		low = _mm256_min_ps(low, v);
+		high = _mm256_max_ps(high, v);
+	}
+
+	__m128 low_half = _mm_min_ps(_mm256_castps256_ps128(low), _mm256_extractf128_ps(low, 1));
+	__m128 high_half = _mm_max_ps(_mm256_castps256_ps128(high), _mm256_extractf128_ps(high, 1));
+	low_half = _mm_min_ps(low_half, _mm_movehl_ps(low_half, low_half));
+	high_half = _mm_max_ps(high_half, _mm_movehl_ps(high_half, high_half));
+	*lowest = _mm_cvtss_f32(_mm_min_ss(low_half, _mm_shuffle_ps(low_half, low_half, 1)));
+	*highest = _mm_cvtss_f32(_mm_max_ss(high_half, _mm_shuffle_ps(high_half, high_half, 1)));
+#else
+	*lowest = *highest = x[0];
+	for (int i = 1; i < n; ++i) {
+		*lowest = min(*lowest, x[i]);
+		*highest = max(*highest, x[i]);
+	}
+#endif
+}
+
+/* Maps each of n floats x to the nearest integer to (x - offset) * inverse_scale, clamped to [0, 127], n being a multiple
+ * of InferenceNetwork::lane_width. */
+static inline void quantize(const float *x, int n, float offset, float inverse_scale, uint8_t *ret) {
+#if defined(__AVX2__) && defined(__FMA__)
+	const __m256 scale = _mm256_set1_ps(inverse_scale), shift = _mm256_set1_ps(-offset * inverse_scale);
+	const __m256i limit = _mm256_set1_epi8(127);
+	for (int i = 0; i < n; i += 32) {
+		__m256i a = _mm256_cvtps_epi32(_mm256_fmadd_ps(_mm256_load_ps(x + i), scale, shift));
+		__m256i b = _mm256_cvtps_epi32(_mm256_fmadd_ps(_mm256_load_ps(x + i + 8), scale, shift));
+		__m256i c = _mm256_cvtps_epi32(_mm256_fmadd_ps(_mm256_load_ps(x + i + 16), scale, shift));
+		__m256i d = _mm256_cvtps_epi32(_mm256_fmadd_ps(_mm256_load_ps(x + i + 24), scale, shift));
+
+		/* The packs interleave the 128-bit lanes of their operands; one permute at the end puts them back in order. */
+		__m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+		bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+		_mm256_store_si256((__m256i *) (ret + i), _mm256_min_epu8(bytes, limit));
+	}
+#else
+	for (int i = 0; i < n; ++i) {
+		ret[i] = (uint8_t) (max(0.0f, min(127.0f, (x[i] - offset) * inverse_scale)) + 0.5f);
+	}
+#endif
+}
+
+/* Logit of a threshold on the output of a sigmoid, so that sigmoid(z) < threshold exactly when z < logit(threshold). */
+static float logit(double threshold) {
+	if (threshold <= 0.0) {
+		return -numeric_limits<float>::infinity();
+	} else if (threshold >= 1.0) {
+		return numeric_limits<float>::infinity();
+	}
+
+	return log(threshold / (1.0 - threshold));
+}
+
+/* Begin InferenceNetwork class. */
+
+/* Freezes net at the given precision. Outputs below lower_threshold classify as -1, those above upper_threshold as 1, and
+ * the rest as 0; the thresholds apply to the first output. */
+InferenceNetwork::InferenceNetwork(const NeuralNetwork &net, Precision precision /* = FLOAT32 */,
+	double lower_threshold /* = 0.5 */, double upper_threshold /* = 0.5 */) : precision(precision) {
+	if (lower_threshold > upper_threshold) {
+		throw runtime_error("Lower threshold exceeds upper threshold");
+	}
+
+	this->lower_logit = logit(lower_threshold);
+	this->upper_logit = logit(upper_threshold);
+
+	int widest = 0;
+	for (int l = 0; l < net.num_layers(); ++l) {
+		this->layer_counts.push_back(net.layer_size(l));
+		this->padded_counts.push_back((net.layer_size(l) + lane_width - 1) / lane_width * lane_width);
+		widest = max(widest, this->padded_counts.back());
+	}
+
+	const double *parameters = net.get_parameters();
+	size_t source = 0, weight_count = 0;
+	for (int l = 0; l + 1 < net.num_layers(); ++l) {
+		int in = this->layer_counts[l], out = this->layer_counts[l + 1], stride = this->padded_counts[l];
+		this->weight_offsets.push_back(weight_count);
+		this->bias_offsets.push_back(this->biases.size());
+		weight_count += (size_t) out * stride;
+
+		if (precision == FLOAT32) {
+			this->weights.resize(weight_count, 0.0f);
+		} else {
+			this->quantized_weights.resize(weight_count, 0);
+		}
+
+		/* The source layer is (in x out) and the rows here are (out x in), so transpose while copying. */
+		for (int j = 0; j < out; ++j) {
+			size_t row = this->weight_offsets[l] + (size_t) j * stride;
+
+			if (precision == FLOAT32) {
+				for (int i = 0; i < in; ++i) {
+					this->weights[row + i] = parameters[source + (size_t) i * out + j];
+				}
+			} else {
+				double largest = 0.0;
+				for (int i = 0; i < in; ++i) {
+					largest = max(largest, abs(parameters[source + (size_t) i * out + j]));
+				}
+
+				float scale = largest > 0.0 ? largest / 127.0 : 1.0f;
+				for (int i = 0; i < in; ++i) {
+					this->quantized_weights[row + i] = max(-127.0, min(127.0, nearbyint(parameters[source + (size_t) i * out + j] / scale)));
+				}
+				this->scales.push_back(scale);
+				this->row_sums.push_back(accumulate(&this->quantized_weights[row], &this->quantized_weights[row] + in, 0));
+			}
+		}
+		source += (size_t) in * out;
+
+		for (int j = 0; j < out; ++j) {
+			this->biases.push_back(parameters[source + j]);
+		}
+		source += out;
+	}
+
+	this->activations[0].assign(widest, 0.0f);
+	this->activations[1].assign(widest, 0.0f);
+	if (precision == INT8) {
+		this->quantized_activations.assign(widest, 0);
+	}
+	this->pre_activations.assign(this->output_size(), 0.0f);
+}
+
+InferenceNetwork::Precision InferenceNetwork::get_precision(void) const { return this->precision; }
+
+int InferenceNetwork::input_size(void) const { return this->layer_counts.front(); }
+
+int InferenceNetwork::output_size(void) const { return this->layer_counts.back(); }
+
+/* Bytes taken by the frozen parameters. */
+size_t InferenceNetwork::memory_size(void) const {
+	return this->weights.size() * sizeof(float) + this->quantized_weights.size() * sizeof(int8_t)
+		 + (this->scales.size() + this->biases.size()) * sizeof(float) + this->row_sums.size() * sizeof(int);
+}
+
+/* Runs every layer on one input sample, leaving the weighted inputs of the output layer in pre_activations. Padding past
+ * the end of each layer's activations is kept at zero so that it drops out of the padded dot products. */
+void InferenceNetwork::weighted_inputs(const double *input) {
+	int num_layers = this->layer_counts.size();
+	float *current = this->activations[0].data(), *next = this->activations[1].data();
+	uint8_t *quantized = this->quantized_activations.data();
+	float input_scale = 1.0f, input_offset = 0.0f; // An activation x is quantized as (x - input_offset) / input_scale
+
+	for (int i = 0; i < this->input_size(); ++i) {
+		current[i] = input[i];
+	}
+	fill(current + this->input_size(), current + this->padded_counts[0], 0.0f);
+
+	if (this->precision == INT8) {
+		float lowest, highest;
+		value_range(current, this->padded_counts[0], &lowest, &highest);
+		input_scale = highest > lowest ? (highest - lowest) / 127.0f : 1.0f;
+		input_offset = lowest;
+		quantize(current, this->padded_counts[0], input_offset, 1.0f / input_scale, quantized);
+	}
+
+	for (int l = 0; l + 1 < num_layers; ++l) {
+		int out = this->layer_counts[l + 1], stride = this->padded_counts[l];
+		bool last = l + 2 == num_layers;
+		const float *bias = &this->biases[this->bias_offsets[l]];
+		float *destination = last ? this->pre_activations.data() : next;
+
+		if (this->precision == FLOAT32) {
+			const float *row = &this->weights[this->weight_offsets[l]];
+			for (int j = 0; j < out; ++j, row += stride) {
+				destination[j] = dot(row, current, stride) + bias[j];
+			}
+		} else {
+			const int8_t *row = &this->quantized_weights[this->weight_offsets[l]];
+			const float *scale = &this->scales[this->bias_offsets[l]];
+			const int *row_sum = &this->row_sums[this->bias_offsets[l]];
+			for (int j = 0; j < out; ++j, row += stride) {
+				destination[j] = (dot(row, quantized, stride) * input_scale + row_sum[j] * input_offset) * scale[j] + bias[j];
+			}
+		}
+
+		if (last) {
+			break;
+		}
+
+		/* Hidden layer: apply the sigmoid, then hand the result to the next layer in its working precision. */
+		int padded = this->padded_counts[l + 1];
+		if (this->precision == FLOAT32) {
+			for (int j = 0; j < out; ++j) {
+				next[j] = sigmoid(next[j]);
+			}
+			fill(next + out, next + padded, 0.0f);
+			swap(current, next);
+		} else {
+			for (int j = 0; j < out; ++j) {
+				next[j] = sigmoid(next[j]);
+			}
+			fill(next + out, next + padded, 0.0f);
+			quantize(next, padded, 0.0f, 127.0f, quantized);
+			input_scale = 1.0f / 127.0f;
+			input_offset = 0.0f;
+		}
+	}
+}
+
+/* Writes the network's output_size() outputs for one input sample of input_size() values. */
+void InferenceNetwork::feedforward(const double *input, double *output) {
+	this->weighted_inputs(input);
+	for (int j = 0; j < this->output_size(); ++j) {
+		output[j] = sigmoid(this->pre_activations[j]);
+	}
+}
+
+/* Returns 1 if the first output for the given input sample is above the upper threshold, -1 if it is below the lower
+ * threshold, and 0 otherwise, without evaluating the output sigmoid. */
+int InferenceNetwork::classify(const double *input) {
+	this->weighted_inputs(input);
+
+	float z = this->pre_activations[0];
+	return z > this->upper_logit ? 1 : (z < this->lower_logit ? -1 : 0);
+}
+
+/* End InferenceNetwork class. */
@@ -0,0 +1,75 @@
+#ifndef INFERENCE_NETWORK_H
+#define INFERENCE_NETWORK_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "neural_network.h"
+#include "matrix.h"
+
+using namespace std;
+
+/* Read-only copy of a trained NeuralNetwork for serving, with float32 or int8 weights. Each layer is stored as one row of
+ * weights per output unit, padded to a multiple of lane_width, so that every unit is a single contiguous dot product.
+ *
+ * In int8 mode each weight row is quantized symmetrically to [-127, 127] with its own scale, and each layer's input to
+ * unsigned 7-bit values: the network's input over its range in every sample, and hidden activations, being sigmoids in
+ * (0, 1), with the fixed scale 1/127. Each unit is then an integer dot product, which with 7-bit activations can't
+ * overflow the 16-bit pairwise sums of AVX2's multiply-add, and is mapped back to a real value once, using its row's
+ * scale and the sum of its quantized weights to undo the input's offset.
+ *
+ * classify fuses the last sigmoid into the thresholds: since the sigmoid is monotonic, comparing the output unit's
+ * weighted input against the logits of the thresholds gives the same answer without evaluating it.
+ *
+ * All scratch space is allocated up front, so no call allocates; as a result, an object must not be used by two threads
+ * at once, but it may be copied, one copy per thread. */
+class InferenceNetwork {
+	public:
+		enum Precision { FLOAT32, INT8 };
+
+		static const int lane_width = 32; // Row padding, in elements
+
+	private:
+		Precision precision;
+		vector<int> layer_counts;
+		vector<int> padded_counts; // layer_counts rounded up to a multiple of lane_width
+		vector<size_t> weight_offsets; // Start of the rows feeding layer l + 1 from layer l, for each l
+		vector<size_t> bias_offsets; // Start of the biases of layer l + 1, for each l
+
+		vector<float, AlignedAllocator<float>> weights; // FLOAT32 only
+		vector<int8_t, AlignedAllocator<int8_t>> quantized_weights; // INT8 only
+		vector<float> scales; // INT8 only: dequantization scale of every weight row, indexed like biases
+		vector<int> row_sums; // INT8 only: sum of every row of quantized weights, indexed like biases
+		vector<float> biases;
+
+		float lower_logit, upper_logit;
+
+		vector<float, AlignedAllocator<float>> activations[2]; // Scratch: the input and output of the current layer
+		vector<uint8_t, AlignedAllocator<uint8_t>> quantized_activations; // Scratch: the input of the current layer, in INT8
+		vector<float> pre_activations; // Scratch: weighted inputs of the output layer
+
+		void weighted_inputs(const double *);
+
+	public:
+		// Constructors
+
+		InferenceNetwork(const NeuralNetwork &, Precision = FLOAT32, double = 0.5, double = 0.5);
+
+		// Getters
+
+		Precision get_precision(void) const;
+
+		int input_size(void) const;
+
+		int output_size(void) const;
+
+		size_t memory_size(void) const;
+
+		// Functionality
+
+		void feedforward(const double *, double *);
+
+		int classify(const double *);
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <cstring>
+#include "instrumentation.h"
+
+using namespace std;
+
+/* Adds to an atomic that only the calling thread writes, without the cost of a locked read-modify-write. */
+static inline void add_relaxed(atomic<uint64_t> *a, uint64_t n) {
+	a->store(a->load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static const char *query_names[NUM_QUERY_KINDS] = {"autocomplete", "autocorrect", "fuzzy_autocomplete", "probability"};
+
+static const char *counter_names[NUM_COUNTERS] = {"nodes_visited", "dp_rows", "heap_pushes", "candidates", "allocations",
+	"allocated_bytes"};
+
+static thread_local QueryStats current_query; // Counters of the query open on this thread
+static thread_local int scope_depth = 0;
+
+/* Every thread's data, kept alive after the thread exits so that its counts still appear in reports. */
+static mutex registry_mutex;
+static vector<shared_ptr<Instrumentation::ThreadData>> registry;
+
+/* Begin LatencyHistogram class. */
+
+LatencyHistogram::LatencyHistogram(void) {
+	for (int i = 0; i < num_buckets; ++i) {
+		this->buckets[i].store(0, memory_order_relaxed);
+	}
+	this->total_nanoseconds.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count(int bucket) const { return this->buckets[bucket].load(memory_order_relaxed); }
+
+uint64_t LatencyHistogram::sum(void) const { return this->total_nanoseconds.load(memory_order_relaxed); }
+
+/* Static function. Values below 16 get a bucket each; above, the two bits below the leading one pick one of four buckets
+ * for its power of two. */
+int LatencyHistogram::bucket_of(uint64_t nanoseconds) {
+	if (nanoseconds < 16) {
+		return nanoseconds;
+	}
+
+	int exponent = 63 - __builtin_clzll(nanoseconds);
+	return 16 + (exponent - 4) * 4 + ((nanoseconds >> (exponent - 2)) & 3);
+}
+
+/* Static function. Returns the largest value falling in the given bucket. */
+uint64_t LatencyHistogram::upper_bound(int bucket) {
+	if (bucket < 16) {
+		return bucket;
+	}
+
+	int exponent = (bucket - 16) / 4 + 4, quarter = (bucket - 16) % 4;
+	return ((uint64_t) (5 + quarter) << (exponent - 2)) - 1; // Wraps to the largest uint64_t for the last bucket
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+	add_relaxed(&this->buckets[bucket_of(nanoseconds)], 1);
+	add_relaxed(&this->total_nanoseconds, nanoseconds);
+}
+
+/* End LatencyHistogram class. */
+
+/* Begin Instrumentation class. */
+
+Instrumentation::ThreadData::ThreadData(void) {
+	for (int k = 0; k < NUM_QUERY_KINDS; ++k) {
+		this->queries[k].store(0, memory_order_relaxed);
+		for (int c = 0; c < NUM_COUNTERS; ++c) {
+			this->totals[k][c].store(0, memory_order_relaxed);
+		}
+	}
+	memset(&this->last_query, 0, sizeof(this->last_query));
+}
+
+Instrumentation::QueryScope::QueryScope(QueryKind kind) : outermost(scope_depth++ == 0) {
+	if (this->outermost) {
+		memset(&current_query, 0, sizeof(current_query));
+		current_query.kind = kind;
+		this->start = chrono::steady_clock::now();
+	}
+}
+
+Instrumentation::QueryScope::~QueryScope(void) {
+	--scope_depth;
+	if (!this->outermost) {
+		return;
+	}
+
+	current_query.nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - this->start).count();
+
+	ThreadData &data = thread_data();
+	data.latencies[current_query.kind].record(current_query.nanoseconds);
+	add_relaxed(&data.queries[current_query.kind], 1);
+	for (int c = 0; c < NUM_COUNTERS; ++c) {
+		add_relaxed(&data.totals[current_query.kind][c], current_query.counters[c]);
+	}
+	data.last_query = current_query;
+}
+
+/* Returns the calling thread's data, registering it on first use. */
+Instrumentation::ThreadData & Instrumentation::thread_data(void) {
+	static thread_local shared_ptr<ThreadData> data;
+	if (!data) {
+		data = make_shared<ThreadData>();
+		lock_guard<mutex> lock (registry_mutex);
+		registry.push_back(data);
+	}
+
+	return *data;
+}
+
+const char * Instrumentation::query_name(QueryKind kind) { return query_names[kind]; }
+
+const char * Instrumentation::counter_name(Counter counter) { return counter_names[counter]; }
+
+/* Returns the counters and latency of the last query completed on the calling thread. */
+QueryStats Instrumentation::last_query(void) { return thread_data().last_query; }
+
+/* Adds n to the given counter of the query open on the calling thread, if there is one. */
+void Instrumentation::count(Counter counter, uint64_t n) {
+	if (scope_depth > 0) {
+		current_query.counters[counter] += n;
+	}
+}
+
+/* Returns an upper bound, within 25%, on the given percentile (from 0 to 100) of the latencies of the given kind of query
+ * across all threads, in nanoseconds, or 0 if there have been none. */
+uint64_t Instrumentation::percentile(QueryKind kind, double p) {
+	vector<uint64_t> counts (LatencyHistogram::num_buckets, 0);
+	uint64_t total = 0;
+	{
+		lock_guard<mutex> lock (registry_mutex);
+		for (const shared_ptr<ThreadData> &data : registry) {
+			for (int b = 0; b < LatencyHistogram::num_buckets; ++b) {
+				counts[b] += data->latencies[kind].count(b);
+			}
+		}
+	}
+	for (uint64_t count : counts) {
+		total += count;
+	}
+
+	uint64_t seen = 0;
+	for (int b = 0; b < LatencyHistogram::num_buckets; ++b) {
+		seen += counts[b];
+		if (total > 0 && seen >= p / 100 * total) {
+			return LatencyHistogram::upper_bound(b);
+		}
+	}
+
+	return 0;
+}
+
+/* Writes the latency histograms, with p50, p99 and p999 estimates, and the counter totals of every kind of query seen
+ * so far, summed over all threads, in the Prometheus text exposition format. Only nonempty buckets are listed. */
+void Instrumentation::report(ostream &out) {
+	uint64_t counts[NUM_QUERY_KINDS][LatencyHistogram::num_buckets] = {}, sums[NUM_QUERY_KINDS] = {},
+		queries[NUM_QUERY_KINDS] = {}, totals[NUM_QUERY_KINDS][NUM_COUNTERS] = {};
+	{
+		lock_guard<mutex> lock (registry_mutex);
+		for (const shared_ptr<ThreadData> &data : registry) {
+			for (int k = 0; k < NUM_QUERY_KINDS; ++k) {
+				for (int b = 0; b < LatencyHistogram::num_buckets; ++b) {
+					counts[k][b] += data->latencies[k].count(b);
+				}
+				sums[k] += data->latencies[k].sum();
+				queries[k] += data->queries[k].load(memory_order_relaxed);
+				for (int c = 0; c < NUM_COUNTERS; ++c) {
+					totals[k][c] += data->totals[k][c].load(memory_order_relaxed);
+				}
+			}
+		}
+	}
+
+	out << "# TYPE predictive_text_query_latency_seconds histogram\n";
+	for (int k = 0; k < NUM_QUERY_KINDS; ++k) {
+		uint64_t cumulative = 0;
+		for (int b = 0; b < LatencyHistogram::num_buckets; ++b) {
+			if (counts[k][b] != 0) {
+				cumulative += counts[k][b];
+				out << "predictive_text_query_latency_seconds_bucket{query=\"" << query_names[k] << "\",le=\""
+					<< (LatencyHistogram::upper_bound(b) + 1) * 1e-9 << "\"} " << cumulative << "\n";
+			}
+		}
+		out << "predictive_text_query_latency_seconds_bucket{query=\"" << query_names[k] << "\",le=\"+Inf\"} " << cumulative << "\n";
+		out << "predictive_text_query_latency_seconds_sum{query=\"" << query_names[k] << "\"} " << sums[k] * 1e-9 << "\n";
+		out << "predictive_text_query_latency_seconds_count{query=\"" << query_names[k] << "\"} " << queries[k] << "\n";
+	}
+
+	out << "# TYPE predictive_text_query_latency_quantile_seconds gauge\n";
+	for (int k = 0; k < NUM_QUERY_KINDS; ++k) {
+		for (double q : {50.0, 99.0, 99.9}) {
+			out << "predictive_text_query_latency_quantile_seconds{query=\"" << query_names[k] << "\",quantile=\"" << q / 100
+				<< "\"} " << percentile((QueryKind) k, q) * 1e-9 << "\n";
+		}
+	}
+
+	for (int c = 0; c < NUM_COUNTERS; ++c) {
+		out << "# TYPE predictive_text_" << counter_names[c] << "_total counter\n";
+		for (int k = 0; k < NUM_QUERY_KINDS; ++k) {
+			out << "predictive_text_" << counter_names[c] << "_total{query=\"" << query_names[k] << "\"} " << totals[k][c] << "\n";
+		}
+	}
+	out.flush();
+}
+
+/* End Instrumentation class. */
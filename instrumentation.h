@@ -0,0 +1,128 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Per-query instrumentation, compiled in only when INSTRUMENTATION is defined (e.g. make CPPFLAGS=-DINSTRUMENTATION); otherwise
+ * the macros below expand to nothing and cost nothing.
+ *
+ * INSTRUMENT_QUERY(kind) at the top of a query function opens a scope for the rest of the function: the counters bumped
+ * by INSTRUMENT_COUNT(counter, n) while it is open, on the same thread, are attributed to that query, and when it closes
+ * its latency goes into a histogram for its kind and its counters into running totals. Scopes opened inside another
+ * scope are ignored, so a query calling another counts as one. The counters of the last query completed on each thread
+ * stay readable through Instrumentation::last_query, e.g. for logging slow ones.
+ *
+ * Each thread records into its own histograms and totals, which only it writes, with relaxed atomic stores and no locks;
+ * Instrumentation::report sums them across threads at any time, from any thread, and writes them in the Prometheus text
+ * format, to be dumped or served to a scraper. */
+
+enum QueryKind {AUTOCOMPLETE_QUERY, AUTOCORRECT_QUERY, FUZZY_AUTOCOMPLETE_QUERY, PROBABILITY_QUERY, NUM_QUERY_KINDS};
+
+enum Counter {
+	NODES_VISITED,	// Trie nodes or map entries looked at
+	DP_ROWS,		// Rows of Levenshtein distance tables computed
+	HEAP_PUSHES,	// Pushes onto priority queues
+	CANDIDATES,		// Words considered as results before ranking or truncation
+	ALLOCATIONS,	// Heap allocations made for the query's working data
+	ALLOCATED_BYTES,
+	NUM_COUNTERS
+};
+
+struct QueryStats {
+	QueryKind kind;
+	uint64_t counters[NUM_COUNTERS];
+	uint64_t nanoseconds;
+};
+
+/* Histogram of latencies in nanoseconds, with four buckets per power of two (so each bucket is within 25% of its upper
+ * bound) and exact buckets below 16 ns. Written by one thread, readable by any. */
+class LatencyHistogram {
+	public:
+		static const int num_buckets = 16 + 60 * 4;
+
+	private:
+		atomic<uint64_t> buckets[num_buckets];
+		atomic<uint64_t> total_nanoseconds;
+
+	public:
+		// Constructors
+
+		LatencyHistogram(void);
+
+		// Getters
+
+		uint64_t count(int) const;
+
+		uint64_t sum(void) const;
+
+		// Functionality
+
+		static int bucket_of(uint64_t);
+
+		static uint64_t upper_bound(int);
+
+		void record(uint64_t);
+};
+
+class Instrumentation {
+	public:
+		/* One thread's histograms and counter totals. */
+		struct ThreadData {
+			LatencyHistogram latencies[NUM_QUERY_KINDS];
+			atomic<uint64_t> queries[NUM_QUERY_KINDS];
+			atomic<uint64_t> totals[NUM_QUERY_KINDS][NUM_COUNTERS];
+			QueryStats last_query;
+
+			ThreadData(void);
+		};
+
+		/* Opens a query scope for its lifetime; see INSTRUMENT_QUERY. */
+		class QueryScope {
+			private:
+				bool outermost;
+				chrono::steady_clock::time_point start;
+
+			public:
+				QueryScope(QueryKind);
+
+				~QueryScope(void);
+		};
+
+	private:
+		static ThreadData & thread_data(void);
+
+	public:
+		// Getters
+
+		static const char * query_name(QueryKind);
+
+		static const char * counter_name(Counter);
+
+		static QueryStats last_query(void);
+
+		// Functionality
+
+		static void count(Counter, uint64_t);
+
+		static uint64_t percentile(QueryKind, double);
+
+		static void report(ostream &);
+};
+
+#ifdef INSTRUMENTATION
+#define INSTRUMENT_QUERY(kind) Instrumentation::QueryScope instrumentation_scope (kind)
+#define INSTRUMENT_COUNT(counter, n) Instrumentation::count(counter, n)
+#else
+#define INSTRUMENT_QUERY(kind) ((void) 0)
+#define INSTRUMENT_COUNT(counter, n) ((void) 0)
+#endif
+
+#endif
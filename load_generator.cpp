@@ -0,0 +1,318 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <utility>
+#include <random>
+#include <stdexcept>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+#include "trie.h"
+#include "ngram.h"
+#include "synthetic_corpus.h"
+
+using namespace std;
+
+/* Load generator replaying keystroke logs against a Trie and, when one is loaded, an NgramModel. Built separately from
+ * main.cpp against the same sources by `make load_generator`.
+ *
+ * A keystroke log holds one keystroke per line: a session number, a space, and the key, which is a single character,
+ * "<space>" (ending the word being typed) or "<backspace>". Without a log, one is synthesized: sessions type sentences
+ * of SyntheticCorpus, some words with typos, and now and then hit a wrong key and backspace over it.
+ *
+ * Every keystroke updates its session's word and then, as a keyboard would, asks for the top completions of the word so
+ * far and its corrections (within distance 1 up to 3 characters, 2 beyond), and, given an n-gram model and at least two
+ * previous words in the session, scores each completion as the next word. Sessions are spread over the threads, and each
+ * thread interleaves its sessions one keystroke at a time, as fast as it can (a closed loop, so throughput is the
+ * capacity of the given number of threads). The latency of each keystroke is the time to do all of the above. */
+
+const char backspace = '\b';
+
+struct Keystroke {
+	int session;
+	char key; // ' ' ends a word, backspace deletes the last character
+};
+
+struct Options {
+	string dictionary_path, log_path, text_path, write_log_path;
+	int sessions = 64, threads = 4, keystrokes = 50000, completions = 5;
+	bool synthetic_ngrams = true;
+};
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* Reads a keystroke log in the format above. */
+static vector<Keystroke> read_log(const string filepath) {
+	ifstream file (filepath);
+	if (!file) {
+		throw runtime_error("Unable to open keystroke log '" + filepath + "'");
+	}
+
+	vector<Keystroke> ret;
+	string line, key;
+	int session;
+	while (getline(file, line)) {
+		istringstream fields (line);
+		if (!(fields >> session >> key) || session < 0) {
+			continue;
+		}
+
+		if (key == "<space>") {
+			ret.push_back(Keystroke {session, ' '});
+		} else if (key == "<backspace>") {
+			ret.push_back(Keystroke {session, backspace});
+		} else if (key.length() == 1) {
+			ret.push_back(Keystroke {session, key[0]});
+		}
+	}
+
+	return ret;
+}
+
+static void write_log(const string filepath, const vector<Keystroke> &log) {
+	ofstream file (filepath);
+	for (const Keystroke &keystroke : log) {
+		file << keystroke.session << " " << (keystroke.key == ' ' ? "<space>" : keystroke.key == backspace ? "<backspace>" : string(1, keystroke.key))
+			 << "\n";
+	}
+
+	if (!file.good()) {
+		throw runtime_error("Error writing keystroke log to '" + filepath + "'");
+	}
+}
+
+/* Synthesizes a log of about the given number of keystrokes, interleaving the sessions at random. Each session types
+ * the words of whole sentences, in lower case; a tenth of the words carry one typo, and one keystroke in 30 is a wrong
+ * key backspaced over. */
+static vector<Keystroke> synthesize_log(SyntheticCorpus *corpus, int num_sessions, int num_keystrokes) {
+	vector<vector<Keystroke>> sessions (num_sessions);
+	mt19937_64 generator (2);
+	for (int s = 0; s < num_sessions; ++s) {
+		while ((int) sessions[s].size() < num_keystrokes / num_sessions) {
+			for (const pair<string, string> &token : corpus->sentence()) {
+				if (!isalpha(token.first[0]) || token.first.back() == '.') {
+					continue; // Punctuation and abbreviations
+				}
+				string word = generator() % 10 == 0 ? corpus->typo(token.first, 1) : token.first;
+				word[0] = tolower(word[0]);
+				for (char c : word) {
+					if (generator() % 30 == 0) {
+						sessions[s].push_back(Keystroke {s, (char) ('a' + generator() % 26)});
+						sessions[s].push_back(Keystroke {s, backspace});
+					}
+					sessions[s].push_back(Keystroke {s, c});
+				}
+				sessions[s].push_back(Keystroke {s, ' '});
+			}
+		}
+	}
+
+	vector<Keystroke> ret;
+	vector<size_t> next (num_sessions, 0);
+	vector<int> active;
+	for (int s = 0; s < num_sessions; ++s) {
+		active.push_back(s);
+	}
+	while (!active.empty()) {
+		size_t i = generator() % active.size();
+		int s = active[i];
+		ret.push_back(sessions[s][next[s]++]);
+		if (next[s] == sessions[s].size()) {
+			active[i] = active.back();
+			active.pop_back();
+		}
+	}
+
+	return ret;
+}
+
+/* Replays the given sessions' keystrokes, in log order within each session, taking turns between sessions, and stores
+ * the latency of each keystroke in nanoseconds. */
+static void replay(Trie &trie, const NgramModel *model, int completions, const vector<vector<Keystroke>> &sessions,
+	vector<uint64_t> *latencies, size_t *checksum) {
+	vector<string> words (sessions.size());
+	vector<vector<string>> contexts (sessions.size());
+	vector<size_t> next (sessions.size(), 0);
+
+	for (bool progress = true; progress;) {
+		progress = false;
+		for (size_t s = 0; s < sessions.size(); ++s) {
+			if (next[s] == sessions[s].size()) {
+				continue;
+			}
+			progress = true;
+			char key = sessions[s][next[s]++].key;
+
+			auto start = chrono::steady_clock::now();
+			string &word = words[s];
+			if (key == ' ') {
+				if (!word.empty()) {
+					contexts[s].push_back(word);
+					if (contexts[s].size() > 2) {
+						contexts[s].erase(contexts[s].begin());
+					}
+				}
+				word.clear();
+			} else if (key == backspace) {
+				if (!word.empty()) {
+					word.pop_back();
+				}
+			} else {
+				word.push_back(key);
+			}
+
+			if (!word.empty()) {
+				vector<string> suggestions = trie.autocomplete(word, completions);
+				*checksum += suggestions.size() + trie.autocorrect(word, word.length() <= 3 ? 1 : 2).size();
+				if (model != NULL && contexts[s].size() == 2) {
+					Ngram context (2, contexts[s]);
+					for (const string &suggestion : suggestions) {
+						*checksum += model->probability(context, suggestion) > 0;
+					}
+				}
+			}
+			latencies->push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+		}
+	}
+}
+
+static void usage(const char *name) {
+	cerr << "Usage: " << name << " [options]" << endl;
+	cerr << "    --dictionary <file>   dictionary in the format of Trie::insert_from_file, with weights (default: synthetic)" << endl;
+	cerr << "    --log <file>          keystroke log to replay (default: synthetic)" << endl;
+	cerr << "    --text <file>         text to build a trigram model from (default: synthetic, unless --dictionary is given)" << endl;
+	cerr << "    --no-ngrams           don't use a trigram model" << endl;
+	cerr << "    --sessions <n>        sessions in a synthetic log (default 64)" << endl;
+	cerr << "    --keystrokes <n>      keystrokes in a synthetic log (default 50000)" << endl;
+	cerr << "    --threads <n>         replaying threads (default 4)" << endl;
+	cerr << "    --completions <n>     completions asked for per keystroke (default 5)" << endl;
+	cerr << "    --write-log <file>    save the replayed log" << endl;
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		string flag = argv[i];
+		bool has_value = i + 1 < argc;
+		if (flag == "--dictionary" && has_value) {
+			options.dictionary_path = argv[++i];
+		} else if (flag == "--log" && has_value) {
+			options.log_path = argv[++i];
+		} else if (flag == "--text" && has_value) {
+			options.text_path = argv[++i];
+		} else if (flag == "--write-log" && has_value) {
+			options.write_log_path = argv[++i];
+		} else if (flag == "--sessions" && has_value) {
+			options.sessions = max(atoi(argv[++i]), 1);
+		} else if (flag == "--keystrokes" && has_value) {
+			options.keystrokes = max(atoi(argv[++i]), 1);
+		} else if (flag == "--threads" && has_value) {
+			options.threads = max(atoi(argv[++i]), 1);
+		} else if (flag == "--completions" && has_value) {
+			options.completions = max(atoi(argv[++i]), 1);
+		} else if (flag == "--no-ngrams") {
+			options.synthetic_ngrams = false;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	SyntheticCorpus corpus (20000, 1);
+	auto start = chrono::steady_clock::now();
+	Trie trie;
+	if (!options.dictionary_path.empty()) {
+		trie.insert_from_file(options.dictionary_path, true);
+	} else {
+		for (size_t rank = 0; rank < corpus.vocabulary_size(); ++rank) {
+			trie.insert(corpus.get_word(rank), corpus.get_weight(rank));
+		}
+	}
+
+	NgramModel model (3);
+	bool has_model = !options.text_path.empty() || (options.synthetic_ngrams && options.dictionary_path.empty());
+	if (!options.text_path.empty()) {
+		model.initialize(vector<string>(1, options.text_path));
+	} else if (has_model) {
+		char text_path[] = "/tmp/predictive-text-load-XXXXXX";
+		int fd = mkstemp(text_path);
+		if (fd < 0) {
+			throw runtime_error("Unable to create a temporary file");
+		}
+		close(fd);
+		corpus.write_text(text_path, 5000);
+		model.initialize(vector<string>(1, text_path));
+		remove(text_path);
+	}
+	cerr << "Loaded in " << seconds_since(start) << " s" << endl;
+
+	vector<Keystroke> log = options.log_path.empty() ? synthesize_log(&corpus, options.sessions, options.keystrokes)
+		: read_log(options.log_path);
+	if (!options.write_log_path.empty()) {
+		write_log(options.write_log_path, log);
+	}
+
+	/* Deal the sessions out to the threads. */
+	vector<vector<vector<Keystroke>>> assignments (options.threads);
+	vector<vector<Keystroke>> sessions;
+	for (const Keystroke &keystroke : log) {
+		if ((int) sessions.size() <= keystroke.session) {
+			sessions.resize(keystroke.session + 1);
+		}
+		sessions[keystroke.session].push_back(keystroke);
+	}
+	for (size_t s = 0; s < sessions.size(); ++s) {
+		if (!sessions[s].empty()) {
+			assignments[s % options.threads].push_back(sessions[s]);
+		}
+	}
+
+	vector<vector<uint64_t>> latencies (options.threads);
+	vector<size_t> checksums (options.threads, 0);
+	vector<thread> threads;
+	start = chrono::steady_clock::now();
+	for (int t = 0; t < options.threads; ++t) {
+		threads.push_back(thread([&, t]() {
+			replay(trie, has_model ? &model : NULL, options.completions, assignments[t], &latencies[t], &checksums[t]);
+		}));
+	}
+	for (thread &t : threads) {
+		t.join();
+	}
+	double elapsed = seconds_since(start);
+
+	vector<uint64_t> all;
+	size_t checksum = 0;
+	for (int t = 0; t < options.threads; ++t) {
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+		checksum += checksums[t];
+	}
+	if (all.empty()) {
+		cerr << "No keystrokes to replay" << endl;
+		return 1;
+	}
+	sort(all.begin(), all.end());
+
+	auto percentile = [&](double p) { return all[max((size_t) ((p / 100) * all.size() + 0.999999), (size_t) 1) - 1] / 1e3; };
+	double mean = 0;
+	for (uint64_t latency : all) {
+		mean += latency / 1e3 / all.size();
+	}
+
+	cout << "{\"keystrokes\":" << all.size() << ",\"sessions\":" << sessions.size() << ",\"threads\":" << options.threads
+		 << ",\"ngrams\":" << (has_model ? "true" : "false") << ",\"seconds\":" << elapsed << ",\"keystrokes_per_second\":"
+		 << all.size() / elapsed << ",\"unit\":\"us\",\"mean\":" << mean << ",\"p50\":" << percentile(50) << ",\"p99\":"
+		 << percentile(99) << ",\"p999\":" << percentile(99.9) << ",\"max\":" << all.back() / 1e3 << "}" << endl;
+	cerr << "(" << checksum << ")" << endl;
+
+	return 0;
+}
@@ -0,0 +1,342 @@
+#include <string>
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "louds_trie.h"
+#include "trie.h"
+#include "best_first.h"
+
+using namespace std;
+
+/* Position of the kth (from 1) set bit of x, which must have at least k set bits. */
+static inline int select_in_word(uint64_t x, size_t k) {
+#if defined(__BMI2__)
+	return __builtin_ctzll(_pdep_u64(1ULL << (k - 1), x));
+#else
+	for (size_t i = 1; i < k; ++i) {
+		x &= x - 1;
+	}
+	return __builtin_ctzll(x);
+#endif
+}
+
+/* Begin BitVector class. */
+
+BitVector::BitVector(void) : num_bits(0) {}
+
+size_t BitVector::size(void) const { return this->num_bits; }
+
+bool BitVector::get(size_t i) const { return (this->words[i / 64] >> (i % 64)) & 1; }
+
+size_t BitVector::memory_bytes(void) const {
+	return this->words.capacity() * sizeof(uint64_t) + this->block_ranks.capacity() * sizeof(uint32_t);
+}
+
+void BitVector::push_back(bool bit) {
+	if (this->num_bits % 64 == 0) {
+		this->words.push_back(0);
+	}
+
+	if (bit) {
+		this->words.back() |= 1ULL << (this->num_bits % 64);
+	}
+	++this->num_bits;
+}
+
+/* Builds the rank directory; must be called after the last push_back and before any rank or select. */
+void BitVector::build(void) {
+	this->words.shrink_to_fit();
+	this->block_ranks.assign(1, 0);
+	for (size_t w = 0; w < this->words.size(); w += block_words) {
+		uint32_t ones = this->block_ranks.back();
+		for (size_t i = w; i < min(w + block_words, this->words.size()); ++i) {
+			ones += __builtin_popcountll(this->words[i]);
+		}
+		this->block_ranks.push_back(ones);
+	}
+}
+
+/* Number of set bits before position i. */
+size_t BitVector::rank1(size_t i) const {
+	size_t word = i / 64, block = word / block_words;
+	size_t ret = this->block_ranks[block];
+	for (size_t w = block * block_words; w < word; ++w) {
+		ret += __builtin_popcountll(this->words[w]);
+	}
+
+	if (i % 64 != 0) {
+		ret += __builtin_popcountll(this->words[word] & ((1ULL << (i % 64)) - 1));
+	}
+
+	return ret;
+}
+
+/* Position of the kth (from 1) clear bit. */
+size_t BitVector::select0(size_t k) const {
+	/* Find the last block with fewer than k clear bits before it. */
+	size_t low = 0, high = this->block_ranks.size() - 1;
+	while (high - low > 1) {
+		size_t middle = (low + high) / 2;
+		if (middle * block_words * 64 - this->block_ranks[middle] < k) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+
+	k -= low * block_words * 64 - this->block_ranks[low];
+	size_t w = low * block_words;
+	for (;; ++w) {
+		size_t zeros = 64 - __builtin_popcountll(this->words[w]);
+		if (zeros >= k) {
+			break;
+		}
+		k -= zeros;
+	}
+
+	return w * 64 + select_in_word(~this->words[w], k);
+}
+
+/* Position of the first clear bit at or after position i, or size() if there is none. */
+size_t BitVector::next_zero(size_t i) const {
+	size_t w = i / 64;
+	uint64_t zeros = ~this->words[w] & (~0ULL << (i % 64));
+	while (zeros == 0 && ++w < this->words.size()) {
+		zeros = ~this->words[w];
+	}
+
+	return w < this->words.size() ? min(this->num_bits, w * 64 + __builtin_ctzll(zeros)) : this->num_bits;
+}
+
+/* End BitVector class. */
+
+/* Begin PackedArray class. */
+
+PackedArray::PackedArray(int width /* = 1 */) : width(width), length(0) {}
+
+size_t PackedArray::size(void) const { return this->length; }
+
+size_t PackedArray::memory_bytes(void) const { return this->words.capacity() * sizeof(uint64_t); }
+
+uint64_t PackedArray::get(size_t i) const {
+	size_t bit = i * this->width, w = bit / 64, offset = bit % 64;
+	uint64_t mask = this->width == 64 ? ~0ULL : (1ULL << this->width) - 1;
+
+	uint64_t value = this->words[w] >> offset;
+	if (offset + this->width > 64) {
+		value |= this->words[w + 1] << (64 - offset);
+	}
+
+	return value & mask;
+}
+
+void PackedArray::push_back(uint64_t value) {
+	size_t bit = this->length * this->width, offset = bit % 64;
+	if (this->words.size() * 64 < bit + this->width) {
+		this->words.push_back(0);
+	}
+
+	this->words[bit / 64] |= value << offset;
+	if (offset + this->width > 64) {
+		this->words[bit / 64 + 1] |= value >> (64 - offset);
+	}
+	++this->length;
+}
+
+/* End PackedArray class. */
+
+/* Begin LoudsTrie class. */
+
+/* Encodes the given trie, visiting it breadth first. */
+LoudsTrie::LoudsTrie(const Trie &trie) {
+	vector<const Node *> order (1, &trie.root);
+	vector<size_t> parents (1, 0);
+
+	this->louds.push_back(true); // The root's own 1 bit, as if it were the only child of a virtual super-root
+	this->louds.push_back(false);
+	this->labels.push_back('\0');
+
+	for (size_t x = 0; x < order.size(); ++x) {
+		this->terminals.push_back(order[x]->is_end());
+		for (const auto &it : order[x]->get_children()) {
+			this->louds.push_back(true);
+			this->labels.push_back(it.first);
+			order.push_back(it.second);
+			parents.push_back(x);
+		}
+		this->louds.push_back(false);
+	}
+	this->louds.build();
+	this->terminals.build();
+	this->labels.shrink_to_fit();
+
+	/* Gather the distinct weights, and the maximum weight below every node, children being numbered after parents. */
+	vector<double> max_weights (order.size(), - numeric_limits<double>::infinity());
+	for (size_t x = 0; x < order.size(); ++x) {
+		if (order[x]->is_end()) {
+			this->weights.push_back(order[x]->get_weight());
+			max_weights[x] = order[x]->get_weight();
+		}
+	}
+	for (size_t x = order.size() - 1; x > 0; --x) {
+		max_weights[parents[x]] = max(max_weights[parents[x]], max_weights[x]);
+	}
+
+	sort(this->weights.begin(), this->weights.end());
+	this->weights.erase(unique(this->weights.begin(), this->weights.end()), this->weights.end());
+	this->weights.shrink_to_fit();
+
+	/* Maximum weights are stored one higher than their index, so that 0 can stand for a subtree without words. */
+	int width = 1;
+	while ((1ULL << width) < this->weights.size() + 1) {
+		++width;
+	}
+	this->weight_indices = PackedArray(width);
+	this->max_weight_indices = PackedArray(width);
+
+	auto index_of = [&](double weight) { return lower_bound(this->weights.begin(), this->weights.end(), weight) - this->weights.begin(); };
+	for (size_t x = 0; x < order.size(); ++x) {
+		if (order[x]->is_end()) {
+			this->weight_indices.push_back(index_of(order[x]->get_weight()));
+		}
+		this->max_weight_indices.push_back(max_weights[x] == - numeric_limits<double>::infinity() ? 0 : index_of(max_weights[x]) + 1);
+	}
+}
+
+size_t LoudsTrie::num_nodes(void) const { return this->labels.size(); }
+
+size_t LoudsTrie::memory_bytes(void) const {
+	return this->louds.memory_bytes() + this->terminals.memory_bytes() + this->labels.capacity() + this->weights.capacity() * sizeof(double)
+		 + this->weight_indices.memory_bytes() + this->max_weight_indices.memory_bytes();
+}
+
+/* Gives the number of node x's first child and its number of children. */
+void LoudsTrie::children(size_t x, size_t *first, size_t *count) const {
+	size_t start = this->louds.select0(x + 1) + 1;
+	*first = this->louds.rank1(start);
+	*count = this->louds.next_zero(start) - start;
+}
+
+/* Returns the child of node x along the given character, or -1 if there is none. */
+long LoudsTrie::child(size_t x, char c) const {
+	size_t first, count;
+	this->children(x, &first, &count);
+
+	auto begin = this->labels.begin() + first, end = begin + count;
+	auto it = lower_bound(begin, end, c);
+	return it != end && *it == c ? it - this->labels.begin() : -1;
+}
+
+/* Returns the node reached by the given word, or -1 if it leads off the trie. */
+long LoudsTrie::find(const string word) const {
+	long x = 0;
+	for (size_t i = 0; i < word.length() && x >= 0; ++i) {
+		x = this->child(x, word[i]);
+	}
+
+	return x;
+}
+
+bool LoudsTrie::contains(const string word) const {
+	long x = this->find(word);
+	return x >= 0 && this->terminals.get(x);
+}
+
+/* Returns the weight of the word, or -1 if it isn't present. */
+double LoudsTrie::get_weight(const string word) const {
+	long x = this->find(word);
+	if (x < 0 || !this->terminals.get(x)) {
+		return -1;
+	}
+
+	return this->weights[this->weight_indices.get(this->terminals.rank1(x))];
+}
+
+/* Returns the top k words, ordered by descending weight, then alphabetically, which complete the given prefix, expanding
+ * subtrees best first by their maximum weight through best_first_completions. */
+vector<string> LoudsTrie::autocomplete(const string prefix, int k) const {
+	long start = this->find(prefix);
+	if (start < 0) {
+		return vector<string>();
+	}
+
+	auto max_weight = [&](size_t x) {
+		uint64_t index = this->max_weight_indices.get(x);
+		return index == 0 ? - numeric_limits<double>::infinity() : this->weights[index - 1];
+	};
+
+	return best_first_completions(prefix, start, max_weight(start), k, [&](size_t x) { return string_view(&this->labels[x], 1); },
+		[&](size_t x, auto word, auto child) {
+			if (this->terminals.get(x)) {
+				word(this->weights[this->weight_indices.get(this->terminals.rank1(x))]);
+			}
+
+			size_t first, count;
+			this->children(x, &first, &count);
+			for (size_t c = first; c < first + count; ++c) {
+				child(c, max_weight(c));
+			}
+		});
+}
+
+/* Returns the words within the given Levenshtein distance of the given word, ordered by distance, then by descending
+ * weight, then alphabetically. */
+vector<string> LoudsTrie::autocorrect(const string word, int max_distance) const {
+	int num_columns = word.length() + 1;
+	vector<int> rows (num_columns);
+	for (int j = 0; j < num_columns; ++j) {
+		rows[j] = j;
+	}
+
+	vector<tuple<string, double, int>> suggestions;
+	string current;
+	size_t first, count;
+	this->children(0, &first, &count);
+	for (size_t c = first; c < first + count; ++c) {
+		this->autocorrect_helper(&suggestions, word, c, &current, &rows, max_distance);
+	}
+
+	return Trie::rank_suggestions(word, suggestions);
+}
+
+/* Private helper function. Adds the row of the Levenshtein distance table for node x below the rows of its ancestors, one
+ * row per character of current, and recurses into x's children while some entry stays within max_distance. */
+void LoudsTrie::autocorrect_helper(vector<tuple<string, double, int>> *v, const string word, size_t x, string *current, vector<int> *rows,
+	int max_distance) const {
+	int num_columns = word.length() + 1;
+	size_t depth = current->length();
+	if (rows->size() < (depth + 2) * num_columns) {
+		rows->resize((depth + 2) * num_columns);
+	}
+
+	const int *prev_row = rows->data() + depth * num_columns;
+	int *curr_row = rows->data() + (depth + 1) * num_columns;
+	char letter = this->labels[x];
+
+	curr_row[0] = prev_row[0] + 1;
+	int min_dist = curr_row[0];
+	for (int j = 1; j < num_columns; ++j) {
+		curr_row[j] = min(min(curr_row[j - 1], prev_row[j]) + 1, prev_row[j - 1] + (word[j - 1] == letter ? 0 : 1));
+		min_dist = min(min_dist, curr_row[j]);
+	}
+
+	current->push_back(letter);
+	if (this->terminals.get(x) && curr_row[num_columns - 1] <= max_distance) {
+		v->push_back(make_tuple(*current, this->weights[this->weight_indices.get(this->terminals.rank1(x))], curr_row[num_columns - 1]));
+	}
+
+	if (min_dist <= max_distance) {
+		size_t first, count;
+		this->children(x, &first, &count);
+		for (size_t c = first; c < first + count; ++c) {
+			this->autocorrect_helper(v, word, c, current, rows, max_distance);
+		}
+	}
+	current->pop_back();
+}
+
+/* End LoudsTrie class. */
@@ -0,0 +1,124 @@
+#ifndef LOUDS_TRIE_H
+#define LOUDS_TRIE_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <cstdint>
+#include <cstddef>
+#include "trie.h"
+
+using namespace std;
+
+/* Append-only bit vector with rank and select. Once build has been called, rank1 takes a lookup in a directory of
+ * cumulative counts, one per 512-bit block (about 6% on top of the bits), plus popcounts within the block; select0
+ * binary searches the same directory and finishes within one word. */
+class BitVector {
+	private:
+		static const int block_words = 8; // 64-bit words per directory entry
+
+		vector<uint64_t> words;
+		size_t num_bits;
+		vector<uint32_t> block_ranks; // Ones before the start of each block
+
+	public:
+		// Constructors
+
+		BitVector(void);
+
+		// Getters
+
+		size_t size(void) const;
+
+		bool get(size_t) const;
+
+		size_t memory_bytes(void) const;
+
+		// Functionality
+
+		void push_back(bool);
+
+		void build(void);
+
+		size_t rank1(size_t) const;
+
+		size_t select0(size_t) const;
+
+		size_t next_zero(size_t) const;
+};
+
+/* Array of unsigned integers of a fixed bit width, packed end to end. */
+class PackedArray {
+	private:
+		vector<uint64_t> words;
+		int width;
+		size_t length;
+
+	public:
+		// Constructors
+
+		PackedArray(int = 1);
+
+		// Getters
+
+		size_t size(void) const;
+
+		uint64_t get(size_t) const;
+
+		size_t memory_bytes(void) const;
+
+		// Functionality
+
+		void push_back(uint64_t);
+};
+
+/* Static succinct trie using the level-order unary degree sequence (LOUDS), built from a Trie. Nodes are numbered in
+ * breadth-first order, the root being 0, and node x's children are written as one 1 bit each after the (x + 1)th 0 bit, so
+ * the children of any node have consecutive numbers and are found with one select and one rank. Alongside this come:
+ *     labels               the character on the edge into each node
+ *     terminals            one bit per node, set for the nodes that end words
+ *     weight_indices       for each terminal, in order, its weight as an index into weights
+ *     max_weight_indices   for each node, the maximum weight below it, likewise
+ *     weights              the distinct weights of the dictionary, sorted
+ * Indices are bit-packed at the width the number of distinct weights needs, so a node costs about 2 bits of LOUDS,
+ * 8 bits of label, 1 terminal bit and one or two weight indices. */
+class LoudsTrie {
+	private:
+		BitVector louds;
+		BitVector terminals;
+		string labels;
+		vector<double> weights;
+		PackedArray weight_indices;
+		PackedArray max_weight_indices;
+
+		void children(size_t, size_t *, size_t *) const;
+
+		long child(size_t, char) const;
+
+		long find(const string) const;
+
+		void autocorrect_helper(vector<tuple<string, double, int>> *, const string, size_t, string *, vector<int> *, int) const;
+
+	public:
+		// Constructors
+
+		LoudsTrie(const Trie &);
+
+		// Getters
+
+		size_t num_nodes(void) const;
+
+		size_t memory_bytes(void) const;
+
+		// Functionality
+
+		bool contains(const string) const;
+
+		double get_weight(const string) const;
+
+		vector<string> autocomplete(const string, int) const;
+
+		vector<string> autocorrect(const string, int) const;
+};
+
+#endif
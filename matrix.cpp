@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstring>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+#include "matrix.h"
+
+using namespace std;
+
+const int block_k = 128; // Rows of B (and columns of A) kept hot in cache per pass
+const int block_n = 256; // Columns of B and C per pass
+
+/* y += a * x, over n elements. */
+static inline void axpy(int n, double a, const double *x, double *y) {
+	int j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+	__m256d va = _mm256_set1_pd(a);
+	for (; j + 4 <= n; j += 4) {
+		_mm256_storeu_pd(y + j, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j)));
+	}
+#endif
+	for (; j < n; ++j) {
+		y[j] += a * x[j];
+	}
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+/* Register-blocked micro-kernel: C[r][0..8) += sum over p of a(r, p) * B[p][0..8) for rows r in [0, 4), where
+ * a(r, p) = A[r * a_row_stride + p * a_column_stride]. The 4 x 8 block of C stays in registers across the whole panel. */
+static inline void kernel_4x8(int pb, const double *A, size_t a_row_stride, size_t a_column_stride, const double *B, int ldb, double *C, int ldc) {
+	__m256d c00 = _mm256_loadu_pd(C), c01 = _mm256_loadu_pd(C + 4);
+	__m256d c10 = _mm256_loadu_pd(C + ldc), c11 = _mm256_loadu_pd(C + ldc + 4);
+	__m256d c20 = _mm256_loadu_pd(C + 2 * ldc), c21 = _mm256_loadu_pd(C + 2 * ldc + 4);
+	__m256d c30 = _mm256_loadu_pd(C + 3 * ldc), c31 = _mm256_loadu_pd(C + 3 * ldc + 4);
+
+	for (int p = 0; p < pb; ++p) {
+		const double *b = B + (size_t) p * ldb, *a = A + p * a_column_stride;
+		__m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4), a_r;
+
+		a_r = _mm256_broadcast_sd(a);
+		c00 = _mm256_fmadd_pd(a_r, b0, c00), c01 = _mm256_fmadd_pd(a_r, b1, c01);
+		a_r = _mm256_broadcast_sd(a + a_row_stride);
+		c10 = _mm256_fmadd_pd(a_r, b0, c10), c11 = _mm256_fmadd_pd(a_r, b1, c11);
+		a_r = _mm256_broadcast_sd(a + 2 * a_row_stride);
+		c20 = _mm256_fmadd_pd(a_r, b0, c20), c21 = _mm256_fmadd_pd(a_r, b1, c21);
+		a_r = _mm256_broadcast_sd(a + 3 * a_row_stride);
+		c30 = _mm256_fmadd_pd(a_r, b0, c30), c31 = _mm256_fmadd_pd(a_r, b1, c31);
+	}
+
+	_mm256_storeu_pd(C, c00), _mm256_storeu_pd(C + 4, c01);
+	_mm256_storeu_pd(C + ldc, c10), _mm256_storeu_pd(C + ldc + 4, c11);
+	_mm256_storeu_pd(C + 2 * ldc, c20), _mm256_storeu_pd(C + 2 * ldc + 4, c21);
+	_mm256_storeu_pd(C + 3 * ldc, c30), _mm256_storeu_pd(C + 3 * ldc + 4, c31);
+}
+#endif
+
+/* Multiplies one cache block: C (m x nb) += a * panel, where panel is (pb x nb) with row stride ldb and a(i, p) is
+ * A[i * a_row_stride + p * a_column_stride], so that the same code serves A and A^T. */
+static void multiply_panel(int m, int nb, int pb, const double *A, size_t a_row_stride, size_t a_column_stride, const double *panel, int ldb, double *C, int ldc) {
+	int i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+	for (; i + 4 <= m; i += 4) {
+		const double *a = A + i * a_row_stride;
+		double *c = C + (size_t) i * ldc;
+
+		int j = 0;
+		for (; j + 8 <= nb; j += 8) {
+			kernel_4x8(pb, a, a_row_stride, a_column_stride, panel + j, ldb, c + j, ldc);
+		}
+
+		/* Leftover columns. */
+		if (j < nb) {
+			for (int r = 0; r < 4; ++r) {
+				for (int p = 0; p < pb; ++p) {
+					axpy(nb - j, a[r * a_row_stride + p * a_column_stride], panel + (size_t) p * ldb + j, c + (size_t) r * ldc + j);
+				}
+			}
+		}
+	}
+#endif
+	/* Leftover rows, or every row without AVX2. */
+	for (; i < m; ++i) {
+		const double *a = A + i * a_row_stride;
+		double *c = C + (size_t) i * ldc;
+
+		for (int p = 0; p < pb; ++p) {
+			axpy(nb, a[p * a_column_stride], panel + (size_t) p * ldb, c);
+		}
+	}
+}
+
+/* Returns the dot product of two n-element vectors. */
+static inline double dot(int n, const double *x, const double *y) {
+	int j = 0;
+	double sum = 0.0;
+#if defined(__AVX2__) && defined(__FMA__)
+	__m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+	for (; j + 8 <= n; j += 8) {
+		acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j), acc0);
+		acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j + 4), _mm256_loadu_pd(y + j + 4), acc1);
+	}
+	for (; j + 4 <= n; j += 4) {
+		acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j), _mm256_loadu_pd(y + j), acc0);
+	}
+
+	double lanes[4];
+	_mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for (; j < n; ++j) {
+		sum += x[j] * y[j];
+	}
+
+	return sum;
+}
+
+static void zero(int m, int n, double *C, int ldc) {
+	for (int i = 0; i < m; ++i) {
+		memset(C + (size_t) i * ldc, 0, n * sizeof(double));
+	}
+}
+
+void gemm_nn(int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, bool accumulate) {
+	if (!accumulate) {
+		zero(m, n, C, ldc);
+	}
+
+	for (int p0 = 0; p0 < k; p0 += block_k) {
+		for (int j0 = 0; j0 < n; j0 += block_n) {
+			multiply_panel(m, min(block_n, n - j0), min(block_k, k - p0), A + p0, lda, 1, B + (size_t) p0 * ldb + j0, ldb, C + j0, ldc);
+		}
+	}
+}
+
+void gemm_tn(int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, bool accumulate) {
+	if (!accumulate) {
+		zero(m, n, C, ldc);
+	}
+
+	for (int p0 = 0; p0 < k; p0 += block_k) {
+		for (int j0 = 0; j0 < n; j0 += block_n) {
+			multiply_panel(m, min(block_n, n - j0), min(block_k, k - p0), A + (size_t) p0 * lda, 1, lda, B + (size_t) p0 * ldb + j0, ldb, C + j0, ldc);
+		}
+	}
+}
+
+void gemm_nt(int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, bool accumulate) {
+	/* Each entry is a dot product of two contiguous rows; block over the rows of B so they stay in cache across rows of A. */
+	const int block_rows = max(1, 32768 / (int) sizeof(double) / max(k, 1));
+
+	for (int j0 = 0; j0 < n; j0 += block_rows) {
+		int nb = min(block_rows, n - j0);
+
+		for (int i = 0; i < m; ++i) {
+			const double *a = A + (size_t) i * lda;
+			double *c = C + (size_t) i * ldc;
+
+			for (int j = j0; j < j0 + nb; ++j) {
+				double value = dot(k, a, B + (size_t) j * ldb);
+				c[j] = accumulate ? c[j] + value : value;
+			}
+		}
+	}
+}
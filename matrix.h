@@ -0,0 +1,58 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/* Allocator returning memory aligned to a cache line, so that matrix rows start on vector-load boundaries. */
+template <class T>
+class AlignedAllocator {
+	public:
+		typedef T value_type;
+
+		static const size_t alignment = 64;
+
+		AlignedAllocator(void) {}
+
+		template <class U>
+		AlignedAllocator(const AlignedAllocator<U> &) {}
+
+		T * allocate(size_t n) {
+			size_t bytes = (n * sizeof(T) + alignment - 1) / alignment * alignment;
+			void *p = aligned_alloc(alignment, bytes);
+			if (p == NULL) {
+				throw bad_alloc();
+			}
+
+			return (T *) p;
+		}
+
+		void deallocate(T *p, size_t) { free(p); }
+
+		template <class U>
+		bool operator ==(const AlignedAllocator<U> &) const { return true; }
+
+		template <class U>
+		bool operator !=(const AlignedAllocator<U> &) const { return false; }
+};
+
+typedef vector<double, AlignedAllocator<double>> AlignedArray;
+
+/* Dense row-major matrix kernels. Each computes an (m x n) result C, with ldX giving the row stride of each operand, and
+ * either overwrites C or, if accumulate is true, adds to it. They are cache-blocked and use AVX2/FMA when the compiler
+ * targets it, with a scalar fallback. */
+
+// C = A * B, where A is (m x k) and B is (k x n)
+void gemm_nn(int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, bool accumulate);
+
+// C = A^T * B, where A is (k x m) and B is (k x n)
+void gemm_tn(int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, bool accumulate);
+
+// C = A * B^T, where A is (m x k) and B is (n x k)
+void gemm_nt(int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, bool accumulate);
+
+#endif
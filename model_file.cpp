@@ -0,0 +1,201 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#include "model_file.h"
+
+using namespace std;
+
+const uint32_t model_magic = 0x464d5450; // "PTMF"
+const uint16_t format_version = 1;
+
+struct ModelHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t kind;
+	uint64_t size;
+	uint32_t checksum;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(ModelHeader) == 24 && sizeof(ModelHeader) % 8 == 0, "Model header must keep the payload 8-byte aligned");
+
+/* Table for bytewise CRC-32C (Castagnoli polynomial, reflected), used where the SSE4.2 crc32 instruction isn't available
+ * and for the bytes left over past the last whole word. */
+static constexpr array<uint32_t, 256> make_crc32c_table(void) {
+	array<uint32_t, 256> table {};
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (crc & 1 ? 0x82f63b78 : 0);
+		}
+		table[i] = crc;
+	}
+
+	return table;
+}
+
+static constexpr array<uint32_t, 256> crc32c_table = make_crc32c_table();
+
+/* CRC-32C of n bytes, continuing from the CRC of any preceding bytes (0 to start afresh). */
+uint32_t crc32c(const void *data, size_t n, uint32_t crc /* = 0 */) {
+	const unsigned char *p = (const unsigned char *) data, *end = p + n;
+	crc = ~crc;
+
+#if defined(__SSE4_2__)
+	uint64_t wide = crc;
+	for (; end - p >= 8; p += 8) {
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		wide = _mm_crc32_u64(wide, word);
+	}
+	crc = wide;
+#endif
+
+	for (; p < end; ++p) {
+		crc = (crc >> 8) ^ crc32c_table[(crc ^ *p) & 0xff];
+	}
+
+	return ~crc;
+}
+
+bool model_file_exists(const string filepath) {
+	struct stat status;
+	return stat(filepath.c_str(), &status) == 0 && S_ISREG(status.st_mode);
+}
+
+/* Begin ModelWriter class. */
+
+ModelWriter::ModelWriter(ModelKind kind) : kind(kind) {}
+
+/* Pads the payload with zeros up to a multiple of the given number of bytes, so that what follows can be read in place. */
+void ModelWriter::align(size_t alignment) {
+	this->payload.resize((this->payload.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+/* Writes the header and payload to a temporary file beside the target, syncs it, renames it into place and syncs the
+ * directory holding it, so that readers never see a partly written model, and the new one survives a crash once this
+ * returns. */
+void ModelWriter::save(const string filepath) const {
+	ModelHeader header = {model_magic, format_version, (uint16_t) this->kind, this->payload.size(),
+		crc32c(this->payload.data(), this->payload.size()), 0};
+
+	string temporary = filepath + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (file == NULL) {
+		throw runtime_error("Unable to open '" + temporary + "' for writing\n");
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		   && fwrite(this->payload.data(), 1, this->payload.size(), file) == this->payload.size()
+		   && fflush(file) == 0 && fsync(fileno(file)) == 0;
+	ok = fclose(file) == 0 && ok;
+
+	if (!ok || rename(temporary.c_str(), filepath.c_str()) != 0) {
+		remove(temporary.c_str());
+		throw runtime_error("Error writing model to '" + filepath + "'\n");
+	}
+
+	size_t slash = filepath.rfind('/');
+	string directory = slash == string::npos ? "." : slash == 0 ? "/" : filepath.substr(0, slash);
+	int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0 || fsync(fd) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		throw runtime_error("Unable to sync directory '" + directory + "' after writing model '" + filepath + "'\n");
+	}
+	close(fd);
+}
+
+/* End ModelWriter class. */
+
+/* Begin ModelReader class. */
+
+/* Maps the given file and checks that it is a complete, uncorrupted model of the given kind. */
+ModelReader::ModelReader(const string filepath, ModelKind kind) : filepath(filepath), mapping(MAP_FAILED), mapping_size(0),
+	payload(NULL), payload_size(0), position(0) {
+	int fd = open(filepath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("Unable to open model '" + filepath + "'\n");
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(ModelHeader)) {
+		close(fd);
+		throw runtime_error("'" + filepath + "' is not a model file\n");
+	}
+
+	this->mapping_size = status.st_size;
+	this->mapping = mmap(NULL, this->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (this->mapping == MAP_FAILED) {
+		throw runtime_error("Unable to map model '" + filepath + "'\n");
+	}
+
+	ModelHeader header;
+	memcpy(&header, this->mapping, sizeof(header));
+	this->payload = (const char *) this->mapping + sizeof(header);
+	this->payload_size = this->mapping_size - sizeof(header);
+
+	string problem;
+	if (header.magic == __builtin_bswap32(model_magic)) {
+		problem = "was written on a machine of the other byte order";
+	} else if (header.magic != model_magic) {
+		problem = "is not a model file";
+	} else if (header.version != format_version) {
+		problem = "has unsupported format version " + to_string(header.version);
+	} else if (header.kind != kind) {
+		problem = "holds a different kind of model";
+	} else if (header.size != this->payload_size) {
+		problem = "is truncated";
+	} else if (crc32c(this->payload, this->payload_size) != header.checksum) {
+		problem = "is corrupt (checksum mismatch)";
+	}
+
+	if (!problem.empty()) {
+		munmap(this->mapping, this->mapping_size);
+		throw runtime_error("Model '" + filepath + "' " + problem + "\n");
+	}
+}
+
+void ModelReader::check(size_t n) const {
+	if (n > this->payload_size - this->position) {
+		throw runtime_error("Model '" + this->filepath + "' ends unexpectedly\n");
+	}
+}
+
+/* Returns a pointer to the next n bytes of the payload, valid for the lifetime of the reader. */
+const char * ModelReader::read_bytes(size_t n) {
+	this->check(n);
+	const char *ret = this->payload + this->position;
+	this->position += n;
+	return ret;
+}
+
+/* Skips the padding written by ModelWriter::align. */
+void ModelReader::align(size_t alignment) {
+	size_t aligned = (this->position + alignment - 1) / alignment * alignment;
+	this->check(aligned - this->position);
+	this->position = aligned;
+}
+
+size_t ModelReader::remaining(void) const { return this->payload_size - this->position; }
+
+bool ModelReader::at_end(void) const { return this->position == this->payload_size; }
+
+ModelReader::~ModelReader(void) {
+	munmap(this->mapping, this->mapping_size);
+}
+
+/* End ModelReader class. */
@@ -0,0 +1,108 @@
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+/* Binary model files. A file is a fixed header followed by a payload whose layout is up to the model type:
+ *     magic      uint32   "PTMF"
+ *     version    uint16   format_version at the time of writing
+ *     kind       uint16   which model the payload holds
+ *     size       uint64   payload length in bytes
+ *     checksum   uint32   CRC-32C of the payload
+ *     reserved   uint32   zero, pads the payload to an 8-byte boundary
+ * All fields, and everything written through ModelWriter, are in the byte order of the machine that wrote them, so that
+ * payloads can be read in place; a reader rejects a file written in the other byte order, which it tells by the magic
+ * number. Readers map the whole file and verify the header and checksum before handing out any of the payload, so a
+ * truncated or corrupted file fails on opening. */
+
+enum ModelKind { NEURAL_NETWORK_MODEL = 1, PART_OF_SPEECH_MODEL = 2, TRIE_MODEL = 3, NGRAM_MODEL = 4, JOURNAL_SNAPSHOT_MODEL = 5 };
+
+uint32_t crc32c(const void *, size_t, uint32_t = 0);
+
+/* Builds a payload in memory, then writes the file in one go. */
+class ModelWriter {
+	private:
+		ModelKind kind;
+		vector<char> payload;
+
+	public:
+		// Constructors
+
+		ModelWriter(ModelKind);
+
+		// Functionality
+
+		template <class T>
+		void write(const T &value) { this->write_array(&value, 1); }
+
+		template <class T>
+		void write_array(const T *values, size_t n) {
+			const char *bytes = (const char *) values;
+			this->payload.insert(this->payload.end(), bytes, bytes + n * sizeof(T));
+		}
+
+		void align(size_t);
+
+		void save(const string) const;
+};
+
+/* Read-only view of a model file, mapped into memory and validated on construction. Values are read in the order they
+ * were written; reading past the end of the payload throws. */
+class ModelReader {
+	private:
+		string filepath;
+		void *mapping;
+		size_t mapping_size;
+		const char *payload;
+		size_t payload_size, position;
+
+		void check(size_t) const;
+
+	public:
+		// Constructors
+
+		ModelReader(const string, ModelKind);
+
+		ModelReader(const ModelReader &) = delete;
+
+		// Functionality
+
+		template <class T>
+		T read(void) {
+			T value;
+			this->read_array(&value, 1);
+			return value;
+		}
+
+		template <class T>
+		void read_array(T *values, size_t n) {
+			this->check(n * sizeof(T));
+			memcpy((void *) values, this->payload + this->position, n * sizeof(T));
+			this->position += n * sizeof(T);
+		}
+
+		const char * read_bytes(size_t);
+
+		void align(size_t);
+
+		size_t remaining(void) const;
+
+		bool at_end(void) const;
+
+		// Other
+
+		ModelReader & operator =(const ModelReader &) = delete;
+
+		~ModelReader(void);
+};
+
+bool model_file_exists(const string);
+
+#endif
@@ -0,0 +1,260 @@
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include "neural_network.h"
+#include "matrix.h"
+#include "model_file.h"
+
+using namespace std;
+
+static inline double sigmoid(double x) { return 1.0 / (1.0 + exp(-x)); }
+
+/* Begin NeuralNetwork class. */
+
+/* Creates a network with the given number of units in each of its num_layers layers, the first being the input layer.
+ * Weights are drawn uniformly from [-1 / sqrt(n), 1 / sqrt(n)], n being the number of inputs to the unit, using rand(). */
+NeuralNetwork::NeuralNetwork(int *layer_counts, int num_layers) : layer_counts(layer_counts, layer_counts + num_layers) {
+	this->layout();
+
+	for (int l = 0; l + 1 < num_layers; ++l) {
+		double bound = 1.0 / sqrt((double) layer_counts[l]);
+		for (size_t i = this->weight_offsets[l]; i < this->bias_offsets[l] + layer_counts[l + 1]; ++i) {
+			this->parameters[i] = bound * (2.0 * rand() / RAND_MAX - 1.0);
+		}
+	}
+}
+
+/* Returns the number of parameters of a network with the given layer sizes, checking that they describe a valid network. */
+size_t NeuralNetwork::count_parameters(const vector<int> &layer_counts) {
+	if (layer_counts.size() < 2) {
+		throw runtime_error("A neural network needs at least an input and an output layer\n");
+	}
+
+	size_t size = 0;
+	for (size_t l = 0; l < layer_counts.size(); ++l) {
+		if (layer_counts[l] <= 0) {
+			throw runtime_error("Every layer of a neural network needs at least one unit\n");
+		} else if (l > 0) {
+			size += ((size_t) layer_counts[l - 1] + 1) * layer_counts[l];
+		}
+	}
+
+	return size;
+}
+
+/* Sizes the parameters and their offsets to match layer_counts. */
+void NeuralNetwork::layout(void) {
+	this->parameters.assign(count_parameters(this->layer_counts), 0.0);
+
+	size_t size = 0;
+	this->weight_offsets.clear();
+	this->bias_offsets.clear();
+	for (size_t l = 0; l + 1 < this->layer_counts.size(); ++l) {
+		this->weight_offsets.push_back(size);
+		size += (size_t) this->layer_counts[l] * this->layer_counts[l + 1];
+		this->bias_offsets.push_back(size);
+		size += this->layer_counts[l + 1];
+	}
+
+	this->workspace = Workspace();
+}
+
+int NeuralNetwork::num_layers(void) const { return this->layer_counts.size(); }
+
+int NeuralNetwork::layer_size(int l) const { return this->layer_counts[l]; }
+
+int NeuralNetwork::input_size(void) const { return this->layer_counts.front(); }
+
+int NeuralNetwork::output_size(void) const { return this->layer_counts.back(); }
+
+size_t NeuralNetwork::num_parameters(void) const { return this->parameters.size(); }
+
+double * NeuralNetwork::get_parameters(void) { return this->parameters.data(); }
+
+const double * NeuralNetwork::get_parameters(void) const { return this->parameters.data(); }
+
+/* Sizes the given workspace's buffers for a batch of the given size. */
+void NeuralNetwork::prepare(Workspace *w, int batch_size) const {
+	if (w->batch_size >= batch_size && w->activations.size() == this->layer_counts.size()) {
+		w->batch_size = batch_size;
+		return;
+	}
+
+	w->batch_size = batch_size;
+	w->activations.resize(this->layer_counts.size());
+	w->deltas.resize(this->layer_counts.size());
+	for (size_t l = 0; l < this->layer_counts.size(); ++l) {
+		w->activations[l].resize((size_t) batch_size * this->layer_counts[l]);
+		w->deltas[l].resize((size_t) batch_size * this->layer_counts[l]);
+	}
+}
+
+/* Returns the output of the network for a single input. */
+ARRAY NeuralNetwork::feedforward(ARRAY input) {
+	ARRAY output (this->output_size());
+	this->feedforward_batch(input.data(), 1, output.data());
+	return output;
+}
+
+/* Computes the outputs for batch_size inputs, stored row by row in inputs, and writes them row by row to outputs. */
+void NeuralNetwork::feedforward_batch(const double *inputs, int batch_size, double *outputs) {
+	this->forward(inputs, batch_size, &this->workspace);
+
+	const AlignedArray &last = this->workspace.activations.back();
+	memcpy(outputs, last.data(), (size_t) batch_size * this->output_size() * sizeof(double));
+}
+
+/* Pushes a batch of inputs through the network, leaving every layer's activations in the workspace. Each layer is one
+ * matrix product, activations[l + 1] = sigmoid(activations[l] * W_l + b_l). */
+void NeuralNetwork::forward(const double *inputs, int batch_size, Workspace *w) const {
+	this->prepare(w, batch_size);
+	memcpy(w->activations[0].data(), inputs, (size_t) batch_size * this->input_size() * sizeof(double));
+
+	for (size_t l = 0; l + 1 < this->layer_counts.size(); ++l) {
+		int in = this->layer_counts[l], out = this->layer_counts[l + 1];
+		const double *weights = &this->parameters[this->weight_offsets[l]], *biases = &this->parameters[this->bias_offsets[l]];
+		double *z = w->activations[l + 1].data();
+
+		gemm_nn(batch_size, out, in, w->activations[l].data(), in, weights, out, z, out, false);
+
+		for (int b = 0; b < batch_size; ++b) {
+			double *row = z + (size_t) b * out;
+			for (int j = 0; j < out; ++j) {
+				row[j] = sigmoid(row[j] + biases[j]);
+			}
+		}
+	}
+}
+
+/* Backpropagates the error of the batch most recently pushed through forward with the given workspace, against the given
+ * targets (one row per sample). Writes the gradient of the summed squared error with respect to every parameter into
+ * gradient, laid out like the parameters, and returns that summed squared error. */
+double NeuralNetwork::backward(const double *targets, Workspace *w, double *gradient) const {
+	int batch_size = w->batch_size, last = this->layer_counts.size() - 1, outputs = this->output_size();
+
+	/* Output layer: dE/dz = (y - t) * y * (1 - y), taking E = sum of (y - t)^2 / 2. */
+	double error = 0.0;
+	const double *y = w->activations[last].data();
+	double *delta = w->deltas[last].data();
+	for (size_t i = 0; i < (size_t) batch_size * outputs; ++i) {
+		double diff = y[i] - targets[i];
+		error += diff * diff;
+		delta[i] = diff * y[i] * (1.0 - y[i]);
+	}
+
+	for (int l = last - 1; l >= 0; --l) {
+		int in = this->layer_counts[l], out = this->layer_counts[l + 1];
+		const double *a = w->activations[l].data(), *d = w->deltas[l + 1].data();
+
+		/* Weight gradient is a^T * delta, and bias gradient the column sums of delta. */
+		gemm_tn(in, out, batch_size, a, in, d, out, gradient + this->weight_offsets[l], out, false);
+
+		double *bias_gradient = gradient + this->bias_offsets[l];
+		fill(bias_gradient, bias_gradient + out, 0.0);
+		for (int b = 0; b < batch_size; ++b) {
+			for (int j = 0; j < out; ++j) {
+				bias_gradient[j] += d[(size_t) b * out + j];
+			}
+		}
+
+		/* Propagate to the layer below (not needed for the inputs): delta_l = (delta_{l + 1} * W_l^T) . a * (1 - a). */
+		if (l > 0) {
+			double *below = w->deltas[l].data();
+			gemm_nt(batch_size, in, out, d, out, &this->parameters[this->weight_offsets[l]], out, below, in, false);
+
+			for (size_t i = 0; i < (size_t) batch_size * in; ++i) {
+				below[i] *= a[i] * (1.0 - a[i]);
+			}
+		}
+	}
+
+	return error / 2;
+}
+
+/* Returns the mean squared error of the network over the given samples. */
+double NeuralNetwork::error(const vector<pair<ARRAY, ARRAY>> &samples) {
+	double total = 0.0;
+	ARRAY output (this->output_size());
+	for (const pair<ARRAY, ARRAY> &sample : samples) {
+		this->feedforward_batch(sample.first.data(), 1, output.data());
+		for (int j = 0; j < this->output_size(); ++j) {
+			total += (output[j] - sample.second[j]) * (output[j] - sample.second[j]);
+		}
+	}
+
+	return total / (samples.size() * this->output_size());
+}
+
+/* Trains the network by minibatch gradient descent for the given number of epochs, visiting the samples in a new random
+ * order each epoch. Each step moves the parameters by learning_rate times the gradient averaged over the minibatch. */
+void NeuralNetwork::train(vector<pair<ARRAY, ARRAY>> samples, int epochs, int batch_size /* = 1 */, double learning_rate /* = 0.5 */) {
+	int inputs = this->input_size(), outputs = this->output_size();
+	AlignedArray batch_inputs ((size_t) batch_size * inputs), batch_targets ((size_t) batch_size * outputs);
+	AlignedArray gradient (this->parameters.size());
+
+	mt19937 generator (rand());
+	for (int epoch = 0; epoch < epochs; ++epoch) {
+		shuffle(samples.begin(), samples.end(), generator);
+
+		for (size_t start = 0; start < samples.size(); start += batch_size) {
+			int size = min((size_t) batch_size, samples.size() - start);
+
+			/* Gather the minibatch into contiguous rows. */
+			for (int b = 0; b < size; ++b) {
+				copy(samples[start + b].first.begin(), samples[start + b].first.end(), &batch_inputs[(size_t) b * inputs]);
+				copy(samples[start + b].second.begin(), samples[start + b].second.end(), &batch_targets[(size_t) b * outputs]);
+			}
+
+			this->forward(batch_inputs.data(), size, &this->workspace);
+			this->backward(batch_targets.data(), &this->workspace, gradient.data());
+
+			double step = learning_rate / size;
+			for (size_t i = 0; i < this->parameters.size(); ++i) {
+				this->parameters[i] -= step * gradient[i];
+			}
+		}
+	}
+}
+
+/* Writes the network's topology and parameters to a model file. */
+void NeuralNetwork::save(const string filepath) const {
+	ModelWriter writer (NEURAL_NETWORK_MODEL);
+	writer.write((uint32_t) this->layer_counts.size());
+	writer.write_array(this->layer_counts.data(), this->layer_counts.size());
+	writer.align(sizeof(double));
+	writer.write_array(this->parameters.data(), this->parameters.size());
+	writer.save(filepath);
+}
+
+/* Replaces this network's topology and parameters with those of the given model file, as written by save. The network is
+ * left unchanged if the file can't be loaded. */
+void NeuralNetwork::load(const string filepath) {
+	ModelReader reader (filepath, NEURAL_NETWORK_MODEL);
+	uint32_t num_layers = reader.read<uint32_t>();
+	if (num_layers > reader.remaining() / sizeof(int)) {
+		throw runtime_error("Model '" + filepath + "' ends unexpectedly\n");
+	}
+
+	vector<int> layer_counts (num_layers);
+	reader.read_array(layer_counts.data(), layer_counts.size());
+	reader.align(sizeof(double));
+
+	size_t num_parameters = count_parameters(layer_counts);
+	if (num_parameters != reader.remaining() / sizeof(double)) {
+		throw runtime_error("Model '" + filepath + "' doesn't match its topology\n");
+	}
+
+	AlignedArray parameters (num_parameters);
+	reader.read_array(parameters.data(), parameters.size());
+
+	this->layer_counts.swap(layer_counts);
+	this->layout();
+	this->parameters.swap(parameters);
+}
+
+/* End NeuralNetwork class. */
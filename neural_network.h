@@ -0,0 +1,86 @@
+#ifndef NEURAL_NETWORK_H
+#define NEURAL_NETWORK_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstddef>
+#include "matrix.h"
+
+using namespace std;
+
+typedef vector<double> ARRAY;
+
+/* Fully connected feedforward network with sigmoid units, trained by backpropagation on squared error. All parameters live
+ * in one contiguous, aligned array: for each layer, its row-major (inputs x outputs) weight matrix followed by its biases.
+ * Minibatches are pushed through the layers as matrix products, one sample per row. */
+class NeuralNetwork {
+	public:
+		/* Scratch space for a forward and backward pass over a minibatch, kept apart from the network itself so that several
+		 * threads can push batches through the same network at once. */
+		struct Workspace {
+			int batch_size;
+			vector<AlignedArray> activations; // activations[l] is (batch_size x layer_size(l)); activations[0] holds the inputs
+			vector<AlignedArray> deltas; // deltas[l] is the gradient of the error with respect to layer l's weighted inputs
+
+			Workspace(void) : batch_size(0) {}
+		};
+
+	private:
+		vector<int> layer_counts;
+		AlignedArray parameters;
+		vector<size_t> weight_offsets; // Start of the weight matrix feeding layer l + 1 from layer l, for each l
+		vector<size_t> bias_offsets; // Start of the biases of layer l + 1, for each l
+		Workspace workspace; // Used by the single-threaded entry points
+
+		static size_t count_parameters(const vector<int> &);
+
+		void layout(void);
+
+		void prepare(Workspace *, int) const;
+
+	public:
+		// Constructors
+
+		NeuralNetwork(int *, int);
+
+		// Getters
+
+		int num_layers(void) const;
+
+		int layer_size(int) const;
+
+		int input_size(void) const;
+
+		int output_size(void) const;
+
+		size_t num_parameters(void) const;
+
+		double * get_parameters(void);
+
+		const double * get_parameters(void) const;
+
+		// Functionality
+
+		ARRAY feedforward(ARRAY);
+
+		void feedforward_batch(const double *, int, double *);
+
+		void forward(const double *, int, Workspace *) const;
+
+		double backward(const double *, Workspace *, double *) const;
+
+		double error(const vector<pair<ARRAY, ARRAY>> &);
+
+		// Training
+
+		void train(vector<pair<ARRAY, ARRAY>>, int, int = 1, double = 0.5);
+
+		// Persistence
+
+		void save(const string) const;
+
+		void load(const string);
+};
+
+#endif
@@ -1,8 +1,14 @@
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <cstring>
+#include <fstream>
+#include <stdexcept>
 #include "ngram.h"
+#include "tokenizer.h"
+#include "sentence_disambiguation.h"
+#include "instrumentation.h"
 
 using namespace std;
 
@@ -21,7 +27,7 @@ int Ngram::string_hash(const string s) {
 	int modulus = 1;
 	
 	int hash = 0;
-	for (int i = 1; i < s.length(); ++i) {
+	for (int i = 1; i < (int) s.length(); ++i) {
 		hash += modulus * s[i];
 		modulus *= prime;
 	}
@@ -60,16 +66,17 @@ bool Ngram::operator<(const Ngram &gram) const { return ngram_hash(*this) > ngra
 /* Integrates the given counts map to the initial counts map. */
 void NgramModel::update_counts(map<Ngram, int> *counts, map<Ngram, int> *update) {
 	for (auto it = update->begin(); it != update->end(); ++it) {
-		if (counts->find(it->first) == counts->end()) { // n-gram not in model, so add it
-			(*counts)[it->first] = 1;
-		} else {
-			++(*counts)[it->first];
-		}
+		(*counts)[it->first] += it->second;
 	}
 }
 
+/* Splits a paragraph into sentences. No trained sentence boundary net is available here, so boundaries are found by
+ * punctuation and capitalization. */
 vector<string> NgramModel::get_sentences(const string paragraph) {
-	// TODO
+	vector<string_view> sentences;
+	Sentence::get_sentences(paragraph, true, &sentences);
+
+	return vector<string>(sentences.begin(), sentences.end());
 }
 
 /* Given a list of sentences, returns a map (pointer, to save space) cataloging the frequency counts of each n-gram. */
@@ -77,16 +84,19 @@ map<Ngram, int> * NgramModel::get_counts(int n, const vector<string> sentences)
 	map<Ngram, int> *ret = new map<Ngram, int>();
 
 	/* Compute counts, sentence by sentence. */
+	static const Tokenizer word_tokenizer (" ;,\t");
+	vector<string_view> words;
 	vector<string> seq;
 	Ngram gram;
-	char *word;
-	for (string sentence : sentences) {
+	for (const string &sentence : sentences) {
+		words.clear();
+		word_tokenizer.split(sentence, &words);
+
 		/* Add the first n-gram to the counts. */
 		seq.push_back(start_str);
-		word = strtok((char *) sentence.c_str(), " ;,\t");
-		for (int i = 0; i < n - 1; ++i) {
-			seq.push_back(word);
-			word = strtok(NULL, " ;,\t");
+		size_t next = 0;
+		for (; next < words.size() && (int) seq.size() < n; ++next) {
+			seq.push_back(string(words[next]));
 		}
 
 		gram = Ngram(n, seq);
@@ -97,14 +107,13 @@ map<Ngram, int> * NgramModel::get_counts(int n, const vector<string> sentences)
 		}
 
 		/* Iterate through the sentence, adding n-grams along the way. */
-		while (word != NULL) {
-			word = strtok(NULL, " ;,\t");
-
+		for (; next < words.size(); ++next) {
 			/* Rolling update of the current n-gram. */
 			seq.erase(seq.begin()); // Erase the first element
-			seq.push_back(word); // Add current word to front
-			
+			seq.push_back(string(words[next])); // Add current word to front
+
 			/* Add current n-gram to counts. */
+			gram = Ngram(n, seq);
 			if (ret->find(gram) == ret->end()) {
 				(*ret)[gram] = 1;
 			} else {
@@ -113,7 +122,9 @@ map<Ngram, int> * NgramModel::get_counts(int n, const vector<string> sentences)
 		}
 
 		/* Add the final n-gram to counts. */
-		seq.erase(seq.begin());
+		if ((int) seq.size() == n) {
+			seq.erase(seq.begin());
+		}
 		seq.push_back(end_str);
 
 		gram = Ngram(n, seq);
@@ -132,29 +143,132 @@ map<Ngram, int> * NgramModel::get_counts(int n, const vector<string> sentences)
 
 NgramModel::NgramModel(int n) : n(n), total(0) {}
 
-// TODO: For each file, read in a certain number of lines into a buffer, cutting off at the last sentence and incorporating the beginning
-//		 of the next, cut-off sentence into the next buffer, and pass the buffer into get_sentences.
-/* Given a list of file paths pointing to various corpora, initializes the model by reading each file. */
+int NgramModel::get_n(void) const { return this->n; }
+
+/* Given a list of file paths pointing to various corpora, initializes the model by reading each file. Each line is taken
+ * to be a paragraph, so that no sentence is cut off between two reads. */
 void NgramModel::initialize(const vector<string> files) {
-	// vector<string> sentences;
-	// for (string file : files) {
-	// 	sentences = get_sentences(paragraph);
-	// 	update_counts(this->counts, get_counts(this->n, sentences));
-	// 	update_counts(this->nMinusOneCounts, get_counts(this->n - 1, sentences));
-	// }
+	for (const string &file : files) {
+		ifstream stream (file);
+		if (!stream) {
+			throw runtime_error("File error when trying to read '" + file + "'\n");
+		}
+
+		string paragraph;
+		while (getline(stream, paragraph)) {
+			vector<string> sentences = get_sentences(paragraph);
+
+			map<Ngram, int> *counts = get_counts(this->n, sentences), *n_minus_one_counts = get_counts(this->n - 1, sentences);
+			update_counts(&this->counts, counts);
+			update_counts(&this->nMinusOneCounts, n_minus_one_counts);
+			for (auto const &it : *n_minus_one_counts) {
+				this->total += it.second;
+			}
+
+			delete counts;
+			delete n_minus_one_counts;
+		}
+	}
 }
 
-/* Returns the probability that the given word will complete the given (n - 1)-gram. */
-double NgramModel::probability(Ngram nMinusOneGram, string word) {
-	double numerator = this->counts[nMinusOneGram.append(word)];
-	double denominator = this->nMinusOneCounts[nMinusOneGram];
+/* Returns the probability that the given word will complete the given (n - 1)-gram, or 0 if the (n - 1)-gram has never
+ * been seen. Only reads the model, so it may be called from several threads at once. */
+double NgramModel::probability(Ngram nMinusOneGram, string word) const {
+	INSTRUMENT_QUERY(PROBABILITY_QUERY);
+	INSTRUMENT_COUNT(NODES_VISITED, 2); // One lookup in each counts map
+	INSTRUMENT_COUNT(ALLOCATIONS, 1); // The n-gram built by append
+	INSTRUMENT_COUNT(ALLOCATED_BYTES, (nMinusOneGram.get_n() + 1) * sizeof(string));
+
+	auto numerator = this->counts.find(nMinusOneGram.append(word));
+	auto denominator = this->nMinusOneCounts.find(nMinusOneGram);
+	if (numerator == this->counts.end() || denominator == this->nMinusOneCounts.end()) {
+		return 0;
+	}
 
-	return numerator / denominator;
+	return (double) numerator->second / denominator->second;
 }
 
-/* Updates the model given a new occurence of an n-gram. */
+/* Updates the model given a new occurence of an n-gram: counts it, and its first n - 1 words as the context it
+ * completes. */
 void NgramModel::update_counts(Ngram gram) {
-	// TODO
+	if (gram.get_n() != this->n || (int) gram.get_words().size() != this->n) {
+		throw runtime_error("Expected a " + to_string(this->n) + "-gram, got a " + to_string(gram.get_n()) + "-gram");
+	}
+
+	vector<string> words = gram.get_words();
+	++this->counts[gram];
+	++this->nMinusOneCounts[Ngram(this->n - 1, vector<string>(words.begin(), words.end() - 1))];
+	++this->total;
+}
+
+/* Private helper function. Appends a counts map to a model payload: the number of n-grams as a uint64, then each n-gram's
+ * words, each a uint32 length and its bytes, and its count as an int32. */
+void NgramModel::write_counts(ModelWriter *writer, const map<Ngram, int> &counts) {
+	writer->write((uint64_t) counts.size());
+	for (auto const &it : counts) {
+		for (const string &word : it.first.get_words()) {
+			writer->write((uint32_t) word.length());
+			writer->write_array(word.data(), word.length());
+		}
+		writer->write((int32_t) it.second);
+	}
+}
+
+/* Private helper function. Reads a counts map of n-grams of the given n, as written by write_counts. */
+map<Ngram, int> NgramModel::read_counts(ModelReader *reader, int n) {
+	uint64_t size = reader->read<uint64_t>();
+	if (size > reader->remaining() / (n * sizeof(uint32_t) + sizeof(int32_t))) {
+		throw runtime_error("Malformed n-gram model\n");
+	}
+
+	map<Ngram, int> ret;
+	vector<string> words (n);
+	for (uint64_t i = 0; i < size; ++i) {
+		for (string &word : words) {
+			uint32_t length = reader->read<uint32_t>();
+			word.assign(reader->read_bytes(length), length);
+		}
+		ret[Ngram(n, words)] = reader->read<int32_t>();
+	}
+
+	return ret;
+}
+
+/* Appends this model's n, total and counts to a model payload. */
+void NgramModel::write(ModelWriter *writer) const {
+	writer->write((int32_t) this->n);
+	writer->write((int32_t) this->total);
+	write_counts(writer, this->counts);
+	write_counts(writer, this->nMinusOneCounts);
+}
+
+/* Replaces this model with one read from a model payload, as written by write. The model is left unchanged if the payload
+ * is malformed. */
+void NgramModel::read(ModelReader *reader) {
+	int n = reader->read<int32_t>(), total = reader->read<int32_t>();
+	if (n < 1 || total < 0) {
+		throw runtime_error("Malformed n-gram model\n");
+	}
+
+	map<Ngram, int> counts = read_counts(reader, n), n_minus_one_counts = read_counts(reader, n - 1);
+	this->n = n;
+	this->total = total;
+	this->counts.swap(counts);
+	this->nMinusOneCounts.swap(n_minus_one_counts);
+}
+
+/* Writes this model to a model file. */
+void NgramModel::save(const string filepath) const {
+	ModelWriter writer (NGRAM_MODEL);
+	this->write(&writer);
+	writer.save(filepath);
+}
+
+/* Replaces this model with that of the given model file, as written by save. The model is left unchanged if the file
+ * can't be loaded. */
+void NgramModel::load(const string filepath) {
+	ModelReader reader (filepath, NGRAM_MODEL);
+	this->read(&reader);
 }
 
 /* End NgramModel class. */
\ No newline at end of file
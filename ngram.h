@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include "model_file.h"
 
 using namespace std;
 
@@ -51,14 +52,30 @@ class NgramModel {
 
 		static map<Ngram, int> * get_counts(int, const vector<string>);
 
+		static void write_counts(ModelWriter *, const map<Ngram, int> &);
+
+		static map<Ngram, int> read_counts(ModelReader *, int);
+
 	public:
 		NgramModel(int);
 
+		int get_n(void) const;
+
 		void initialize(const vector<string>);
 
-		double probability(Ngram, string);
+		double probability(Ngram, string) const;
 
 		void update_counts(Ngram);
+
+		// Persistence
+
+		void write(ModelWriter *) const;
+
+		void read(ModelReader *);
+
+		void save(const string) const;
+
+		void load(const string);
 };
 
 #endif
\ No newline at end of file
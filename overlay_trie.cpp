@@ -0,0 +1,126 @@
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include "overlay_trie.h"
+
+using namespace std;
+
+/* Begin OverlayTrie class. */
+
+/* Starts a view of the given base with no changes of its own. */
+OverlayTrie::OverlayTrie(shared_ptr<const Trie> base) : base(base) {}
+
+/* Returns the number of words inserted, reweighted or removed through this overlay and still in effect. */
+size_t OverlayTrie::num_changes(void) const {
+	size_t removed = 0;
+	for (const string &word : this->shadowed) {
+		removed += !this->additions.count(word);
+	}
+
+	return this->additions.size() + removed;
+}
+
+/* Private helper function. Returns the number of shadowed base words starting with the given prefix. */
+size_t OverlayTrie::shadowed_with_prefix(const string prefix) const {
+	size_t ret = 0;
+	for (auto it = this->shadowed.lower_bound(prefix); it != this->shadowed.end() && it->compare(0, prefix.length(), prefix) == 0; ++it) {
+		++ret;
+	}
+
+	return ret;
+}
+
+/* Inserts the word with the given weight, or gives it that weight if it's already there, returning whether it was
+ * absent. Only the overlay changes. */
+bool OverlayTrie::insert(const string word, double weight) {
+	bool absent = !this->contains(word);
+	if (!this->shadowed.count(word) && this->base->contains(word)) {
+		if (this->base->get_weight(word) == weight) {
+			return false; // The base already says so
+		}
+		this->shadowed.insert(word);
+	}
+	this->additions[word] = weight;
+
+	return absent;
+}
+
+/* Removes the word from this view, returning whether it was there. Only the overlay changes. */
+bool OverlayTrie::remove(const string word) {
+	bool present = this->contains(word);
+	this->additions.erase(word);
+	if (this->base->contains(word)) {
+		this->shadowed.insert(word);
+	}
+
+	return present;
+}
+
+bool OverlayTrie::contains(const string word) const {
+	return this->additions.count(word) || (!this->shadowed.count(word) && this->base->contains(word));
+}
+
+/* Returns the word's weight in this view, or -1 if the word isn't in it. */
+double OverlayTrie::get_weight(const string word) const {
+	auto it = this->additions.find(word);
+	if (it != this->additions.end()) {
+		return it->second;
+	}
+
+	return this->shadowed.count(word) ? -1 : this->base->get_weight(word);
+}
+
+/* Returns the top k completions of the given prefix in this view, heaviest first and alphabetically among equals. The
+ * base is asked for enough more than k to make up for its shadowed words, which are dropped, and the rest is merged with
+ * the user's own completions. */
+vector<string> OverlayTrie::autocomplete(const string prefix, int k) const {
+	vector<pair<double, string>> merged;
+	for (const string &word : this->base->autocomplete(prefix, k + this->shadowed_with_prefix(prefix))) {
+		if (!this->shadowed.count(word)) {
+			merged.push_back(make_pair(this->base->get_weight(word), word));
+		}
+	}
+	for (auto it = this->additions.lower_bound(prefix); it != this->additions.end() && it->first.compare(0, prefix.length(), prefix) == 0; ++it) {
+		merged.push_back(make_pair(it->second, it->first));
+	}
+	sort(merged.begin(), merged.end(), [](const pair<double, string> &a, const pair<double, string> &b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	});
+
+	vector<string> ret;
+	for (size_t i = 0; i < merged.size() && (int) i < k; ++i) {
+		ret.push_back(merged[i].second);
+	}
+
+	return ret;
+}
+
+/* Returns the words of this view within the given distance of the given word, ranked as Trie::autocorrect ranks them: by
+ * distance, then by descending weight, then alphabetically. rank_suggestions orders the merged candidates completely, so
+ * which layer a word came from never decides its place. */
+vector<string> OverlayTrie::autocorrect(const string word, int max_distance) const {
+	vector<tuple<string, double, int>> suggestions;
+	for (const string &suggestion : this->base->autocorrect(word, max_distance)) {
+		if (!this->shadowed.count(suggestion)) {
+			suggestions.push_back(make_tuple(suggestion, this->base->get_weight(suggestion), Trie::levenschtein_distance(word, suggestion)));
+		}
+	}
+	for (const pair<const string, double> &addition : this->additions) {
+		/* Words differing in length by more than max_distance can't be within it. */
+		if (addition.first.length() + max_distance >= word.length() && addition.first.length() <= word.length() + max_distance) {
+			int distance = Trie::levenschtein_distance(word, addition.first);
+			if (distance <= max_distance) {
+				suggestions.push_back(make_tuple(addition.first, addition.second, distance));
+			}
+		}
+	}
+
+	return Trie::rank_suggestions(word, suggestions);
+}
+
+/* End OverlayTrie class. */
@@ -0,0 +1,54 @@
+#ifndef OVERLAY_TRIE_H
+#define OVERLAY_TRIE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <cstddef>
+#include "trie.h"
+
+using namespace std;
+
+/* One user's view of a shared base dictionary: the base Trie plus the user's own changes, kept apart from it. Words the
+ * user inserts or reweights go into a sorted map of additions; base words the user removes or reweights are listed as
+ * shadowed, so that lookups skip their base entries. Queries merge the two on the fly, without building the merged
+ * trie, so any number of overlays share every node of the base and each costs about the size of its changes. The
+ * additions are scanned rather than indexed (by prefix range for autocomplete, in full for autocorrect), which suits
+ * the few hundred words a personal dictionary holds.
+ *
+ * The base is held through a shared_ptr to const, and must not be changed while overlays of it exist. */
+class OverlayTrie {
+	private:
+		shared_ptr<const Trie> base;
+		map<string, double> additions; // Words inserted or reweighted by the user, with their current weights
+		set<string> shadowed; // Base words removed or reweighted by the user
+
+		size_t shadowed_with_prefix(const string) const;
+
+	public:
+		// Constructors
+
+		OverlayTrie(shared_ptr<const Trie>);
+
+		// Getters
+
+		size_t num_changes(void) const;
+
+		// Functionality
+
+		bool insert(const string, double);
+
+		bool remove(const string);
+
+		bool contains(const string) const;
+
+		double get_weight(const string) const;
+
+		vector<string> autocomplete(const string, int) const;
+
+		vector<string> autocorrect(const string, int) const;
+};
+
+#endif
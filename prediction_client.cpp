@@ -0,0 +1,104 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "prediction_client.h"
+
+using namespace std;
+
+/* Begin PredictionClient class. */
+
+/* Connects to the server listening on the given socket path. */
+PredictionClient::PredictionClient(const string socket_path) : next_id(0) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socket_path.length() >= sizeof(address.sun_path)) {
+		throw runtime_error("Socket path '" + socket_path + "' is too long");
+	}
+	strcpy(address.sun_path, socket_path.c_str());
+
+	if ((this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		throw runtime_error(string("Unable to create socket: ") + strerror(errno));
+	}
+	if (connect(this->fd, (sockaddr *) &address, sizeof(address)) != 0) {
+		string message = "Unable to connect to '" + socket_path + "': " + strerror(errno);
+		close(this->fd);
+		throw runtime_error(message);
+	}
+}
+
+vector<string> PredictionClient::query(RequestType type, uint8_t parameter, const vector<string> &context, const string text) {
+	uint32_t id = this->send(PredictionRequest {0, type, parameter, context, text});
+	PredictionResponse response = this->receive();
+	if (response.id != id) {
+		throw runtime_error("Response out of order: expected " + to_string(id) + ", got " + to_string(response.id));
+	}
+	if (response.status != RESPONSE_OK) {
+		throw runtime_error("Prediction server error: " + (response.words.empty() ? string("unknown") : response.words[0]));
+	}
+
+	return response.words;
+}
+
+/* Returns the top k completions of the given prefix. */
+vector<string> PredictionClient::autocomplete(const string prefix, int k) {
+	return this->query(AUTOCOMPLETE_REQUEST, min(max(k, 0), 255), vector<string>(), prefix);
+}
+
+/* Returns the dictionary words within the given edit distance of the given word, best first. */
+vector<string> PredictionClient::autocorrect(const string word, int distance) {
+	return this->query(AUTOCORRECT_REQUEST, min(max(distance, 0), 255), vector<string>(), word);
+}
+
+/* Returns the k likeliest next words after the given previous words, among those starting with the given prefix, which
+ * may be empty. */
+vector<string> PredictionClient::next_word(const vector<string> &context, const string prefix, int k) {
+	return this->query(NEXT_WORD_REQUEST, min(max(k, 0), 255), context, prefix);
+}
+
+/* Sends the given request, without waiting for its response, under a fresh ID, which is returned. */
+uint32_t PredictionClient::send(PredictionRequest request) {
+	request.id = this->next_id++;
+	string frame;
+	encode_request(request, &frame);
+
+	size_t sent = 0;
+	while (sent < frame.length()) {
+		ssize_t n = ::send(this->fd, frame.data() + sent, frame.length() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno != EINTR) {
+			throw runtime_error(string("Unable to send request: ") + strerror(errno));
+		}
+		sent += max(n, (ssize_t) 0);
+	}
+
+	return request.id;
+}
+
+/* Blocks for the response to the oldest request sent and not yet received. */
+PredictionResponse PredictionClient::receive(void) {
+	PredictionResponse response;
+	char buffer[65536];
+	size_t length;
+	while ((length = decode_response(this->input.data(), this->input.length(), &response)) == 0) {
+		ssize_t n = read(this->fd, buffer, sizeof(buffer));
+		if (n == 0) {
+			throw runtime_error("Prediction server closed the connection");
+		} else if (n < 0 && errno != EINTR) {
+			throw runtime_error(string("Unable to receive response: ") + strerror(errno));
+		}
+		this->input.append(buffer, max(n, (ssize_t) 0));
+	}
+	this->input.erase(0, length);
+
+	return response;
+}
+
+PredictionClient::~PredictionClient(void) { close(this->fd); }
+
+/* End PredictionClient class. */
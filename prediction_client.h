@@ -0,0 +1,49 @@
+#ifndef PREDICTION_CLIENT_H
+#define PREDICTION_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "prediction_protocol.h"
+
+using namespace std;
+
+/* Connection to a PredictionServer. The query functions send one request and block for its answer, throwing
+ * runtime_error if the server reports an error or the connection fails. To keep several requests in flight, send them
+ * with send and collect the responses, which come back in the same order, with receive. Not safe to share between
+ * threads; open one client per thread instead. */
+class PredictionClient {
+	private:
+		int fd;
+		uint32_t next_id;
+		string input; // Bytes received but not yet decoded
+
+		vector<string> query(RequestType, uint8_t, const vector<string> &, const string);
+
+	public:
+		// Constructors
+
+		PredictionClient(const string);
+
+		PredictionClient(const PredictionClient &) = delete;
+
+		// Functionality
+
+		vector<string> autocomplete(const string, int);
+
+		vector<string> autocorrect(const string, int);
+
+		vector<string> next_word(const vector<string> &, const string, int);
+
+		uint32_t send(PredictionRequest);
+
+		PredictionResponse receive(void);
+
+		// Other
+
+		PredictionClient & operator =(const PredictionClient &) = delete;
+
+		~PredictionClient(void);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include "trie.h"
+#include "ngram.h"
+#include "prediction_server.h"
+
+using namespace std;
+
+/* Prediction daemon: loads a dictionary and, optionally, an n-gram model once, and serves them to local applications
+ * through PredictionServer until interrupted. Built separately from main.cpp against the same sources by
+ * `make prediction_daemon`. Applications talk to it through PredictionClient. */
+
+static PredictionServer *server = NULL;
+
+static void handle_signal(int) {
+	if (server != NULL) {
+		server->stop();
+	}
+}
+
+static void usage(const char *name) {
+	cerr << "Usage: " << name << " --dictionary <file> [options]" << endl;
+	cerr << "    --dictionary <file>   dictionary in the format of Trie::insert_from_file, with weights" << endl;
+	cerr << "    --text <file>         text to build the n-gram model for next words from; may be repeated" << endl;
+	cerr << "    --n <n>               n of the n-gram model (default 3)" << endl;
+	cerr << "    --socket <path>       socket to listen on (default /tmp/predictive-text.sock)" << endl;
+	cerr << "    --threads <n>         threads answering requests (default: one per core)" << endl;
+	cerr << "    --max-batch <n>       requests answered per batch at most (default 256)" << endl;
+}
+
+int main(int argc, char **argv) {
+	string dictionary_path, socket_path = "/tmp/predictive-text.sock";
+	vector<string> text_paths;
+	int n = 3, num_threads = max((int) thread::hardware_concurrency(), 1), max_batch = 256;
+	for (int i = 1; i < argc; ++i) {
+		string flag = argv[i];
+		bool has_value = i + 1 < argc;
+		if (flag == "--dictionary" && has_value) {
+			dictionary_path = argv[++i];
+		} else if (flag == "--text" && has_value) {
+			text_paths.push_back(argv[++i]);
+		} else if (flag == "--n" && has_value) {
+			n = max(atoi(argv[++i]), 2);
+		} else if (flag == "--socket" && has_value) {
+			socket_path = argv[++i];
+		} else if (flag == "--threads" && has_value) {
+			num_threads = max(atoi(argv[++i]), 1);
+		} else if (flag == "--max-batch" && has_value) {
+			max_batch = max(atoi(argv[++i]), 1);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (dictionary_path.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+	Trie trie;
+	trie.insert_from_file(dictionary_path, true);
+	trie.build_deletion_index();
+	trie.build_membership_filter();
+
+	NgramModel model (n);
+	if (!text_paths.empty()) {
+		model.initialize(text_paths);
+	}
+
+	PredictionServer prediction_server (&trie, text_paths.empty() ? NULL : &model, socket_path, num_threads, max_batch);
+	server = &prediction_server;
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = handle_signal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	cerr << "Loaded in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s; listening on "
+		 << socket_path << " with " << num_threads << " threads" << endl;
+
+	prediction_server.run();
+	server = NULL;
+	cerr << "Served " << prediction_server.get_num_requests() << " requests in " << prediction_server.get_num_batches()
+		 << " batches" << endl;
+
+	return 0;
+}
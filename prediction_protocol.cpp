@@ -0,0 +1,178 @@
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "prediction_protocol.h"
+
+using namespace std;
+
+/* Integers are written byte by byte, so the format is little-endian whatever the host. */
+static void put(string *out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; ++i) {
+		out->push_back((char) (value >> (8 * i)));
+	}
+}
+
+static void put_double(string *out, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put(out, bits, 8);
+}
+
+static void put_string(string *out, const string &s) {
+	if (s.length() > UINT16_MAX) {
+		throw runtime_error("String of " + to_string(s.length()) + " bytes is too long to send");
+	}
+	put(out, s.length(), 2);
+	out->append(s);
+}
+
+/* Reads the fields of one frame's body, throwing if they run past its end. */
+class FrameReader {
+	private:
+		const unsigned char *position, *end;
+
+		void check(size_t n) const {
+			if ((size_t) (this->end - this->position) < n) {
+				throw runtime_error("Malformed frame: fields run past its end");
+			}
+		}
+
+	public:
+		FrameReader(const char *body, size_t size) : position((const unsigned char *) body), end(position + size) {}
+
+		uint64_t get(int bytes) {
+			this->check(bytes);
+			uint64_t value = 0;
+			for (int i = 0; i < bytes; ++i) {
+				value |= (uint64_t) this->position[i] << (8 * i);
+			}
+			this->position += bytes;
+			return value;
+		}
+
+		double get_double(void) {
+			uint64_t bits = this->get(8);
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		string get_string(void) {
+			size_t length = this->get(2);
+			this->check(length);
+			string ret ((const char *) this->position, length);
+			this->position += length;
+			return ret;
+		}
+
+		bool at_end(void) const { return this->position == this->end; }
+};
+
+/* Returns the size of the body of the frame at the start of the given bytes, or throws if it is too large. */
+static size_t body_size(const char *bytes) {
+	size_t size = FrameReader(bytes, 4).get(4);
+	if (size > max_frame_size) {
+		throw runtime_error("Malformed frame: " + to_string(size) + " bytes long");
+	}
+
+	return size;
+}
+
+/* Appends the given request to out, as a frame. */
+void encode_request(const PredictionRequest &request, string *out) {
+	if (request.context.size() > UINT8_MAX) {
+		throw runtime_error("Too many context words to send");
+	}
+
+	string body;
+	put(&body, request.id, 4);
+	put(&body, request.type, 1);
+	put(&body, request.parameter, 1);
+	put(&body, request.context.size(), 1);
+	for (const string &word : request.context) {
+		put_string(&body, word);
+	}
+	put_string(&body, request.text);
+
+	put(out, body.length(), 4);
+	out->append(body);
+}
+
+/* Decodes the request framed at the start of the given bytes into request, and returns the length of the frame, or 0 if
+ * the bytes don't hold a whole frame yet. Throws runtime_error if the frame is malformed. */
+size_t decode_request(const char *bytes, size_t size, PredictionRequest *request) {
+	if (size < 4 || size < 4 + body_size(bytes)) {
+		return 0;
+	}
+
+	size_t length = body_size(bytes);
+	FrameReader reader (bytes + 4, length);
+	request->id = reader.get(4);
+	uint8_t type = reader.get(1);
+	if (type != AUTOCOMPLETE_REQUEST && type != AUTOCORRECT_REQUEST && type != NEXT_WORD_REQUEST) {
+		throw runtime_error("Malformed request: unknown type " + to_string(type));
+	}
+	request->type = (RequestType) type;
+	request->parameter = reader.get(1);
+	request->context.resize(reader.get(1));
+	for (string &word : request->context) {
+		word = reader.get_string();
+	}
+	request->text = reader.get_string();
+	if (!reader.at_end()) {
+		throw runtime_error("Malformed request: trailing bytes");
+	}
+
+	return 4 + length;
+}
+
+/* Appends the given response to out, as a frame. */
+void encode_response(const PredictionResponse &response, string *out) {
+	if (response.words.size() > UINT16_MAX) {
+		throw runtime_error("Too many words to send");
+	} else if (response.scores.size() != response.words.size()) {
+		throw runtime_error("Response needs one score per word");
+	}
+
+	string body;
+	put(&body, response.id, 4);
+	put(&body, response.status, 1);
+	put(&body, response.words.size(), 2);
+	for (size_t i = 0; i < response.words.size(); ++i) {
+		put_string(&body, response.words[i]);
+		put_double(&body, response.scores[i]);
+	}
+
+	put(out, body.length(), 4);
+	out->append(body);
+}
+
+/* As decode_request, for responses. */
+size_t decode_response(const char *bytes, size_t size, PredictionResponse *response) {
+	if (size < 4 || size < 4 + body_size(bytes)) {
+		return 0;
+	}
+
+	size_t length = body_size(bytes);
+	FrameReader reader (bytes + 4, length);
+	response->id = reader.get(4);
+	uint8_t status = reader.get(1);
+	if (status != RESPONSE_OK && status != RESPONSE_ERROR) {
+		throw runtime_error("Malformed response: unknown status " + to_string(status));
+	}
+	response->status = (ResponseStatus) status;
+	response->words.resize(reader.get(2));
+	response->scores.resize(response->words.size());
+	for (size_t i = 0; i < response->words.size(); ++i) {
+		response->words[i] = reader.get_string();
+		response->scores[i] = reader.get_double();
+	}
+	if (!reader.at_end()) {
+		throw runtime_error("Malformed response: trailing bytes");
+	}
+
+	return 4 + length;
+}
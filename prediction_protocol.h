@@ -0,0 +1,58 @@
+#ifndef PREDICTION_PROTOCOL_H
+#define PREDICTION_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Wire format spoken between PredictionServer and PredictionClient over a Unix stream socket. Each message is a frame:
+ * a uint32 byte count followed by that many bytes of body. Request bodies are
+ *     id           uint32   chosen by the client and echoed in the response
+ *     type         uint8    a RequestType
+ *     parameter    uint8    the number of words wanted, or the maximum edit distance for autocorrect
+ *     num_context  uint8    previous words, which only next-word requests use
+ *     context      num_context strings
+ *     text         string   the prefix, or the word to correct
+ * and response bodies are
+ *     id           uint32
+ *     status       uint8    a ResponseStatus
+ *     num_words    uint16
+ *     words        num_words pairs of a string and a float64 score, best first, or a single error message scored 0
+ * where a string is a uint16 length followed by its bytes. A word's score is its dictionary weight, or for next words its
+ * probability given the context (its weight if the server has no n-gram model). All numbers are little-endian. A
+ * connection may have any number of requests in flight; responses come back in the order the requests were sent. */
+
+enum RequestType : uint8_t { AUTOCOMPLETE_REQUEST = 1, AUTOCORRECT_REQUEST = 2, NEXT_WORD_REQUEST = 3 };
+
+enum ResponseStatus : uint8_t { RESPONSE_OK = 0, RESPONSE_ERROR = 1 };
+
+struct PredictionRequest {
+	uint32_t id;
+	RequestType type;
+	uint8_t parameter;
+	vector<string> context;
+	string text;
+};
+
+struct PredictionResponse {
+	uint32_t id;
+	ResponseStatus status;
+	vector<string> words;
+	vector<double> scores; // One per word
+};
+
+/* Frames larger than this are rejected as malformed. */
+const size_t max_frame_size = 1 << 24;
+
+void encode_request(const PredictionRequest &, string *);
+
+size_t decode_request(const char *, size_t, PredictionRequest *);
+
+void encode_response(const PredictionResponse &, string *);
+
+size_t decode_response(const char *, size_t, PredictionResponse *);
+
+#endif
@@ -0,0 +1,335 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "prediction_server.h"
+
+using namespace std;
+
+static string error_message(const string what) { return what + ": " + strerror(errno); }
+
+/* Begin PredictionServer class. */
+
+/* Listens on the given socket path, replacing any socket left there, with a pool of the given number of threads answering
+ * batches of at most max_batch requests. */
+PredictionServer::PredictionServer(Trie *trie, const NgramModel *model, const string socket_path,
+	int num_threads /* = thread::hardware_concurrency() */, size_t max_batch /* = 256 */)
+	: trie(trie), model(model), socket_path(socket_path), listener(-1), epoll(-1), wakeup(-1), pool(max(num_threads, 1)),
+	  max_batch(max(max_batch, (size_t) 1)), stopping(false), num_requests(0), num_batches(0) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socket_path.length() >= sizeof(address.sun_path)) {
+		throw runtime_error("Socket path '" + socket_path + "' is too long");
+	}
+	strcpy(address.sun_path, socket_path.c_str());
+
+	string failure;
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	if ((this->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+		failure = error_message("Unable to create socket");
+	} else if (unlink(socket_path.c_str()) != 0 && errno != ENOENT) {
+		failure = error_message("Unable to replace '" + socket_path + "'");
+	} else if (bind(this->listener, (sockaddr *) &address, sizeof(address)) != 0 || listen(this->listener, SOMAXCONN) != 0) {
+		failure = error_message("Unable to listen on '" + socket_path + "'");
+	} else if ((this->epoll = epoll_create1(EPOLL_CLOEXEC)) < 0 || (this->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		failure = error_message("Unable to create event loop");
+	} else {
+		event.data.fd = this->listener;
+		epoll_ctl(this->epoll, EPOLL_CTL_ADD, this->listener, &event);
+		event.data.fd = this->wakeup;
+		epoll_ctl(this->epoll, EPOLL_CTL_ADD, this->wakeup, &event);
+		return;
+	}
+
+	for (int fd : {this->listener, this->epoll, this->wakeup}) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	throw runtime_error(failure);
+}
+
+uint64_t PredictionServer::get_num_requests(void) const { return this->num_requests.load(); }
+
+uint64_t PredictionServer::get_num_batches(void) const { return this->num_batches.load(); }
+
+void PredictionServer::accept_connections(void) {
+	int fd;
+	while ((fd = accept4(this->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if (epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+			close(fd);
+			continue;
+		}
+		this->connections[fd] = Connection {fd, "", "", false, false, false};
+	}
+}
+
+/* Reads everything the connection has sent so far. End of file marks it finished, so that what it sent before is still
+ * answered; an error, or input beyond max_buffer_bytes, marks it closed. */
+void PredictionServer::receive(Connection *connection) {
+	char buffer[65536];
+	while (true) {
+		ssize_t n = read(connection->fd, buffer, sizeof(buffer));
+		if (n > 0) {
+			connection->input.append(buffer, n);
+			if (connection->input.length() > max_buffer_bytes) {
+				connection->closed = true;
+				return;
+			}
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n == 0) {
+			connection->finished = true;
+			this->watch(connection);
+			return;
+		} else {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				connection->closed = true;
+			}
+			return;
+		}
+	}
+}
+
+/* Writes as much pending output as the socket takes, and has epoll watch for writability exactly while some is left. */
+void PredictionServer::send(Connection *connection) {
+	size_t sent = 0;
+	while (sent < connection->output.length()) {
+		ssize_t n = ::send(connection->fd, connection->output.data() + sent, connection->output.length() - sent, MSG_NOSIGNAL);
+		if (n >= 0) {
+			sent += n;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			break;
+		} else if (errno != EINTR) {
+			connection->closed = true;
+			return;
+		}
+	}
+	connection->output.erase(0, sent);
+
+	if (!connection->output.empty() != connection->writing) {
+		connection->writing = !connection->output.empty();
+		this->watch(connection);
+	}
+}
+
+/* Has epoll watch the connection for readability until it has finished sending, and for writability while it is being
+ * written to. */
+void PredictionServer::watch(Connection *connection) {
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	if (!connection->finished) {
+		event.events |= EPOLLIN;
+	}
+	if (connection->writing) {
+		event.events |= EPOLLOUT;
+	}
+	event.data.fd = connection->fd;
+	epoll_ctl(this->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/* Moves up to limit whole requests from the connection's input to the batch, and returns whether whole requests are left
+ * over. A malformed frame closes the connection. */
+bool PredictionServer::decode(Connection *connection, vector<pair<int, PredictionRequest>> *batch, size_t limit) {
+	size_t position = 0, length;
+	PredictionRequest request;
+	bool left_over = false;
+	try {
+		while ((length = decode_request(connection->input.data() + position, connection->input.length() - position, &request)) > 0) {
+			if (limit == 0) {
+				left_over = true;
+				break;
+			}
+			batch->push_back(make_pair(connection->fd, request));
+			position += length;
+			--limit;
+		}
+	} catch (const runtime_error &e) {
+		connection->closed = true;
+	}
+	connection->input.erase(0, position);
+
+	return left_over;
+}
+
+/* Answers one request. Errors, such as an edit distance above max_autocorrect_distance, are returned as error responses
+ * carrying their message. Safe to call from several threads at once. */
+PredictionResponse PredictionServer::answer(const PredictionRequest &request) const {
+	PredictionResponse response;
+	response.id = request.id;
+	response.status = RESPONSE_OK;
+	try {
+		if (request.type == AUTOCOMPLETE_REQUEST) {
+			response.words = this->trie->autocomplete(request.text, request.parameter);
+		} else if (request.type == AUTOCORRECT_REQUEST) {
+			if (request.parameter > max_autocorrect_distance) {
+				throw runtime_error("Edit distance " + to_string(request.parameter) + " is above the maximum of "
+					+ to_string(max_autocorrect_distance));
+			}
+			response.words = this->trie->autocorrect(request.text, request.parameter);
+			response.words.resize(min(response.words.size(), (size_t) UINT16_MAX));
+		}
+		for (const string &word : response.words) {
+			response.scores.push_back(this->trie->get_weight(word));
+		}
+
+		if (request.type == NEXT_WORD_REQUEST) {
+			/* Next words: the heaviest completions of the prefix (which may be empty), reordered by their probability
+			 * given the last n - 1 words of context if there are that many. The sort is stable, so ties keep the
+			 * dictionary's order. */
+			vector<string> candidates = this->trie->autocomplete(request.text, next_word_candidates);
+			vector<pair<double, string>> scored;
+			int n = this->model != NULL ? this->model->get_n() : 0;
+			if (n > 1 && (int) request.context.size() >= n - 1) {
+				Ngram context (n - 1, vector<string>(request.context.end() - (n - 1), request.context.end()));
+				for (const string &candidate : candidates) {
+					scored.push_back(make_pair(this->model->probability(context, candidate), candidate));
+				}
+				stable_sort(scored.begin(), scored.end(), [](const pair<double, string> &a, const pair<double, string> &b) {
+					return a.first > b.first;
+				});
+			} else {
+				for (const string &candidate : candidates) {
+					scored.push_back(make_pair(this->trie->get_weight(candidate), candidate));
+				}
+			}
+
+			for (size_t i = 0; i < scored.size() && i < request.parameter; ++i) {
+				response.words.push_back(scored[i].second);
+				response.scores.push_back(scored[i].first);
+			}
+		}
+	} catch (const exception &e) {
+		response.status = RESPONSE_ERROR;
+		response.words = vector<string>(1, e.what());
+		response.scores = vector<double>(1, 0);
+	}
+
+	return response;
+}
+
+/* Serves requests until stop() is called. */
+void PredictionServer::run(void) {
+	vector<epoll_event> events (256);
+	vector<pair<int, PredictionRequest>> batch;
+	vector<PredictionResponse> responses;
+	bool backlog = false; // Whether whole requests were left over from the last batch, so that epoll mustn't block
+
+	while (!this->stopping) {
+		int n = epoll_wait(this->epoll, events.data(), events.size(), backlog ? 0 : -1);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw runtime_error(error_message("Event loop failed"));
+		}
+
+		for (int i = 0; i < n; ++i) {
+			int fd = events[i].data.fd;
+			if (fd == this->listener) {
+				this->accept_connections();
+			} else if (fd == this->wakeup) {
+				uint64_t value;
+				ssize_t ignored = read(this->wakeup, &value, sizeof(value));
+				(void) ignored;
+			} else if (this->connections.count(fd)) {
+				Connection &connection = this->connections[fd];
+				if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !connection.finished) {
+					this->receive(&connection);
+				}
+				if ((events[i].events & EPOLLOUT) && !connection.closed) {
+					this->send(&connection);
+				}
+			}
+		}
+
+		/* Gather the batch. */
+		batch.clear();
+		backlog = false;
+		for (auto &it : this->connections) {
+			if (!it.second.closed && !it.second.input.empty()) {
+				bool left_over = this->decode(&it.second, &batch, this->max_batch - batch.size());
+				backlog |= left_over;
+				if (it.second.finished && !left_over) {
+					it.second.input.clear(); // A partial frame that can never be completed
+				}
+			}
+		}
+
+		/* Answer it, and queue the responses. */
+		if (!batch.empty()) {
+			responses.resize(batch.size());
+			if (batch.size() == 1) {
+				responses[0] = this->answer(batch[0].second);
+			} else {
+				this->pool.parallel_for(batch.size(), [&](int i, int) { responses[i] = this->answer(batch[i].second); });
+			}
+			this->num_requests += batch.size();
+			++this->num_batches;
+
+			for (size_t i = 0; i < batch.size(); ++i) {
+				Connection &connection = this->connections[batch[i].first];
+				try {
+					encode_response(responses[i], &connection.output);
+				} catch (const exception &e) { // A response that can't be framed, such as one holding a word too long to send
+					encode_response(PredictionResponse {responses[i].id, RESPONSE_ERROR, vector<string>(1, e.what()), vector<double>(1, 0)},
+						&connection.output);
+				}
+				if (connection.output.length() > max_buffer_bytes) {
+					connection.closed = true; // Not reading its responses
+				}
+			}
+		}
+
+		/* Write responses, and drop closed connections and finished ones with nothing left to answer or send; closing a
+		 * descriptor also removes it from epoll. */
+		for (auto it = this->connections.begin(); it != this->connections.end();) {
+			if (!it->second.closed && !it->second.writing && !it->second.output.empty()) {
+				this->send(&it->second);
+			}
+			if (it->second.closed || (it->second.finished && it->second.input.empty() && it->second.output.empty())) {
+				close(it->first);
+				it = this->connections.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+
+/* Makes run() return, from any thread or a signal handler. */
+void PredictionServer::stop(void) {
+	this->stopping = true;
+	uint64_t one = 1;
+	ssize_t ignored = write(this->wakeup, &one, sizeof(one));
+	(void) ignored;
+}
+
+PredictionServer::~PredictionServer(void) {
+	for (auto &it : this->connections) {
+		close(it.first);
+	}
+	close(this->listener);
+	close(this->epoll);
+	close(this->wakeup);
+	unlink(this->socket_path.c_str());
+}
+
+/* End PredictionServer class. */
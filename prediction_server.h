@@ -0,0 +1,97 @@
+#ifndef PREDICTION_SERVER_H
+#define PREDICTION_SERVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include "trie.h"
+#include "ngram.h"
+#include "thread_pool.h"
+#include "prediction_protocol.h"
+
+using namespace std;
+
+/* Serves autocomplete, autocorrect and next-word requests, in the format of prediction_protocol.h, over a Unix domain
+ * socket, so that one process holds the dictionary and models for every application on the machine.
+ *
+ * One thread runs an epoll loop over the listening socket and all connections. Each round it reads whatever every ready
+ * connection has sent and decodes the whole frames into one batch, up to max_batch requests; the batch is answered by a
+ * fixed ThreadPool, whose calling thread is the loop's own, and the responses are written back before the next round.
+ * Requests that arrive while a batch is being answered therefore make up the next batch, so batches grow with the load
+ * and each pays for one wakeup of the pool rather than one per request. Writes that would block are finished when the
+ * socket becomes writable again.
+ *
+ * A client may shut down its side of the connection once it has sent its requests: they are still answered, and the
+ * connection is closed once the responses are sent. A connection is closed at once if it sends a malformed frame, or if
+ * its unanswered input or unsent output passes max_buffer_bytes, so that a client sending faster than it is answered, or
+ * not reading its responses, can't grow the server without bound.
+ *
+ * Queries only read the Trie and NgramModel, which must not be modified while the server runs. */
+class PredictionServer {
+	private:
+		struct Connection {
+			int fd;
+			string input; // Bytes received but not yet decoded
+			string output; // Bytes of responses not yet sent
+			bool writing; // Whether epoll is watching for writability
+			bool finished; // Whether the client has shut down its side, so that nothing more will be read
+			bool closed; // Whether to drop the connection without answering it further
+		};
+
+		Trie *trie;
+		const NgramModel *model; // NULL to rank next words by dictionary weight alone
+		string socket_path;
+		int listener, epoll, wakeup; // The wakeup eventfd is written by stop()
+		ThreadPool pool;
+		size_t max_batch;
+		map<int, Connection> connections;
+		atomic<bool> stopping;
+		atomic<uint64_t> num_requests, num_batches;
+
+		static const int max_autocorrect_distance = 3;
+		static const int next_word_candidates = 50; // Completions of the prefix ranked by the model
+		static const size_t max_buffer_bytes = 4 << 20; // Most input or output buffered per connection
+
+		void accept_connections(void);
+
+		void receive(Connection *);
+
+		void send(Connection *);
+
+		void watch(Connection *);
+
+		bool decode(Connection *, vector<pair<int, PredictionRequest>> *, size_t);
+
+	public:
+		// Constructors
+
+		PredictionServer(Trie *, const NgramModel *, const string, int = thread::hardware_concurrency(), size_t = 256);
+
+		PredictionServer(const PredictionServer &) = delete;
+
+		// Getters
+
+		uint64_t get_num_requests(void) const;
+
+		uint64_t get_num_batches(void) const;
+
+		// Functionality
+
+		PredictionResponse answer(const PredictionRequest &) const;
+
+		void run(void);
+
+		void stop(void);
+
+		// Other
+
+		PredictionServer & operator =(const PredictionServer &) = delete;
+
+		~PredictionServer(void);
+};
+
+#endif
@@ -0,0 +1,439 @@
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "radix_trie.h"
+#include "trie.h"
+#include "best_first.h"
+#include "tokenizer.h"
+
+using namespace std;
+
+/* Begin RadixTrie class. */
+
+RadixTrie::RadixTrie(void) : dead_bytes(0), num_words(0) {
+	this->allocate_node(0, 0);
+}
+
+string_view RadixTrie::label(int n) const {
+	return string_view(this->pool.data() + this->nodes[n].label_offset, this->nodes[n].label_length);
+}
+
+/* Returns a new childless, non-terminal node whose label is the given span of the pool. */
+int RadixTrie::allocate_node(uint32_t label_offset, uint32_t label_length) {
+	RadixNode node = {label_offset, label_length, -1, -1, false, -1, - numeric_limits<double>::infinity()};
+
+	if (this->free_nodes.empty()) {
+		this->nodes.push_back(node);
+		return this->nodes.size() - 1;
+	}
+
+	int n = this->free_nodes.back();
+	this->free_nodes.pop_back();
+	this->nodes[n] = node;
+	return n;
+}
+
+void RadixTrie::free_node(int n) {
+	this->dead_bytes += this->nodes[n].label_length;
+	this->nodes[n].label_length = 0;
+	this->free_nodes.push_back(n);
+}
+
+/* Returns the child of node n whose label starts with the given byte, or -1 if there is none. If previous is given, it
+ * receives the sibling ordered just before where such a child is or would be, or -1 if it would come first. */
+int RadixTrie::find_child(int n, unsigned char c, int *previous /* = NULL */) const {
+	int before = -1;
+	for (int child = this->nodes[n].first_child; child >= 0; child = this->nodes[child].next_sibling) {
+		unsigned char first = this->pool[this->nodes[child].label_offset];
+		if (first >= c) {
+			if (previous != NULL) {
+				*previous = before;
+			}
+
+			return first == c ? child : -1;
+		}
+		before = child;
+	}
+
+	if (previous != NULL) {
+		*previous = before;
+	}
+
+	return -1;
+}
+
+/* Adds child to parent's children, keeping them ordered by the first byte of their labels. */
+void RadixTrie::link_child(int parent, int child) {
+	int previous;
+	this->find_child(parent, this->pool[this->nodes[child].label_offset], &previous);
+
+	if (previous < 0) {
+		this->nodes[child].next_sibling = this->nodes[parent].first_child;
+		this->nodes[parent].first_child = child;
+	} else {
+		this->nodes[child].next_sibling = this->nodes[previous].next_sibling;
+		this->nodes[previous].next_sibling = child;
+	}
+}
+
+void RadixTrie::unlink_child(int parent, int child) {
+	int previous;
+	this->find_child(parent, this->pool[this->nodes[child].label_offset], &previous);
+
+	if (previous < 0) {
+		this->nodes[parent].first_child = this->nodes[child].next_sibling;
+	} else {
+		this->nodes[previous].next_sibling = this->nodes[child].next_sibling;
+	}
+	this->nodes[child].next_sibling = -1;
+}
+
+/* Folds the only child of node n into n, which must neither end a word nor be the root. The merged label reuses the pool
+ * when the two labels are adjacent in it, and is otherwise appended to the pool. */
+void RadixTrie::merge_with_child(int n) {
+	int child = this->nodes[n].first_child;
+	RadixNode &node = this->nodes[n], &only = this->nodes[child];
+
+	if (node.label_offset + node.label_length == only.label_offset) {
+		node.label_length += only.label_length;
+		only.label_length = 0;
+	} else {
+		string merged = string(this->label(n)) + string(this->label(child));
+		this->dead_bytes += node.label_length;
+		node.label_offset = this->pool.size();
+		node.label_length = merged.length();
+		this->pool += merged;
+	}
+
+	node.end = only.end;
+	node.weight = only.weight;
+	node.max_weight = only.max_weight;
+	node.first_child = only.first_child;
+	this->free_node(child);
+}
+
+/* Recomputes the maximum weight below node n from its own weight and its children's maximum weights. */
+void RadixTrie::update_max_weight(int n) {
+	double best = this->nodes[n].end ? this->nodes[n].weight : - numeric_limits<double>::infinity();
+	for (int child = this->nodes[n].first_child; child >= 0; child = this->nodes[child].next_sibling) {
+		best = max(best, this->nodes[child].max_weight);
+	}
+
+	this->nodes[n].max_weight = best;
+}
+
+/* Returns the node reached by exactly the given word, or -1 if the word leads off the trie or ends inside an edge. If path
+ * is given, it receives the nodes along the way, root first. */
+int RadixTrie::find(string_view word, vector<int> *path /* = NULL */) const {
+	int n = 0;
+	size_t i = 0;
+	if (path != NULL) {
+		path->assign(1, 0);
+	}
+
+	while (i < word.length()) {
+		n = this->find_child(n, word[i]);
+		if (n < 0) {
+			return -1;
+		}
+
+		string_view edge = this->label(n);
+		if (word.compare(i, edge.length(), edge) != 0) {
+			return -1;
+		}
+
+		i += edge.length();
+		if (path != NULL) {
+			path->push_back(n);
+		}
+	}
+
+	return n;
+}
+
+/* Rewrites the pool with only the labels still in use, laid out in depth-first order. */
+void RadixTrie::compact(void) {
+	string compacted;
+	compacted.reserve(this->pool.size() - this->dead_bytes);
+
+	vector<int> stack (1, 0);
+	while (!stack.empty()) {
+		int n = stack.back();
+		stack.pop_back();
+
+		uint32_t offset = compacted.size();
+		compacted += this->label(n);
+		this->nodes[n].label_offset = offset;
+
+		for (int child = this->nodes[n].first_child; child >= 0; child = this->nodes[child].next_sibling) {
+			stack.push_back(child);
+		}
+	}
+
+	this->pool.swap(compacted);
+	this->dead_bytes = 0;
+}
+
+size_t RadixTrie::size(void) const { return this->num_words; }
+
+RadixTrie::Stats RadixTrie::stats(void) const {
+	Stats ret;
+	ret.nodes = this->nodes.size() - this->free_nodes.size();
+	ret.words = this->num_words;
+	ret.pool_bytes = this->pool.size();
+	ret.memory_bytes = this->nodes.capacity() * sizeof(RadixNode) + this->pool.capacity() + this->free_nodes.capacity() * sizeof(int);
+	return ret;
+}
+
+bool RadixTrie::insert(const string word) { return this->insert(word, 0); }
+
+/* Inserts the word-weight pair, returning false if the pair was already present. */
+bool RadixTrie::insert(const string word, double weight) {
+	if (word.empty()) {
+		return false;
+	}
+
+	vector<int> path (1, 0);
+	int n = 0;
+	size_t i = 0;
+	while (i < word.length()) {
+		int child = this->find_child(n, word[i]);
+
+		/* Nothing shares the next byte, so the rest of the word becomes one new edge. */
+		if (child < 0) {
+			int leaf = this->allocate_node(this->pool.size(), word.length() - i);
+			this->pool.append(word, i, string::npos);
+			this->link_child(n, leaf);
+			path.push_back(leaf);
+			n = leaf;
+			break;
+		}
+
+		string_view edge = this->label(child);
+		size_t common = 0;
+		while (common < edge.length() && i + common < word.length() && edge[common] == word[i + common]) {
+			++common;
+		}
+
+		/* The word leaves the edge part way along, so split it: a new node takes the shared part of the label, and the
+		 * existing child keeps the rest below it. */
+		if (common < edge.length()) {
+			int middle = this->allocate_node(this->nodes[child].label_offset, common);
+			this->unlink_child(n, child);
+			this->nodes[child].label_offset += common;
+			this->nodes[child].label_length -= common;
+			this->link_child(middle, child);
+			this->link_child(n, middle);
+			this->nodes[middle].max_weight = this->nodes[child].max_weight;
+			child = middle;
+		}
+
+		path.push_back(child);
+		n = child;
+		i += common;
+	}
+
+	if (this->nodes[n].end && this->nodes[n].weight == weight) {
+		return false;
+	}
+
+	if (!this->nodes[n].end) {
+		this->nodes[n].end = true;
+		++this->num_words;
+	}
+	this->nodes[n].weight = weight;
+
+	for (auto it = path.rbegin(); it != path.rend(); ++it) {
+		this->update_max_weight(*it);
+	}
+
+	return true;
+}
+
+/* Inserts words from a dictionary file in the format read by Trie::insert_from_file. */
+void RadixTrie::insert_from_file(const string filepath, bool has_weights /* = false */, const char *delims /* = " \n\t" */) {
+	ifstream dict (filepath);
+	Tokenizer tokenizer (delims);
+	string line;
+	string_view word, rest;
+	double weight = 0.0;
+
+	getline(dict, line); // Skip first line which contains number of words
+	while (getline(dict, line)) {
+		word = tokenizer.first_token(line, &rest);
+		if (word.empty()) {
+			continue;
+		}
+
+		if (has_weights) {
+			weight = atoi(string(tokenizer.first_token(rest)).c_str());
+		}
+
+		this->insert(string(word), weight);
+	}
+}
+
+bool RadixTrie::contains(const string word) const {
+	int n = this->find(word);
+	return n >= 0 && this->nodes[n].end;
+}
+
+/* Removes the word, returning whether it was present. A node left childless is deleted, and a node left with one child
+ * and no word of its own is merged with that child. */
+bool RadixTrie::remove(const string word) {
+	vector<int> path;
+	int n = this->find(word, &path);
+	if (n <= 0 || !this->nodes[n].end) {
+		return false;
+	}
+
+	this->nodes[n].end = false;
+	this->nodes[n].weight = -1;
+	--this->num_words;
+
+	if (this->nodes[n].first_child < 0) {
+		path.pop_back();
+		int parent = path.back();
+		this->unlink_child(parent, n);
+		this->free_node(n);
+		n = parent;
+	}
+
+	if (n != 0 && !this->nodes[n].end && this->nodes[n].first_child >= 0 && this->nodes[this->nodes[n].first_child].next_sibling < 0) {
+		this->merge_with_child(n);
+	}
+
+	for (auto it = path.rbegin(); it != path.rend(); ++it) {
+		this->update_max_weight(*it);
+	}
+
+	if (this->dead_bytes > 4096 && this->dead_bytes > this->pool.size() / 2) {
+		this->compact();
+	}
+
+	return true;
+}
+
+/* Returns the weight of the word, or -1 if it isn't present. */
+double RadixTrie::get_weight(const string word) const {
+	int n = this->find(word);
+	return n >= 0 && this->nodes[n].end ? this->nodes[n].weight : -1;
+}
+
+/* Given a weight update function, updates the weight of the given word, which must be present. */
+void RadixTrie::update_weight(const string word, double (*update_function)(double)) {
+	vector<int> path;
+	int n = this->find(word, &path);
+	if (n < 0 || !this->nodes[n].end) {
+		throw runtime_error("Word '" + word + "' not found");
+	}
+
+	this->nodes[n].weight = update_function(this->nodes[n].weight);
+	for (auto it = path.rbegin(); it != path.rend(); ++it) {
+		this->update_max_weight(*it);
+	}
+}
+
+/* Returns the top k words, ordered by descending weight, then alphabetically, which complete the given prefix, expanding
+ * subtrees best first by their maximum weight through best_first_completions. */
+vector<string> RadixTrie::autocomplete(const string prefix, int k) const {
+	/* Walk down to the node at or, if the prefix ends inside an edge, just below the end of the prefix. */
+	int n = 0;
+	size_t i = 0;
+	string start = prefix;
+	while (i < prefix.length()) {
+		n = this->find_child(n, prefix[i]);
+		if (n < 0) {
+			return vector<string>();
+		}
+
+		string_view edge = this->label(n);
+		size_t length = min(edge.length(), prefix.length() - i);
+		if (prefix.compare(i, length, edge, 0, length) != 0) {
+			return vector<string>();
+		}
+
+		start.append(edge.substr(length));
+		i += length;
+	}
+
+	return best_first_completions(start, n, this->nodes[n].max_weight, k, [&](size_t x) { return this->label(x); },
+		[&](size_t x, auto word, auto child) {
+			const RadixNode &node = this->nodes[x];
+			if (node.end) {
+				word(node.weight);
+			}
+			for (int c = node.first_child; c >= 0; c = this->nodes[c].next_sibling) {
+				child(c, this->nodes[c].max_weight);
+			}
+		});
+}
+
+/* Returns the words within the given Levenshtein distance of the given word, ordered by distance, then by descending
+ * weight, then alphabetically. */
+vector<string> RadixTrie::autocorrect(const string word, int max_distance) const {
+	int num_columns = word.length() + 1;
+	vector<int> rows (num_columns); // One row of the distance table per byte of the current path, plus the first
+	for (int j = 0; j < num_columns; ++j) {
+		rows[j] = j;
+	}
+
+	vector<tuple<string, double, int>> suggestions;
+	string current;
+	for (int child = this->nodes[0].first_child; child >= 0; child = this->nodes[child].next_sibling) {
+		this->autocorrect_helper(&suggestions, word, child, &current, &rows, 0, max_distance);
+	}
+
+	return Trie::rank_suggestions(word, suggestions);
+}
+
+/* Private helper function. Extends the Levenshtein distance table, whose last row is row depth of rows, by every byte of
+ * node n's label in turn, as Trie::autocorrect_helper does one node at a time, and gives up on the subtree as soon as a
+ * row has no entry within max_distance. current holds the path spelled so far. */
+void RadixTrie::autocorrect_helper(vector<tuple<string, double, int>> *v, string_view word, int n, string *current, vector<int> *rows,
+	int depth, int max_distance) const {
+	int num_columns = word.length() + 1;
+	string_view edge = this->label(n);
+	if (rows->size() < (depth + edge.length() + 1) * num_columns) {
+		rows->resize((depth + edge.length() + 1) * num_columns);
+	}
+
+	for (char letter : edge) {
+		const int *prev_row = rows->data() + depth * num_columns;
+		int *curr_row = rows->data() + (depth + 1) * num_columns;
+
+		curr_row[0] = prev_row[0] + 1;
+		int min_dist = curr_row[0];
+		for (int j = 1; j < num_columns; ++j) {
+			curr_row[j] = min(min(curr_row[j - 1], prev_row[j]) + 1, prev_row[j - 1] + (word[j - 1] == letter ? 0 : 1));
+			min_dist = min(min_dist, curr_row[j]);
+		}
+
+		++depth;
+		if (min_dist > max_distance) {
+			return;
+		}
+	}
+
+	size_t length = current->length();
+	current->append(edge);
+
+	int distance = (*rows)[depth * num_columns + num_columns - 1];
+	if (this->nodes[n].end && distance <= max_distance) {
+		v->push_back(make_tuple(*current, this->nodes[n].weight, distance));
+	}
+
+	for (int child = this->nodes[n].first_child; child >= 0; child = this->nodes[child].next_sibling) {
+		this->autocorrect_helper(v, word, child, current, rows, depth, max_distance);
+	}
+
+	current->resize(length);
+}
+
+/* End RadixTrie class. */
@@ -0,0 +1,101 @@
+#ifndef RADIX_TRIE_H
+#define RADIX_TRIE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Path-compressed (radix, or Patricia) variant of Trie. Chains of single-child nodes are collapsed into one edge, labelled
+ * with a span of a string pool shared by the whole trie, so a node exists only where words branch or end. Nodes live in
+ * one array and refer to each other by index: each keeps its first child and next sibling, siblings being ordered by the
+ * first byte of their labels. Every node also caches the maximum weight of the words below it, which autocomplete uses to
+ * visit completions in order of weight.
+ *
+ * insert splits an edge where a new word leaves it, and remove merges a node back into its only child once it neither
+ * ends a word nor branches. Splits reuse the pool bytes of the original label, merges reuse them when the two labels are
+ * adjacent in the pool, and the pool is compacted once more than half of it is no longer referenced. */
+class RadixTrie {
+	public:
+		struct Stats {
+			size_t nodes; // Including the root
+			size_t words;
+			size_t pool_bytes; // Bytes of the string pool in use, labels no longer referenced included
+			size_t memory_bytes; // Total heap footprint: nodes, string pool and free list
+		};
+
+	private:
+		struct RadixNode {
+			uint32_t label_offset, label_length; // Label of the edge into this node, as a span of the pool
+			int first_child, next_sibling; // -1 for none
+			bool end;
+			double weight;
+			double max_weight; // Maximum weight of the words at or below this node
+		};
+
+		vector<RadixNode> nodes; // nodes[0] is the root, whose label is empty
+		vector<int> free_nodes; // Indices of removed nodes, reused before the array grows
+		string pool;
+		size_t dead_bytes; // Bytes of the pool no longer referenced by any label
+		size_t num_words;
+
+		string_view label(int) const;
+
+		int allocate_node(uint32_t, uint32_t);
+
+		void free_node(int);
+
+		int find_child(int, unsigned char, int * = NULL) const;
+
+		void link_child(int, int);
+
+		void unlink_child(int, int);
+
+		void merge_with_child(int);
+
+		void update_max_weight(int);
+
+		int find(string_view, vector<int> * = NULL) const;
+
+		void compact(void);
+
+		void autocorrect_helper(vector<tuple<string, double, int>> *, string_view, int, string *, vector<int> *, int, int) const;
+
+	public:
+		// Constructors
+
+		RadixTrie(void);
+
+		// Getters
+
+		size_t size(void) const;
+
+		Stats stats(void) const;
+
+		// Functionality
+
+		bool insert(const string);
+
+		bool insert(const string, double);
+
+		void insert_from_file(const string, bool = false, const char * = " \n\t");
+
+		bool contains(const string) const;
+
+		bool remove(const string);
+
+		double get_weight(const string) const;
+
+		void update_weight(const string, double (*)(double));
+
+		vector<string> autocomplete(const string, int) const;
+
+		vector<string> autocorrect(const string, int) const;
+};
+
+#endif
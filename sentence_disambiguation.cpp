@@ -9,8 +9,16 @@
 #include <utility>
 #include <algorithm>
 #include <sstream>
+#include <cstdint>
+#include <array>
+#include <string_view>
+#include <stdexcept>
 #include "sentence_disambiguation.h"
 #include "neural_network.h"
+#include "thread_pool.h"
+#include "tokenizer.h"
+#include "trainer.h"
+#include "model_file.h"
 
 using namespace std;
 
@@ -18,88 +26,258 @@ using namespace std;
  * 1. David Palmer and Marti Hearst. 1994. Adaptive Sentence Boundary Disambiguation. University of California, Berkeley.
  */
 
-vector<int> brown_corpus_lookup(string pos) {
-	vector<int> ret;
+struct BrownCorpusTag {
+	string_view tag;
+	int pos;
+};
+
+/* Maps the full set of part-of-speech tags used in the Brown corpus to the smaller set of tags used here. */
+constexpr BrownCorpusTag brown_corpus[] = {
+	{"'", NPC},		// apostorphe
+	{".", SEP}, 	// sentence (. ; ? *)
+	{"(", LPAR}, 	// left paren
+	{")", RPAR}, 	// right paren
+	{"*", MOD}, 	// not, n't
+	{"--", CDSH}, 	// dash
+	{",", CS}, 		// comma
+	{":", CDSH}, 	// colon
+	{"abl", MOD}, 	// pre-qualifier (quite, rather)
+	{"abn", MOD}, 	// pre-quantifier (half, all)
+	{"ap$", DET}, 	// possessive post-determiner
+	{"abx", MOD}, 	// pre-quantifier (both)
+	{"ap", DET}, 	// post-determiner (many, several, next)
+	{"at", ART}, 	// article (a, the, no)
+	{"be", V}, 		// be
+	{"bed", V}, 	// were
+	{"bedz", V}, 	// was
+	{"beg", V}, 	// being
+	{"bem", V}, 	// am
+	{"ben", V}, 	// been
+	{"ber", V}, 	// are, art
+	{"bez", V}, 	// is
+	{"cc", CON}, 	// coordinating conjunction (and, or)
+	{"cd", NUM}, 	// cardinal numeral (one, two, 2, etc.)
+	{"cd$", NUM}, 	// possessive cardinal numeral
+	{"cs", CON}, 	// subordinating conjunction (if, although)
+	{"do", V}, 		// do
+	{"dod", V}, 	// did
+	{"doz", V}, 	// does
+	{"dt", DET}, 	// singular determiner/quantifier (this, that)
+	{"dt$", DET},	// possessive singular determiner/quantifer
+	{"dti", DET}, 	// singular or plural determiner/quantifier (some, any)
+	{"dts", DET}, 	// plural determiner (these, those)
+	{"dtx", CON}, 	// determiner/double conjunction (either)
+	{"ex", PN}, 	// existential there
+	{"fw", O}, 		// foreign word (hyphenated before regular tag)
+	{"hv", V}, 		// have
+	{"hvd", V}, 	// had
+	{"hvg", V}, 	// having
+	{"hvn", V}, 	// had (past participle)
+	{"hvz", V}, 	// has
+	{"in", PREP}, 	// preposition
+	{"jj", ADJ}, 	// adjective
+	{"jjr", ADJ}, 	// comparative adjective
+	{"jjs", ADJ}, 	// semantically superlative adjective
+	{"jj$", ADJ},	// possessive adjective
+	{"jjt", ADJ}, 	// morphologically superlative adjective
+	{"md", V}, 		// modal auxiliary (can, should, will)
+	{"nc", O}, 		// cited word (hyphenated after regular tag)
+	{"nn", N}, 		//  singular or mass noun
+	{"nn$", POSS}, 	// possessive singular noun
+	{"nns", N}, 	// plural noun
+	{"nns$", POSS}, // possessive plural noun
+	{"np", PROP}, 	// proper noun or part of name phrase
+	{"nps", PN},	// plural proper noun
+	{"nps$", PN}, 	// possessive plural proper noun
+	{"np$", PROP}, 	// possessive proper noun
+	{"nr", N}, 		// abbrevial noun (home, today, west)
+	{"nrs", N}, 	// plural abbrevial noun
+	{"nr$", N},	 	// plural abbrevial noun
+	{"od", NUM}, 	// ordinal numeral (first, 2nd)
+	{"pn", PN}, 	// nominal pronoun (everybody, nothing)
+	{"pn$", PN}, 	// possessive nominal pronoun
+	{"pp$", PN}, 	// possessive personal pronoun
+	{"pp$$", PN}, 	// second (nominal) possessive pronoun (mine, ours)
+	{"ppl", PN}, 	// singular reflexive/intensive personal pronoun (myself)
+	{"ppls", PN}, 	// plural reflexive/intensive personal pronoun (ourselves
+	{"ppo", PN}, 	// objective personal pronoun (me, him, it, them)
+	{"pps", PN}, 	// 3rd. singular nominative pronoun (he, she, it, one)
+	{"ppss", PN}, 	// other nominative personal pronoun (I, we, they, you)
+	{"prp", PN}, 	// personal pronoun
+	{"prp$", PN}, 	// possessive pronoun
+	{"ql", MOD}, 	// qualifier (very, fairly)
+	{"qlp", MOD}, 	// post-qualifier (enough, indeed)
+	{"rb", MOD}, 	// adverb
+	{"rbr", MOD}, 	// comparative adverb
+	{"rb$", MOD}, 	// possessive adverb
+	{"rbt", MOD}, 	// superlative adverb
+	{"rn", MOD}, 	// nominal adverb (here, then, indoors)
+	{"rp", MOD}, 	// adverb/particle (about, off, up)
+	{"to", CON}, 	// infinitive marker to
+	{"uh", O}, 		// interjection, exclamation
+	{"vb", V}, 		// verb, base form
+	{"vbd", V}, 	// verb, past tense
+	{"vbg", V}, 	// verb, present participle/gerund
+	{"vbn", V}, 	// verb, past participle
+	{"vbp", V}, 	// verb, non 3rd person, singular, present
+	{"vbz", V}, 	// verb, 3rd. singular present
+	{"wdt", DET}, 	// wh- determiner (what, which)
+	{"wp$", PN}, 	// possessive wh- pronoun (whose)
+	{"wpo", PN}, 	// objective wh- pronoun (whom, which, that)
+	{"wps", PN}, 	// nominative wh- pronoun (who, which, that)
+	{"wql", MOD}, 	// wh- qualifier (how)
+	{"wrb", MOD} 	// wh- adverb (how, where, when)
+};
+
+const int num_brown_corpus_tags = sizeof(brown_corpus) / sizeof(brown_corpus[0]);
+const int brown_corpus_table_size = 1024; // Slots in the perfect hash table; must be a power of two
+
+/* Seeded FNV-1a hash of a tag. */
+constexpr uint32_t brown_corpus_hash(string_view tag, uint32_t seed) {
+	uint32_t hash = 2166136261u ^ seed;
+	for (char c : tag) {
+		hash = (hash ^ (unsigned char) c) * 16777619u;
+	}
+
+	return hash ^ (hash >> 15);
+}
+
+/* Returns whether the given seed hashes every tag to a distinct slot. */
+constexpr bool is_perfect_seed(uint32_t seed) {
+	bool used[brown_corpus_table_size] = {};
+	for (const BrownCorpusTag &entry : brown_corpus) {
+		uint32_t slot = brown_corpus_hash(entry.tag, seed) & (brown_corpus_table_size - 1);
+		if (used[slot]) {
+			return false;
+		}
+		used[slot] = true;
+	}
+
+	return true;
+}
+
+constexpr uint32_t find_perfect_seed(void) {
+	uint32_t seed = 0;
+	while (!is_perfect_seed(seed)) {
+		++seed;
+	}
+
+	return seed;
+}
+
+constexpr uint32_t brown_corpus_seed = find_perfect_seed();
+
+/* Maps each slot to one plus the index of the tag hashing to it, or 0 if the slot is empty. Built at compile time. */
+constexpr array<uint8_t, brown_corpus_table_size> build_brown_corpus_table(void) {
+	array<uint8_t, brown_corpus_table_size> table = {};
+	for (int i = 0; i < num_brown_corpus_tags; ++i) {
+		table[brown_corpus_hash(brown_corpus[i].tag, brown_corpus_seed) & (brown_corpus_table_size - 1)] = i + 1;
+	}
+
+	return table;
+}
+
+constexpr array<uint8_t, brown_corpus_table_size> brown_corpus_table = build_brown_corpus_table();
+
+static_assert(num_brown_corpus_tags < 256, "Brown corpus table indices must fit in a byte");
+
+/* Returns the part-of-speech of a single (non-compound) Brown corpus tag, or -1 if the tag is unknown. */
+int brown_corpus_tag(string_view tag) {
+	int index = brown_corpus_table[brown_corpus_hash(tag, brown_corpus_seed) & (brown_corpus_table_size - 1)];
+	if (index == 0 || brown_corpus[index - 1].tag != tag) {
+		return -1;
+	}
+
+	return brown_corpus[index - 1].pos;
+}
 
+/* Writes the parts-of-speech denoted by the given (possibly compound) Brown corpus tag into ret, which must have room for
+ * max_brown_corpus_tags entries, and returns how many were written. Anything from the first hyphen on is ignored, each
+ * '+'-separated component contributes its own part-of-speech, and asterisks are stripped from components unless they are
+ * the whole component. Unknown components are skipped. */
+int brown_corpus_lookup(string_view pos, int *ret) {
 	// TODO This patches a weird POS tag in the Brown corpus: '' (2 apostorphes). Fix.
 	if (pos == "''") {
-		ret.push_back(NPC);
-		return ret;
+		ret[0] = NPC;
+		return 1;
 	}
 
-	if (brown_corpus.find(pos) != brown_corpus.end()) {
-		ret.push_back(brown_corpus.find(pos)->second);
-	} else {
-		/* Ignore hyphens */
-		if (pos.find('-') != string::npos) { // pos contains hyphens
-			pos = (string) strtok((char *) pos.c_str(), "-");
-		}
+	int tag = brown_corpus_tag(pos);
+	if (tag != -1) {
+		ret[0] = tag;
+		return 1;
+	}
 
-		if (pos.find('+') != string::npos) { // pos contains +
-			char *tag = strtok((char *) pos.c_str(), "+");
-			while (tag != NULL) {
-				ret.push_back(brown_corpus.find((string) tag)->second);
-				tag = strtok(NULL, "+");
-			}
+	/* Ignore hyphens, skipping any leading ones. */
+	size_t start = pos.find_first_not_of('-');
+	if (start == string_view::npos) {
+		return 0;
+	}
+	pos = pos.substr(start, pos.find('-', start) - start);
+
+	/* Single pass over the components. */
+	int count = 0;
+	for (size_t i = 0; i <= pos.length() && count < max_brown_corpus_tags; ) {
+		size_t end = pos.find('+', i);
+		if (end == string_view::npos) {
+			end = pos.length();
 		}
-		
-		/* Remove asterisk, unless its the only token in the string. */
-		if (pos.find('*') != string::npos && pos.length() > 1) {
-			pos = (string) strtok((char *) pos.c_str(), "*");
+
+		/* Remove asterisks, keeping the first run of other characters, unless the component is just an asterisk. */
+		string_view component = pos.substr(i, end - i);
+		if (component.length() > 1 && component.find('*') != string_view::npos) {
+			size_t first = component.find_first_not_of('*');
+			component = first == string_view::npos ? string_view() : component.substr(first, component.find('*', first) - first);
 		}
 
-		auto it = brown_corpus.find((string) strtok((char *) pos.c_str(), "-"));
-		if (it != brown_corpus.end()) {
-			ret.push_back(it->second);
-		} else {
-			// cerr << "Error: Tag '" << pos << "' not found" << endl;
+		if ((tag = brown_corpus_tag(component)) != -1) {
+			ret[count++] = tag;
 		}
+
+		i = end + 1;
 	}
 
-	return ret;
+	return count;
 }
 
-bool is_whitespace(const string s) {
-	bool whitespace_flag = true;
-
-	for (int i = 0; i < s.length(); ++i) {
-		if (!isspace(s[i])) {
-			whitespace_flag = false;
-		}
-	}
-
-	return whitespace_flag;
+/* Convenience version of the above. */
+vector<int> brown_corpus_lookup(string pos) {
+	int tags[max_brown_corpus_tags];
+	return vector<int>(tags, tags + brown_corpus_lookup(string_view(pos), tags));
 }
 
+bool is_whitespace(const string s) { return Tokenizer::is_whitespace(s); }
+
 vector<string> split_by_space(const string s) {
-	vector<string> ret;
+	static const Tokenizer space_tokenizer (" \t");
 
-	char *token = strtok((char *) s.c_str(), " \t");
-	do {
-		ret.push_back(token);
-	} while ((token = strtok(NULL, " \t")) != NULL);
+	vector<string_view> tokens;
+	space_tokenizer.split(s, &tokens);
 
-	return ret;
+	return vector<string>(tokens.begin(), tokens.end());
 }
 
+/* Splits a Brown corpus token into its word and part-of-speech. Trailing slashes are dropped, the part-of-speech is
+ * everything after the last remaining slash, and any slashes within the word are removed. Both are empty if the token is
+ * malformed: without a slash, or with nothing but slashes before it. */
 pair<string, string> parse_brown_corpus_token(const string token) {
-	if (count(token.begin(), token.end(), '/') > 1) {
-		/* If token contains multiple forward slashes, define the word to be the substring up to the last slash. */
-		string word;
-		char *prev = strtok((char *) token.c_str(), "/"), *curr = strtok(NULL, "/");
+	size_t end = token.find_last_not_of('/');
+	size_t slash = end == string::npos ? string::npos : token.rfind('/', end);
+	if (slash == string::npos) {
+		return pair<string, string>();
+	}
 
-		while (curr != NULL) {
-			word += prev;
-			prev = curr;
-			curr = strtok(NULL, "/");			
+	string word;
+	for (size_t i = 0; i < slash; ++i) {
+		if (token[i] != '/') {
+			word += token[i];
 		}
-
-		return make_pair(word, (string) prev);
-	} else { // count(token.begin(), token.end(), '/') == 1
-		string word = (string) strtok((char *) token.c_str(), "/");
-		string pos = (string) strtok(NULL, "/");
-		return make_pair(word, pos);
 	}
+	if (word.empty()) {
+		return pair<string, string>();
+	}
+
+	return make_pair(word, token.substr(slash + 1, end - slash));
 }
 
 /* Begin PartOfSpeechTagger class. */
@@ -121,82 +299,130 @@ bool PartOfSpeechTagger::is_dir(const string filepath) {
 	}
 }
 
-void PartOfSpeechTagger::update_pos_count(const string word, int pos) {
-	if (this->pos_counts.find(word) == this->pos_counts.end()) { // Word not found
-		int *descriptor_array = new int[POS_LEN];
-		for (int i = 0; i < POS_LEN; ++i) {
-			descriptor_array[i] = 0;
+/* FNV-1a hash of the given bytes. */
+size_t PartOfSpeechTagger::word_hash(const char *word, size_t len) {
+	size_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (unsigned char) word[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/* Returns the row of the count matrix belonging to the given word, or -1 if the word hasn't been seen. */
+int PartOfSpeechTagger::find_row(const char *word, size_t len) const {
+	if (this->slots.empty()) {
+		return -1;
+	}
+
+	size_t mask = this->slots.size() - 1;
+	for (size_t i = word_hash(word, len) & mask; ; i = (i + 1) & mask) {
+		int row = this->slots[i];
+		if (row == -1) {
+			return -1;
+		}
+
+		const string &candidate = this->words[row];
+		if (candidate.length() == len && memcmp(candidate.data(), word, len) == 0) {
+			return row;
+		}
+	}
+}
+
+/* Returns the row of the count matrix belonging to the given word, appending a zeroed row if the word hasn't been seen. */
+int PartOfSpeechTagger::find_or_insert_row(const char *word, size_t len) {
+	/* Keep the load factor at or below 1/2 so probe sequences stay short. */
+	if (2 * (this->words.size() + 1) > this->slots.size()) {
+		this->rehash(max((size_t) 1024, 2 * this->slots.size()));
+	}
+
+	size_t mask = this->slots.size() - 1;
+	size_t i = word_hash(word, len) & mask;
+	for (; this->slots[i] != -1; i = (i + 1) & mask) {
+		const string &candidate = this->words[this->slots[i]];
+		if (candidate.length() == len && memcmp(candidate.data(), word, len) == 0) {
+			return this->slots[i];
+		}
+	}
+
+	int row = this->words.size();
+	this->slots[i] = row;
+	this->words.push_back(string(word, len));
+	this->counts.resize(this->counts.size() + POS_LEN, 0);
+
+	return row;
+}
+
+/* Rebuilds the hash table with the given number of slots, which must be a power of two. */
+void PartOfSpeechTagger::rehash(size_t num_slots) {
+	this->slots.assign(num_slots, -1);
+
+	size_t mask = num_slots - 1;
+	for (int row = 0; row < (int) this->words.size(); ++row) {
+		size_t i = word_hash(this->words[row].data(), this->words[row].length()) & mask;
+		while (this->slots[i] != -1) {
+			i = (i + 1) & mask;
 		}
-		descriptor_array[pos] = 1;
 
-		this->pos_counts[word] = descriptor_array;
+		this->slots[i] = row;
 	}
+}
 
-	++this->pos_counts[word][pos];
+void PartOfSpeechTagger::update_pos_count(const string word, int pos) {
+	++this->counts[this->find_or_insert_row(word.data(), word.length()) * POS_LEN + pos];
 }
 
-void PartOfSpeechTagger::update_pos_count(const string word, vector<int> pos_list) {
-	for (int pos : pos_list) {
-		this->update_pos_count(word, pos);
+void PartOfSpeechTagger::update_pos_count(const string word, const int *pos_list, int num_pos) {
+	if (num_pos == 0) {
+		return;
+	}
+
+	int *row = &this->counts[this->find_or_insert_row(word.data(), word.length()) * POS_LEN];
+	for (int i = 0; i < num_pos; ++i) {
+		++row[pos_list[i]];
 	}
 }
 	
 /* Given a string, returns a list of tokens. A token is defined as a sequence of alphabetic characters, a sequence of digits
  * (including at most one decimal point), or a single non-alphanumeric character. */
 vector<string> PartOfSpeechTagger::tokenize(const string s) {
-	vector<string> ret;
-
-	bool decimal_point_flag = false;
-	int start, len;
-	for (int i = 0; i < s.length(); ) {
-		if (isalpha(s[i])) {
-			/* Get starting and ending indices of the longest continuous alphabetic string beginning at index i. */
-			start = i;
-			while (isalpha(s[++i]));
-			len = i - start;
-
-			ret.push_back(s.substr(start, len));
-		} else if (isdigit(s[i]) || s[i] == '-') {
-			/* Account for negative numbers by checking if s[i] is a hyphen or minus sign. */
-			if (s[i] == '-' && !isdigit(s[i + 1])) {
-				ret.push_back(s.substr(i++, 1));
-				continue;
-			}
+	vector<string_view> tokens;
+	Tokenizer::tokenize(s, &tokens);
 
-			/* Get starting and ending indices of the longest continuous numeric string beginning at index i, 
-			 * allowing at most one decimal point. */
-			start = i;
-			while (isdigit(s[++i]) || s[i] == '.') {
-				if (s[i] == '.') {
-					if (decimal_point_flag) {
-						break;
-					} else {
-						decimal_point_flag = true;
-					}
-				}
-			}
-			len = i - start;
+	return vector<string>(tokens.begin(), tokens.end());
+}
 
-			decimal_point_flag = false;
-			ret.push_back(s.substr(start, len));
+int PartOfSpeechTagger::num_words(void) const { return this->words.size(); }
 
-		} else {
-			ret.push_back(s.substr(i++, 1));
-		}
-	}
+const string & PartOfSpeechTagger::get_word(int row) const { return this->words[row]; }
 
-	return ret;
+/* Returns the raw part-of-speech counts of the given word, or NULL if the word hasn't been seen. The pointer is invalidated
+ * by any further training. */
+const int * PartOfSpeechTagger::get_pos_counts(string_view word) const {
+	int row = this->find_row(word.data(), word.length());
+	return row == -1 ? NULL : &this->counts[row * POS_LEN];
 }
 
 /* Returns an array mapping each part-of-speech in the POS enum to the proportion of times the given word takes on that part-of-speech,
  * out of all appearances of that word in the corpora seen by this tagger thus far. */
-vector<double> PartOfSpeechTagger::pos_frequencies(const string word) {
-	vector<double> ret;
-	if (this->pos_counts.find(word) == this->pos_counts.end()) { // word hasn't been seen
-		return ret;
+vector<double> PartOfSpeechTagger::pos_frequencies(const string word) const {
+	vector<double> ret (POS_LEN);
+	if (!this->pos_frequencies(word, ret.data())) { // word hasn't been seen
+		ret.clear();
+	}
+
+	return ret;
+}
+
+/* Allocation-free version of the above, writing POS_LEN frequencies into the given buffer. Returns false, leaving the buffer
+ * untouched, if the word hasn't been seen. */
+bool PartOfSpeechTagger::pos_frequencies(string_view word, double *ret) const {
+	const int *counts = this->get_pos_counts(word);
+	if (counts == NULL) {
+		return false;
 	}
 
-	int *counts = this->pos_counts[word];
 	double total = 0.0;
 	for (int i = 0; i < POS_LEN; ++i) {
 		total += counts[i];
@@ -204,24 +430,27 @@ vector<double> PartOfSpeechTagger::pos_frequencies(const string word) {
 
 	/* Normalize. */
 	for (int i = 0; i < POS_LEN; ++i) {
-		ret.push_back(counts[i] / total);
+		ret[i] = counts[i] / total;
 	}
 
-	return ret;
+	return true;
 }
 
 /* Scans the given directory (recursively scanning sub-directories) for text files belonging to the Brown corpus. */
 void PartOfSpeechTagger::read_brown_corpus(const string filepath) {
-	if (!is_dir(filepath)) {
-		ifstream file (filepath);
+	vector<string> files;
+	list_brown_corpus_files(filepath, &files);
+
+	for (const string &file : files) {
+		ifstream stream (file);
 		string line;
 
 		/* Iterate over every line in the file, updating counts along the way. */
-		vector<int> parts_of_speech;
+		int parts_of_speech[max_brown_corpus_tags], num_parts_of_speech;
 		vector<string> tokens;
 		pair<string, string> p;
 		string word, pos;
-		while (getline(file, line)) {
+		while (getline(stream, line)) {
 			/* If the string contains only whitespace, skip it. */
 			if (is_whitespace(line)) {
 				continue;
@@ -235,6 +464,9 @@ void PartOfSpeechTagger::read_brown_corpus(const string filepath) {
 				/* Decompose the token into a word and its corresponding part-of-speech, as per the Brown corpus' syntax. */
 				p = parse_brown_corpus_token(token);
 				word = get<0>(p), pos = get<1>(p);
+				if (word.empty()) { // Malformed token
+					continue;
+				}
 
 				// TODO pos contains a grave accent (ascii 96). Weird. Ignore for now.
 				if (pos.find('`') != string::npos) {
@@ -242,14 +474,150 @@ void PartOfSpeechTagger::read_brown_corpus(const string filepath) {
 				}
 
 				/* Get all parts of speech that apply to the word. */
-				parts_of_speech = brown_corpus_lookup(pos);
+				num_parts_of_speech = brown_corpus_lookup(pos, parts_of_speech);
 
 				/*  Update counts accordingly. */
-				this->update_pos_count(word, parts_of_speech);
+				this->update_pos_count(word, parts_of_speech, num_parts_of_speech);
+			}
+		}
+
+		stream.close();
+	}
+}
+
+/* Parallel version of the above, which parses the corpus on the given number of threads and returns the number of
+ * well-formed tokens read. Files are split into contiguous chunks, each counted into its own table and merged in order at
+ * the end, so the vocabulary and counts come out exactly as the serial reader would produce them; both skip the tokens
+ * parse_brown_corpus_token finds malformed. */
+long PartOfSpeechTagger::read_brown_corpus(const string filepath, int num_threads) {
+	if (num_threads < 1) {
+		throw runtime_error("Reading the Brown corpus needs at least one thread");
+	}
+
+	vector<string> files;
+	list_brown_corpus_files(filepath, &files);
+
+	/* Use a few chunks per thread so that uneven file sizes still balance out. */
+	int num_chunks = min((int) files.size(), 4 * num_threads);
+	vector<PartOfSpeechTagger> chunk_counts (num_chunks);
+	vector<long> chunk_tokens (num_chunks, 0);
+	vector<vector<char>> buffers (num_threads); // Per-thread file buffers, reused across files
+
+	ThreadPool pool (num_threads);
+	pool.parallel_for(num_chunks, [&](int chunk, int worker) {
+		size_t first = files.size() * chunk / num_chunks, last = files.size() * (chunk + 1) / num_chunks;
+		vector<char> &buffer = buffers[worker];
+
+		for (size_t i = first; i < last; ++i) {
+			/* Read the whole file with a single block read. */
+			ifstream file (files[i], ios::binary | ios::ate);
+			if (!file) {
+				throw runtime_error("File error when trying to read '" + files[i] + "'\n");
+			}
+
+			size_t size = file.tellg();
+			buffer.resize(size);
+			file.seekg(0);
+			file.read(buffer.data(), size);
+
+			chunk_tokens[chunk] += chunk_counts[chunk].read_brown_corpus_buffer(buffer.data(), size);
+		}
+	});
+
+	long num_tokens = 0;
+	for (int chunk = 0; chunk < num_chunks; ++chunk) {
+		this->merge_counts(chunk_counts[chunk]);
+		num_tokens += chunk_tokens[chunk];
+	}
+
+	return num_tokens;
+}
+
+/* Updates counts with the contents of one Brown corpus file, scanning tokens in place rather than copying them out line by
+ * line. Follows the same token rules as read_brown_corpus and parse_brown_corpus_token. Returns the number of well-formed
+ * tokens read. */
+long PartOfSpeechTagger::read_brown_corpus_buffer(const char *buffer, size_t size) {
+	static const Tokenizer corpus_tokenizer (" \t\n");
+
+	vector<string_view> tokens;
+	corpus_tokenizer.split(string_view(buffer, size), &tokens);
+
+	string scratch; // Only used for words that themselves contain slashes
+	long num_tokens = 0;
+
+	for (string_view token : tokens) {
+		const char *start = token.data();
+
+		/* Trailing slashes are dropped, and the part-of-speech is everything after the last remaining slash. */
+		const char *token_end = start + token.length();
+		while (token_end > start && token_end[-1] == '/') {
+			--token_end;
+		}
+
+		const char *slash = token_end;
+		while (slash > start && slash[-1] != '/') {
+			--slash;
+		}
+
+		if (slash == start) { // Empty, or no slash at all
+			continue;
+		}
+
+		const char *pos = slash, *word = start;
+		size_t pos_len = token_end - slash, word_len = slash - 1 - start;
+		if ((size_t) count(word, word + word_len, '/') == word_len) { // Nothing but slashes before the part-of-speech
+			continue;
+		}
+		++num_tokens;
+
+		/* Parts-of-speech containing a grave accent are skipped, as the serial reader skips them. */
+		if (memchr(pos, '`', pos_len) != NULL) {
+			continue;
+		}
+
+		/* If the word itself contains slashes, they are removed. */
+		if (memchr(word, '/', word_len) != NULL) {
+			scratch.clear();
+			for (size_t i = 0; i < word_len; ++i) {
+				if (word[i] != '/') {
+					scratch += word[i];
+				}
 			}
+			word = scratch.data(), word_len = scratch.length();
+		}
+
+		int parts_of_speech[max_brown_corpus_tags];
+		int num_parts_of_speech = brown_corpus_lookup(string_view(pos, pos_len), parts_of_speech);
+		if (num_parts_of_speech == 0) {
+			continue;
+		}
+
+		int *row = &this->counts[this->find_or_insert_row(word, word_len) * POS_LEN];
+		for (int i = 0; i < num_parts_of_speech; ++i) {
+			++row[parts_of_speech[i]];
 		}
+	}
 
-		file.close();
+	return num_tokens;
+}
+
+/* Adds the counts of the given tagger into this one, appending words this tagger hasn't seen in the other's order. */
+void PartOfSpeechTagger::merge_counts(const PartOfSpeechTagger &other) {
+	for (int other_row = 0; other_row < (int) other.words.size(); ++other_row) {
+		const string &word = other.words[other_row];
+		int *row = &this->counts[this->find_or_insert_row(word.data(), word.length()) * POS_LEN];
+		const int *other_counts = &other.counts[other_row * POS_LEN];
+
+		for (int i = 0; i < POS_LEN; ++i) {
+			row[i] += other_counts[i];
+		}
+	}
+}
+
+/* Appends the paths of all files in the Brown corpus rooted at the given path, recursively scanning sub-directories. */
+void PartOfSpeechTagger::list_brown_corpus_files(const string filepath, vector<string> *files) {
+	if (!is_dir(filepath)) {
+		files->push_back(filepath);
 	} else { // File is directory, so recursively search each sub-file
 		DIR *root = opendir(filepath.c_str());
 		struct dirent *file;
@@ -259,35 +627,392 @@ void PartOfSpeechTagger::read_brown_corpus(const string filepath) {
 				continue;
 			}
 
-			this->read_brown_corpus(filepath + "/" + file->d_name);
+			list_brown_corpus_files(filepath + "/" + file->d_name, files);
 		}
 
 		closedir(root);
 	}
 }
 
-PartOfSpeechTagger::~PartOfSpeechTagger(void) {
-	for (auto const &it : this->pos_counts) {
-		delete[] it.second;
+/* Writes the vocabulary and count matrix to a model file. The payload holds POS_LEN, the number of words, the offset of
+ * each word (plus one past the last) into the words' concatenated characters, those characters, and then, aligned, the
+ * count matrix. */
+void PartOfSpeechTagger::save(const string filepath) const {
+	vector<uint32_t> offsets (1, 0);
+	for (const string &word : this->words) {
+		offsets.push_back(offsets.back() + word.length());
+	}
+
+	ModelWriter writer (PART_OF_SPEECH_MODEL);
+	writer.write((uint32_t) POS_LEN);
+	writer.write((uint32_t) this->words.size());
+	writer.write_array(offsets.data(), offsets.size());
+	for (const string &word : this->words) {
+		writer.write_array(word.data(), word.length());
+	}
+	writer.align(sizeof(int));
+	writer.write_array(this->counts.data(), this->counts.size());
+	writer.save(filepath);
+}
+
+/* Replaces this tagger's counts with those stored in the given model file, as written by save. The tagger is left
+ * unchanged if the file can't be loaded. */
+void PartOfSpeechTagger::load(const string filepath) {
+	ModelReader reader (filepath, PART_OF_SPEECH_MODEL);
+	if (reader.read<uint32_t>() != POS_LEN) {
+		throw runtime_error("Model '" + filepath + "' was saved with a different set of parts of speech\n");
+	}
+
+	uint32_t num_words = reader.read<uint32_t>();
+	if (num_words >= reader.remaining() / sizeof(uint32_t)) {
+		throw runtime_error("Model '" + filepath + "' ends unexpectedly\n");
 	}
+
+	vector<uint32_t> offsets (num_words + 1);
+	reader.read_array(offsets.data(), offsets.size());
+	for (uint32_t i = 0; i < num_words; ++i) {
+		if (offsets[i] > offsets[i + 1]) {
+			throw runtime_error("Model '" + filepath + "' has a malformed vocabulary\n");
+		}
+	}
+
+	const char *characters = reader.read_bytes(offsets.back());
+	vector<string> words (num_words);
+	for (uint32_t i = 0; i < num_words; ++i) {
+		words[i].assign(characters + offsets[i], offsets[i + 1] - offsets[i]);
+	}
+
+	reader.align(sizeof(int));
+	if (reader.remaining() != (size_t) num_words * POS_LEN * sizeof(int)) {
+		throw runtime_error("Model '" + filepath + "' doesn't match its vocabulary\n");
+	}
+
+	vector<int> counts ((size_t) num_words * POS_LEN);
+	reader.read_array(counts.data(), counts.size());
+
+	this->words.swap(words);
+	this->counts.swap(counts);
+
+	size_t num_slots = 1024;
+	while (num_slots < 2 * this->words.size()) {
+		num_slots *= 2;
+	}
+	this->rehash(num_slots);
 }
 
 /* End PartOfSpeechTagger class. */
 
 /* Begin Sentence class. */
 
-vector<string> Sentence::get_sentences(const string paragraph, NeuralNetwork net) {
+/* Returns the token ending at or before the given position, skipping whitespace, or an empty view if there is none. Tokens
+ * follow the same rules as Tokenizer::tokenize. */
+static string_view previous_token(const char *begin, const char *end) {
+	while (end > begin && isspace((unsigned char) end[-1])) {
+		--end;
+	}
+
+	if (end == begin) {
+		return string_view();
+	}
+
+	const char *start = end - 1;
+	if (isalpha((unsigned char) *start)) {
+		while (start > begin && isalpha((unsigned char) start[-1])) {
+			--start;
+		}
+	} else if (isdigit((unsigned char) *start)) {
+		while (start > begin && (isdigit((unsigned char) start[-1]) || start[-1] == '.')) {
+			--start;
+		}
+	}
+
+	return string_view(start, end - start);
+}
+
+/* Returns the token starting at or after the given position, skipping whitespace, or an empty view if there is none. */
+static string_view next_token(const char *begin, const char *end) {
+	begin = Tokenizer::skip_whitespace(begin, end);
+	if (begin == end) {
+		return string_view();
+	}
+
+	const char *p = begin + 1;
+	if (isalpha((unsigned char) *begin)) {
+		p = Tokenizer::skip_alpha(p, end);
+	} else if (isdigit((unsigned char) *begin)) {
+		p = Tokenizer::skip_digits(p, end);
+	}
+
+	return string_view(begin, p - begin);
+}
+
+/* Writes the descriptor array of the given token, ie the frequencies of each part-of-speech, into ret. Words the tagger
+ * hasn't seen are also looked up in lower case (for sentence-initial capitals), and otherwise get a descriptor guessed from
+ * their shape. An empty token (before the start or past the end of the text) gets an all-zero descriptor. */
+void Sentence::describe(const PartOfSpeechTagger &tagger, string_view token, double *ret) {
+	if (!token.empty() && tagger.pos_frequencies(token, ret)) {
+		return;
+	}
+
+	char lower[64];
+	if (!token.empty() && isupper((unsigned char) token[0]) && token.length() <= sizeof(lower)) {
+		for (size_t i = 0; i < token.length(); ++i) {
+			lower[i] = tolower((unsigned char) token[i]);
+		}
+
+		if (tagger.pos_frequencies(string_view(lower, token.length()), ret)) {
+			return;
+		}
+	}
+
+	fill(ret, ret + descriptor_length, 0.0);
+	if (token.empty()) {
+		return;
+	}
+
+	if (isdigit((unsigned char) token[0])) {
+		ret[NUM] = 1;
+	} else if (isupper((unsigned char) token[0])) {
+		ret[PROP] = 1;
+	} else if (isalpha((unsigned char) token[0])) { // Unknown lower case word, so spread over the open word classes
+		ret[N] = ret[V] = ret[ADJ] = 1.0 / 3;
+	} else {
+		ret[O] = 1;
+	}
+}
 
+/* Fallback rule for punctuation the neural net can't decide on (or when there is no net): the punctuation ends a sentence
+ * if the text ends or the next token starts with a capital letter or opening punctuation. */
+bool Sentence::looks_like_boundary(string_view next) {
+	return next.empty() || isupper((unsigned char) next[0]) || next[0] == '"' || next[0] == '(' || next[0] == '\'';
 }
 
-// NeuralNetwork Sentence::train_net(TRAINING DATA) {
-// 	int length = 3;
-// 	int *layer_counts = new int[length];
-// 	layer_counts[0] = k * descriptor_length; // Size of input layer
-// 	layer_counts[1] = 10; // Size of hidden layer
-// 	layer_counts[2] = 1; // Size of output layer
+/* Splits text into sentences, appending a view of each (trimmed of surrounding whitespace) to ret without copying the text.
+ * 
+ * The text is scanned for runs of sentence-ending punctuation ('.', '?', '!'). For each candidate, the descriptor arrays of
+ * the k tokens centered on it are concatenated into one input row, and candidates are scored by the neural net in batches
+ * of batch_size. Outputs above upper_threshold are boundaries, those below lower_threshold are not, and the rest are
+ * decided by looks_like_boundary. A frozen net, if given instead, scores candidates one at a time against the same
+ * thresholds. Without either, every candidate is decided by looks_like_boundary.
+ *
+ * To stream through a large corpus, pass consecutive blocks of it with final set to false: only sentences whose boundary
+ * has been decided are returned, along with the number of bytes they span, and the caller prepends the remaining bytes to
+ * the next block. With final set to true, the rest of the text is returned as the last sentence. */
+size_t Sentence::get_sentences(string_view text, bool final, const PartOfSpeechTagger *tagger, NeuralNetwork *net, InferenceNetwork *frozen, vector<string_view> *ret) {
+	static const Tokenizer candidate_finder (".?!");
+	static const Tokenizer closing_punctuation ("\"')]");
+	const int left_context = (k - 1) / 2, right_context = k / 2;
+
+	const char *begin = text.data(), *end = begin + text.size();
+	const char *sentence_start = begin, *p = begin;
+
+	/* Appends the sentence spanning [start, stop), unless it's only whitespace. */
+	auto emit = [&](const char *start, const char *stop) {
+		start = Tokenizer::skip_whitespace(start, stop);
+		while (stop > start && isspace((unsigned char) stop[-1])) {
+			--stop;
+		}
+
+		if (start < stop) {
+			ret->push_back(string_view(start, stop - start));
+		}
+	};
+
+	vector<const char *> candidates; // End of each candidate punctuation run in the current batch
+	vector<string_view> next_tokens; // First token following each candidate
+	vector<double> descriptors, outputs;
+	bool need_more_text = false;
+
+	while (p < end && !need_more_text) {
+		/* Find the next batch of candidates. */
+		candidates.clear();
+		next_tokens.clear();
+		descriptors.clear();
+
+		while ((int) candidates.size() < batch_size && (p = candidate_finder.find_delimiter(p, end)) < end) {
+			const char *punctuation = p;
+			p = candidate_finder.skip_delimiters(p, end);
+
+			/* A decimal point is part of its number, not a candidate. */
+			if (p - punctuation == 1 && *punctuation == '.' && punctuation > begin && p < end && isdigit((unsigned char) punctuation[-1]) && isdigit((unsigned char) *p)) {
+				continue;
+			}
 
-// 	NeuralNetwork ret (layer_counts, length);
-// }
+			/* Gather the tokens to the right; if they might be cut off by the end of this block, wait for the next one. */
+			string_view right[k];
+			const char *q = p;
+			for (int i = 0; i < right_context; ++i) {
+				right[i] = next_token(q, end);
+				q = right[i].empty() ? end : right[i].data() + right[i].length();
+			}
+
+			if (!final && q == end) {
+				need_more_text = true;
+				p = punctuation;
+				break;
+			}
+
+			candidates.push_back(p);
+			next_tokens.push_back(right_context > 0 ? right[0] : next_token(p, end));
+
+			if (net != NULL || frozen != NULL) {
+				/* Build this candidate's row of descriptors: left context, the punctuation itself, then right context. */
+				size_t row = descriptors.size();
+				descriptors.resize(row + input_size);
+
+				const char *left_end = punctuation;
+				for (int i = left_context - 1; i >= 0; --i) {
+					string_view token = previous_token(begin, left_end);
+					describe(*tagger, token, &descriptors[row + i * descriptor_length]);
+					left_end = token.empty() ? left_end : token.data();
+				}
+
+				describe(*tagger, string_view(punctuation, 1), &descriptors[row + left_context * descriptor_length]);
+
+				for (int i = 0; i < right_context; ++i) {
+					describe(*tagger, right[i], &descriptors[row + (left_context + 1 + i) * descriptor_length]);
+				}
+			}
+		}
+
+		/* Score the whole batch in one forward pass, and emit sentences for every candidate judged to be a boundary. */
+		if (net != NULL && !candidates.empty()) {
+			outputs.resize(candidates.size() * net->output_size());
+			net->feedforward_batch(descriptors.data(), candidates.size(), outputs.data());
+		}
+
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			bool boundary;
+			if (net != NULL) {
+				double output = outputs[i * net->output_size()];
+				boundary = output > upper_threshold || (output >= lower_threshold && looks_like_boundary(next_tokens[i]));
+			} else if (frozen != NULL) {
+				int decision = frozen->classify(&descriptors[i * input_size]);
+				boundary = decision > 0 || (decision == 0 && looks_like_boundary(next_tokens[i]));
+			} else {
+				boundary = looks_like_boundary(next_tokens[i]);
+			}
+
+			if (boundary) {
+				const char *sentence_end = closing_punctuation.skip_delimiters(candidates[i], end);
+				emit(sentence_start, sentence_end);
+				sentence_start = sentence_end;
+			}
+		}
+
+		if (candidates.empty()) {
+			break;
+		}
+	}
+
+	if (final) {
+		emit(sentence_start, end);
+		return text.size();
+	}
+
+	return sentence_start - begin;
+}
+
+/* Splits text into sentences using the given part-of-speech tagger and trained neural net; see above. Returns the number of
+ * bytes of text covered by the returned sentences. */
+size_t Sentence::get_sentences(string_view text, bool final, const PartOfSpeechTagger &tagger, NeuralNetwork &net, vector<string_view> *ret) {
+	return get_sentences(text, final, &tagger, &net, NULL, ret);
+}
+
+/* Splits text into sentences using the given part-of-speech tagger and a net frozen by freeze_net. */
+size_t Sentence::get_sentences(string_view text, bool final, const PartOfSpeechTagger &tagger, InferenceNetwork &net, vector<string_view> *ret) {
+	return get_sentences(text, final, &tagger, NULL, &net, ret);
+}
+
+/* Splits text into sentences by punctuation and capitalization alone, for when no trained net is available. */
+size_t Sentence::get_sentences(string_view text, bool final, vector<string_view> *ret) {
+	return get_sentences(text, final, NULL, NULL, NULL, ret);
+}
+
+/* Appends labelled training samples for the sentence boundary net, built from the Brown corpus at the given path. The Brown
+ * corpus has one sentence per line, so every sentence-ending punctuation token is a candidate labelled 1 if it ends its line
+ * and 0 otherwise; words ending in a period (abbreviations such as "Mr.") are candidates too, split as get_sentences would
+ * see them. Descriptors are built exactly as in get_sentences. */
+void Sentence::training_samples(const string corpus_path, const PartOfSpeechTagger &tagger, vector<pair<ARRAY, ARRAY>> *samples) {
+	vector<string> files;
+	PartOfSpeechTagger::list_brown_corpus_files(corpus_path, &files);
+
+	const int left_context = (k - 1) / 2, right_context = k / 2;
+	for (const string &file : files) {
+		/* Flatten the file into words, remembering which end a line. */
+		ifstream stream (file);
+		string line;
+		vector<string> words;
+		vector<bool> ends_sentence;
+		while (getline(stream, line)) {
+			if (is_whitespace(line)) {
+				continue;
+			}
+
+			for (const string &token : split_by_space(line)) {
+				string word = parse_brown_corpus_token(token).first;
+				if (!word.empty()) {
+					words.push_back(word);
+					ends_sentence.push_back(false);
+				}
+			}
+
+			if (!ends_sentence.empty()) {
+				ends_sentence.back() = true;
+			}
+		}
+
+		for (int i = 0; i < (int) words.size(); ++i) {
+			const string &word = words[i];
+
+			/* Split the candidate into the token before the punctuation (if any) and the punctuation itself. */
+			string_view before, punctuation;
+			if (word.find_first_not_of(".?!") == string::npos) {
+				before = i > 0 ? string_view(words[i - 1]) : string_view();
+				punctuation = word;
+			} else if (word.length() > 1 && word.back() == '.') {
+				before = string_view(word).substr(0, word.length() - 1);
+				punctuation = string_view(word).substr(word.length() - 1);
+			} else {
+				continue;
+			}
+
+			ARRAY input (input_size, 0.0);
+			if (left_context > 0) {
+				describe(tagger, before, &input[(left_context - 1) * descriptor_length]);
+			}
+			for (int j = left_context - 2, w = i - 1 - (punctuation.data() == word.data()); j >= 0; --j, --w) {
+				describe(tagger, w >= 0 ? string_view(words[w]) : string_view(), &input[j * descriptor_length]);
+			}
+
+			describe(tagger, punctuation.substr(0, 1), &input[left_context * descriptor_length]);
+
+			for (int j = 0; j < right_context; ++j) {
+				int w = i + 1 + j;
+				describe(tagger, w < (int) words.size() ? string_view(words[w]) : string_view(), &input[(left_context + 1 + j) * descriptor_length]);
+			}
+
+			samples->push_back(make_pair(input, ARRAY(1, ends_sentence[i] ? 1.0 : 0.0)));
+		}
+	}
+}
+
+/* Trains a sentence boundary net (one hidden layer of 10 units, as in Palmer and Hearst) on the given samples for the given
+ * number of epochs, with minibatches spread over the given number of threads. */
+NeuralNetwork Sentence::train_net(const vector<pair<ARRAY, ARRAY>> &samples, int epochs, int num_threads /* = 1 */) {
+	int layer_counts[] = {input_size, 10, 1};
+	NeuralNetwork ret (layer_counts, 3);
+
+	Adam optimizer (0.01);
+	Trainer trainer (ret, optimizer, 32, num_threads);
+	trainer.train(samples, epochs);
+
+	return ret;
+}
+
+/* Freezes a net trained by train_net for serving, with classification fused against the sentence boundary thresholds. */
+InferenceNetwork Sentence::freeze_net(const NeuralNetwork &net, InferenceNetwork::Precision precision /* = FLOAT32 */) {
+	return InferenceNetwork(net, precision, lower_threshold, upper_threshold);
+}
 
 /* End Sentence class. */
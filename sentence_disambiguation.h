@@ -2,10 +2,13 @@
 #define SENTENCE_DISAMBIGUATION_H
 
 #include <vector>
+#include <string>
+#include <string_view>
 #include <map>
 #include <utility>
 
 #include "neural_network.h"
+#include "inference_network.h"
 
 using namespace std;
 
@@ -34,106 +37,14 @@ enum POS {
 	POS_LEN
 };
 
-/* Maps the full set of part-of-speech tags used in the Brown corpus to the smaller set of tags used here. */
-const map<string, int> brown_corpus = {
-	{"'", NPC},		// apostorphe
-	{".", SEP}, 	// sentence (. ; ? *)
-	{"(", LPAR}, 	// left paren
-	{")", RPAR}, 	// right paren
-	{"*", MOD}, 	// not, n't
-	{"--", CDSH}, 	// dash
-	{",", CS}, 		// comma
-	{":", CDSH}, 	// colon
-	{"abl", MOD}, 	// pre-qualifier (quite, rather)
-	{"abn", MOD}, 	// pre-quantifier (half, all)
-	{"ap$", DET}, 	// possessive post-determiner
-	{"abx", MOD}, 	// pre-quantifier (both)
-	{"ap", DET}, 	// post-determiner (many, several, next)
-	{"at", ART}, 	// article (a, the, no)
-	{"be", V}, 		// be
-	{"bed", V}, 	// were
-	{"bedz", V}, 	// was
-	{"beg", V}, 	// being
-	{"bem", V}, 	// am
-	{"ben", V}, 	// been
-	{"ber", V}, 	// are, art
-	{"bez", V}, 	// is
-	{"cc", CON}, 	// coordinating conjunction (and, or)
-	{"cd", NUM}, 	// cardinal numeral (one, two, 2, etc.)
-	{"cd$", NUM}, 	// possessive cardinal numeral
-	{"cs", CON}, 	// subordinating conjunction (if, although)
-	{"do", V}, 		// do
-	{"dod", V}, 	// did
-	{"doz", V}, 	// does
-	{"dt", DET}, 	// singular determiner/quantifier (this, that)
-	{"dt$", DET},	// possessive singular determiner/quantifer
-	{"dti", DET}, 	// singular or plural determiner/quantifier (some, any)
-	{"dts", DET}, 	// plural determiner (these, those)
-	{"dtx", CON}, 	// determiner/double conjunction (either)
-	{"ex", PN}, 	// existential there
-	{"fw", O}, 		// foreign word (hyphenated before regular tag)
-	{"hv", V}, 		// have
-	{"hvd", V}, 	// had
-	{"hvg", V}, 	// having
-	{"hvn", V}, 	// had (past participle)
-	{"hvz", V}, 	// has
-	{"in", PREP}, 	// preposition
-	{"jj", ADJ}, 	// adjective
-	{"jjr", ADJ}, 	// comparative adjective
-	{"jjs", ADJ}, 	// semantically superlative adjective
-	{"jj$", ADJ},	// possessive adjective
-	{"jjt", ADJ}, 	// morphologically superlative adjective
-	{"md", V}, 		// modal auxiliary (can, should, will)
-	{"nc", O}, 		// cited word (hyphenated after regular tag)
-	{"nn", N}, 		//  singular or mass noun
-	{"nn$", POSS}, 	// possessive singular noun
-	{"nns", N}, 	// plural noun
-	{"nns$", POSS}, // possessive plural noun
-	{"np", PROP}, 	// proper noun or part of name phrase
-	{"nps", PN},	// plural proper noun
-	{"nps$", PN}, 	// possessive plural proper noun
-	{"np$", PROP}, 	// possessive proper noun
-	{"nr", N}, 		// abbrevial noun (home, today, west)
-	{"nrs", N}, 	// plural abbrevial noun
-	{"nr$", N},	 	// plural abbrevial noun
-	{"od", NUM}, 	// ordinal numeral (first, 2nd)
-	{"pn", PN}, 	// nominal pronoun (everybody, nothing)
-	{"pn$", PN}, 	// possessive nominal pronoun
-	{"pp$", PN}, 	// possessive personal pronoun
-	{"pp$$", PN}, 	// second (nominal) possessive pronoun (mine, ours)
-	{"ppl", PN}, 	// singular reflexive/intensive personal pronoun (myself)
-	{"ppls", PN}, 	// plural reflexive/intensive personal pronoun (ourselves
-	{"ppo", PN}, 	// objective personal pronoun (me, him, it, them)
-	{"pps", PN}, 	// 3rd. singular nominative pronoun (he, she, it, one)
-	{"ppss", PN}, 	// other nominative personal pronoun (I, we, they, you)
-	{"prp", PN}, 	// personal pronoun
-	{"prp$", PN}, 	// possessive pronoun
-	{"ql", MOD}, 	// qualifier (very, fairly)
-	{"qlp", MOD}, 	// post-qualifier (enough, indeed)
-	{"rb", MOD}, 	// adverb
-	{"rbr", MOD}, 	// comparative adverb
-	{"rb$", MOD}, 	// possessive adverb
-	{"rbt", MOD}, 	// superlative adverb
-	{"rn", MOD}, 	// nominal adverb (here, then, indoors)
-	{"rp", MOD}, 	// adverb/particle (about, off, up)
-	{"to", CON}, 	// infinitive marker to
-	{"uh", O}, 		// interjection, exclamation
-	{"vb", V}, 		// verb, base form
-	{"vbd", V}, 	// verb, past tense
-	{"vbg", V}, 	// verb, present participle/gerund
-	{"vbn", V}, 	// verb, past participle
-	{"vbp", V}, 	// verb, non 3rd person, singular, present
-	{"vbz", V}, 	// verb, 3rd. singular present
-	{"wdt", DET}, 	// wh- determiner (what, which)
-	{"wp$", PN}, 	// possessive wh- pronoun (whose)
-	{"wpo", PN}, 	// objective wh- pronoun (whom, which, that)
-	{"wps", PN}, 	// nominative wh- pronoun (who, which, that)
-	{"wql", MOD}, 	// wh- qualifier (how)
-	{"wrb", MOD} 	// wh- adverb (how, where, when)
-};
-
 /* Utility functions. */
 
+const int max_brown_corpus_tags = 4; // Most parts-of-speech a single (compound) Brown corpus tag can map to
+
+int brown_corpus_tag(string_view);
+
+int brown_corpus_lookup(string_view, int *);
+
 vector<int> brown_corpus_lookup(string);
 
 bool is_whitespace(const string);
@@ -144,10 +55,21 @@ pair<string, string> parse_brown_corpus_token(const string);
 
 class PartOfSpeechTagger {
 	private:
+		vector<string> words; // Vocabulary seen so far; a word's index in this list is its row in counts
+		vector<int> counts; // Row-major (words.size() x POS_LEN) matrix of part-of-speech counts
+		vector<int> slots; // Open-addressing hash table mapping words to rows, with -1 marking an empty slot
+
+		static size_t word_hash(const char *, size_t);
+
+		int find_row(const char *, size_t) const;
+
+		int find_or_insert_row(const char *, size_t);
+
+		void rehash(size_t);
 
 		void update_pos_count(const string, int);
 
-		void update_pos_count(const string, vector<int>);
+		void update_pos_count(const string, const int *, int);
 
 		static bool is_alphanumeric(char);
 
@@ -155,24 +77,42 @@ class PartOfSpeechTagger {
 
 		static bool is_dir(const string);
 
+		long read_brown_corpus_buffer(const char *, size_t);
+
+		void merge_counts(const PartOfSpeechTagger &);
 
 	public:
-		map<const string, int *> pos_counts;
 		// Constructors
 
 		PartOfSpeechTagger();
 
+		// Getters
+
+		int num_words(void) const;
+
+		const string & get_word(int) const;
+
+		const int * get_pos_counts(string_view) const;
+
 		// Functionality
 
-		vector<double> pos_frequencies(const string);
+		vector<double> pos_frequencies(const string) const;
+
+		bool pos_frequencies(string_view, double *) const;
 
 		// Training
 
 		void read_brown_corpus(const string);
 
-		// Other
+		long read_brown_corpus(const string, int);
 
-		~PartOfSpeechTagger(void);
+		static void list_brown_corpus_files(const string, vector<string> *);
+
+		// Persistence
+
+		void save(const string) const;
+
+		void load(const string);
 };
 
 class Sentence {
@@ -183,10 +123,30 @@ class Sentence {
 		static constexpr double lower_threshold = 0.2; // If output of the neural net < lower_threshold then punctuation is not sentence boundary
 		static constexpr double upper_threshold = 0.7; // If output of the neural net > upper_threshold then punctuation is sentence boundary
 
+		static const int batch_size = 1024; // Number of candidate boundaries scored per forward pass of the neural net
+
+		static void describe(const PartOfSpeechTagger &, string_view, double *);
+
+		static bool looks_like_boundary(string_view);
+
+		static size_t get_sentences(string_view, bool, const PartOfSpeechTagger *, NeuralNetwork *, InferenceNetwork *, vector<string_view> *);
+
 	public:
-		static vector<string> get_sentences(const string, NeuralNetwork);
+		static const int input_size = k * descriptor_length; // Number of inputs of the neural net
+
+		static size_t get_sentences(string_view, bool, const PartOfSpeechTagger &, NeuralNetwork &, vector<string_view> *);
+
+		static size_t get_sentences(string_view, bool, const PartOfSpeechTagger &, InferenceNetwork &, vector<string_view> *);
+
+		static size_t get_sentences(string_view, bool, vector<string_view> *);
+
+		// Training
+
+		static void training_samples(const string, const PartOfSpeechTagger &, vector<pair<ARRAY, ARRAY>> *);
+
+		static NeuralNetwork train_net(const vector<pair<ARRAY, ARRAY>> &, int, int = 1);
 
-		// static NeuralNetwork train_net(TRAINING DATA);
+		static InferenceNetwork freeze_net(const NeuralNetwork &, InferenceNetwork::Precision = InferenceNetwork::FLOAT32);
 };
 
 #endif
@@ -0,0 +1,232 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sharded_trie.h"
+#include "trie.h"
+#include "tokenizer.h"
+#include "prediction_server.h"
+
+using namespace std;
+
+static PredictionServer *shard_server = NULL; // The server of the shard running in this process, if any
+
+static void stop_shard(int) {
+	if (shard_server != NULL) {
+		shard_server->stop();
+	}
+}
+
+/* Calls f on each word of a dictionary file in the format of Trie::insert_from_file, with weights, and its weight. */
+static void read_dictionary(const string filepath, function<void(string_view, double)> f) {
+	ifstream dict (filepath);
+	if (!dict) {
+		throw runtime_error("Unable to open dictionary '" + filepath + "'");
+	}
+
+	Tokenizer tokenizer (" \n\t");
+	string line;
+	string_view word, rest;
+	getline(dict, line); // Skip first line which contains number of words
+	while (getline(dict, line)) {
+		word = tokenizer.first_token(line, &rest);
+		if (!word.empty()) {
+			f(word, atoi(string(tokenizer.first_token(rest)).c_str()));
+		}
+	}
+}
+
+/* Body of a worker process: loads the words of the dictionary whose first byte is in [first, last] and serves them until
+ * sent SIGTERM. */
+static void serve_shard(const string dictionary_path, unsigned char first, unsigned char last, const string socket_path,
+	int num_threads) {
+	Trie trie;
+	read_dictionary(dictionary_path, [&](string_view word, double weight) {
+		if ((unsigned char) word[0] >= first && (unsigned char) word[0] <= last) {
+			trie.insert(string(word), weight);
+		}
+	});
+	trie.build_deletion_index();
+
+	PredictionServer server (&trie, NULL, socket_path, num_threads);
+	shard_server = &server;
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop_shard;
+	sigaction(SIGTERM, &action, NULL);
+	server.run();
+	shard_server = NULL;
+}
+
+/* Begin ShardedTrie class. */
+
+/* Splits the given dictionary file, in the format of Trie::insert_from_file with weights, into at most the given number
+ * of shards, served on sockets named after the given prefix by workers of the given number of threads each. Returns
+ * once every shard is ready, and throws if one fails to start. */
+ShardedTrie::ShardedTrie(const string dictionary_path, int num_shards, const string socket_prefix, int threads_per_shard /* = 1 */) {
+	size_t counts[256] = {}, total = 0;
+	read_dictionary(dictionary_path, [&](string_view word, double) {
+		++counts[(unsigned char) word[0]];
+		++total;
+	});
+
+	/* Start a new shard at the first nonempty byte past each multiple of total / num_shards words. */
+	this->first_bytes.push_back(0);
+	size_t seen = 0;
+	for (int b = 0; b < 256; ++b) {
+		if (counts[b] > 0 && seen * num_shards >= this->first_bytes.size() * total && (int) this->first_bytes.size() < num_shards) {
+			this->first_bytes.push_back(b);
+		}
+		seen += counts[b];
+	}
+
+	for (size_t i = 0; i < this->first_bytes.size(); ++i) {
+		unsigned char last = i + 1 < this->first_bytes.size() ? this->first_bytes[i + 1] - 1 : 255;
+		this->socket_paths.push_back(socket_prefix + "-" + to_string(i) + ".sock");
+
+		pid_t pid = fork();
+		if (pid == 0) {
+			int status = 0;
+			try {
+				serve_shard(dictionary_path, this->first_bytes[i], last, this->socket_paths[i], threads_per_shard);
+			} catch (const exception &e) {
+				status = 1;
+			}
+			_exit(status);
+		} else if (pid < 0) {
+			this->stop_workers();
+			throw runtime_error(string("Unable to start shard worker: ") + strerror(errno));
+		}
+		this->workers.push_back(pid);
+	}
+
+	/* Wait for every worker to accept connections. */
+	for (size_t i = 0; i < this->workers.size(); ++i) {
+		while (true) {
+			try {
+				PredictionClient probe (this->socket_paths[i]);
+				break;
+			} catch (const runtime_error &e) {
+				int status;
+				if (waitpid(this->workers[i], &status, WNOHANG) == this->workers[i]) {
+					this->workers[i] = -1;
+					this->stop_workers();
+					throw runtime_error("Shard " + to_string(i) + " failed to start");
+				}
+				usleep(10000);
+			}
+		}
+	}
+}
+
+int ShardedTrie::num_shards(void) const { return this->first_bytes.size(); }
+
+/* Returns the shard holding the words that start like the given one; the empty word goes to shard 0. */
+int ShardedTrie::shard_of(const string word) const {
+	if (word.empty()) {
+		return 0;
+	}
+
+	return upper_bound(this->first_bytes.begin(), this->first_bytes.end(), (unsigned char) word[0]) - this->first_bytes.begin() - 1;
+}
+
+const string & ShardedTrie::get_socket_path(int shard) const { return this->socket_paths[shard]; }
+
+void ShardedTrie::stop_workers(void) {
+	for (pid_t pid : this->workers) {
+		if (pid > 0) {
+			kill(pid, SIGTERM);
+		}
+	}
+	for (pid_t pid : this->workers) {
+		if (pid > 0) {
+			waitpid(pid, NULL, 0);
+		}
+	}
+	this->workers.clear();
+}
+
+ShardedTrie::~ShardedTrie(void) { this->stop_workers(); }
+
+/* End ShardedTrie class. */
+
+/* Begin ShardRouter class. */
+
+ShardRouter::ShardRouter(const ShardedTrie &shards) : shards(&shards) {
+	for (int i = 0; i < shards.num_shards(); ++i) {
+		this->clients.push_back(unique_ptr<PredictionClient>(new PredictionClient(shards.get_socket_path(i))));
+	}
+}
+
+/* Sends the request to every shard before waiting for any, and returns their responses in shard order. */
+vector<PredictionResponse> ShardRouter::fan_out(RequestType type, uint8_t parameter, const string text) {
+	for (unique_ptr<PredictionClient> &client : this->clients) {
+		client->send(PredictionRequest {0, type, parameter, vector<string>(), text});
+	}
+
+	vector<PredictionResponse> ret;
+	for (size_t i = 0; i < this->clients.size(); ++i) {
+		ret.push_back(this->clients[i]->receive());
+		if (ret.back().status != RESPONSE_OK) {
+			throw runtime_error("Shard " + to_string(i) + " error: " + ret.back().words[0]);
+		}
+	}
+
+	return ret;
+}
+
+/* Returns the top k completions of the given prefix. Those of the empty prefix are merged from every shard, heaviest
+ * first and alphabetically among equals, as Trie::autocomplete orders them. */
+vector<string> ShardRouter::autocomplete(const string prefix, int k) {
+	k = min(max(k, 0), 255);
+	if (!prefix.empty()) {
+		return this->clients[this->shards->shard_of(prefix)]->autocomplete(prefix, k);
+	}
+
+	vector<pair<double, string>> merged;
+	for (const PredictionResponse &response : this->fan_out(AUTOCOMPLETE_REQUEST, k, prefix)) {
+		for (size_t i = 0; i < response.words.size(); ++i) {
+			merged.push_back(make_pair(response.scores[i], response.words[i]));
+		}
+	}
+	sort(merged.begin(), merged.end(), [](const pair<double, string> &a, const pair<double, string> &b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	});
+
+	vector<string> ret;
+	for (size_t i = 0; i < merged.size() && (int) i < k; ++i) {
+		ret.push_back(merged[i].second);
+	}
+
+	return ret;
+}
+
+/* Returns the words within the given distance of the given word, ordered by distance, then by descending weight, then
+ * alphabetically. Only the first k are returned, unless k is 0. */
+vector<string> ShardRouter::autocorrect(const string word, int max_distance, int k /* = 0 */) {
+	vector<tuple<string, double, int>> merged;
+	for (const PredictionResponse &response : this->fan_out(AUTOCORRECT_REQUEST, min(max(max_distance, 0), 255), word)) {
+		for (size_t i = 0; i < response.words.size(); ++i) {
+			merged.push_back(make_tuple(response.words[i], response.scores[i], Trie::levenschtein_distance(word, response.words[i])));
+		}
+	}
+
+	vector<string> ret = Trie::rank_suggestions(word, merged);
+	if (k > 0 && (size_t) k < ret.size()) {
+		ret.resize(k);
+	}
+
+	return ret;
+}
+
+/* End ShardRouter class. */
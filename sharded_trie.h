@@ -0,0 +1,74 @@
+#ifndef SHARDED_TRIE_H
+#define SHARDED_TRIE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <sys/types.h>
+#include "prediction_client.h"
+
+using namespace std;
+
+/* A dictionary split by the leading byte of its words across worker processes, so that no process has to hold all of it.
+ * Shard i holds the words whose first byte is at least first_bytes[i] and below first_bytes[i + 1]; the ranges are
+ * chosen to give the shards about the same number of words, and there may be fewer shards than asked for when a few
+ * leading bytes hold most words. Each shard is a forked process that reads its words from the dictionary file into a
+ * Trie, with a deletion index, and serves it through a PredictionServer on its own Unix socket; the parent only counts
+ * leading bytes, and never holds the dictionary.
+ *
+ * Construct a ShardedTrie before starting any threads, since it forks. Queries go through a ShardRouter, one per
+ * thread. The worker processes are stopped when the ShardedTrie is destroyed. */
+class ShardedTrie {
+	private:
+		vector<unsigned char> first_bytes;
+		vector<pid_t> workers;
+		vector<string> socket_paths;
+
+		void stop_workers(void);
+
+	public:
+		// Constructors
+
+		ShardedTrie(const string, int, const string, int = 1);
+
+		ShardedTrie(const ShardedTrie &) = delete;
+
+		// Getters
+
+		int num_shards(void) const;
+
+		int shard_of(const string) const;
+
+		const string & get_socket_path(int) const;
+
+		// Other
+
+		ShardedTrie & operator =(const ShardedTrie &) = delete;
+
+		~ShardedTrie(void);
+};
+
+/* Routes queries to the shards of a ShardedTrie, over one connection to each. autocomplete goes to the shard owning the
+ * prefix, or to every shard for the empty prefix; autocorrect goes to every shard, since a correction may change the first
+ * letter, and the shards work on it in parallel. Merged results are in the order a single Trie holding the whole
+ * dictionary would give. Not safe to share between threads. */
+class ShardRouter {
+	private:
+		const ShardedTrie *shards;
+		vector<unique_ptr<PredictionClient>> clients;
+
+		vector<PredictionResponse> fan_out(RequestType, uint8_t, const string);
+
+	public:
+		// Constructors
+
+		ShardRouter(const ShardedTrie &);
+
+		// Functionality
+
+		vector<string> autocomplete(const string, int);
+
+		vector<string> autocorrect(const string, int, int = 0);
+};
+
+#endif
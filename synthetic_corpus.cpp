@@ -0,0 +1,206 @@
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cctype>
+#include <cerrno>
+#include <sys/stat.h>
+#include "synthetic_corpus.h"
+
+using namespace std;
+
+static const char *onsets[] = {"b", "c", "d", "f", "g", "h", "j", "k", "l", "m", "n", "p", "r", "s", "t", "v", "w", "z", "br",
+	"ch", "cl", "dr", "fl", "gr", "pl", "pr", "sh", "st", "th", "tr", ""};
+static const char *vowels[] = {"a", "e", "i", "o", "u", "ai", "ea", "ee", "oo", "ou"};
+static const char *codas[] = {"", "", "", "n", "r", "s", "t", "l", "m", "nd", "st", "ng", "ck"};
+
+/* Brown corpus tags, with the number of vocabulary slots out of 16 that each gets. */
+static const pair<const char *, int> tag_shares[] = {{"nn", 5}, {"vb", 2}, {"vbd", 2}, {"jj", 2}, {"rb", 1}, {"nns", 2},
+	{"np", 1}, {"in", 1}};
+
+static const char *abbreviations[] = {"Mr.", "Dr.", "St.", "Mrs."};
+
+template <typename T, size_t N>
+static size_t length_of(T (&)[N]) { return N; }
+
+/* Begin SyntheticCorpus class. */
+
+/* Generates a vocabulary of the given size from the given seed. */
+SyntheticCorpus::SyntheticCorpus(int vocabulary_size /* = 20000 */, uint64_t seed /* = 1 */) : generator(seed) {
+	if (vocabulary_size <= 0) {
+		throw runtime_error("Synthetic vocabulary must be nonempty");
+	}
+
+	set<string> seen;
+	double total = 0;
+	while ((int) this->words.size() < vocabulary_size) {
+		string word;
+		for (int syllables = 1 + this->next_index(3) + (this->next_index(4) == 0); syllables > 0; --syllables) {
+			word += onsets[this->next_index(length_of(onsets))];
+			word += vowels[this->next_index(length_of(vowels))];
+			word += codas[this->next_index(length_of(codas))];
+		}
+		if (!seen.insert(word).second) {
+			continue;
+		}
+
+		size_t slot = this->next_index(16);
+		const char *tag = tag_shares[0].first;
+		for (const pair<const char *, int> &share : tag_shares) {
+			if (slot < (size_t) share.second) {
+				tag = share.first;
+				break;
+			}
+			slot -= share.second;
+		}
+
+		this->words.push_back(word);
+		this->tags.push_back(tag);
+		total += this->get_weight(this->words.size() - 1);
+		this->cumulative_weights.push_back(total);
+	}
+}
+
+/* Uniform over [0, n), up to a bias of n / 2^64. */
+size_t SyntheticCorpus::next_index(size_t n) { return this->generator() % n; }
+
+/* Uniform over [0, 1). */
+double SyntheticCorpus::next_unit(void) { return (this->generator() >> 11) * 0x1.0p-53; }
+
+size_t SyntheticCorpus::vocabulary_size(void) const { return this->words.size(); }
+
+const string & SyntheticCorpus::get_word(size_t rank) const { return this->words[rank]; }
+
+double SyntheticCorpus::get_weight(size_t rank) const { return (double) (1000000 / (rank + 1)); }
+
+/* Returns the rank of a word drawn in proportion to its weight. */
+size_t SyntheticCorpus::sample_word(void) {
+	double target = this->next_unit() * this->cumulative_weights.back();
+	return min((size_t) (upper_bound(this->cumulative_weights.begin(), this->cumulative_weights.end(), target)
+		- this->cumulative_weights.begin()), this->words.size() - 1);
+}
+
+/* Applies the given number of random substitutions, deletions, insertions and transpositions of adjacent letters. */
+string SyntheticCorpus::typo(const string word, int edits) {
+	string ret = word;
+	for (int i = 0; i < edits; ++i) {
+		char letter = 'a' + this->next_index(26);
+		size_t position = this->next_index(ret.length() + 1);
+		switch (this->next_index(4)) {
+			case 0:
+				if (position < ret.length()) {
+					ret[position] = letter;
+					break;
+				}
+				[[fallthrough]]; // Insert past the end instead
+			case 1:
+				ret.insert(position, 1, letter);
+				break;
+			case 2:
+				if (ret.length() > 1) {
+					ret.erase(min(position, ret.length() - 1), 1);
+				} else {
+					ret.push_back(letter);
+				}
+				break;
+			default:
+				if (ret.length() > 1) {
+					position = min(position, ret.length() - 2);
+					swap(ret[position], ret[position + 1]);
+				} else {
+					ret.push_back(letter);
+				}
+		}
+	}
+
+	return ret;
+}
+
+/* Returns a sentence of 4 to 20 words as (token, Brown tag) pairs, punctuation included as tokens of its own. */
+vector<pair<string, string>> SyntheticCorpus::sentence(void) {
+	vector<pair<string, string>> ret;
+	for (int length = 4 + this->next_index(17); length > 0; --length) {
+		if (this->next_unit() < 0.03) {
+			ret.push_back(make_pair(abbreviations[this->next_index(length_of(abbreviations))], "np"));
+		}
+
+		size_t rank = this->sample_word();
+		ret.push_back(make_pair(this->words[rank], this->tags[rank]));
+		if (length > 1 && this->next_unit() < 0.08) {
+			ret.push_back(make_pair(",", ","));
+		}
+	}
+	ret.front().first[0] = toupper(ret.front().first[0]);
+
+	double end = this->next_unit();
+	ret.push_back(end < 0.9 ? make_pair(".", ".") : end < 0.95 ? make_pair("?", ".") : make_pair("!", "."));
+	return ret;
+}
+
+/* Static function. Joins a sentence's tokens into text, punctuation attached to the preceding word. */
+string SyntheticCorpus::to_text(const vector<pair<string, string>> &sentence) {
+	string ret;
+	for (const pair<string, string> &token : sentence) {
+		bool punctuation = token.first == "," || token.first == "." || token.first == "?" || token.first == "!";
+		if (!ret.empty() && !punctuation) {
+			ret += ' ';
+		}
+		ret += token.first;
+	}
+
+	return ret;
+}
+
+/* Writes the vocabulary in the format of Trie::insert_from_file, with weights. */
+void SyntheticCorpus::write_dictionary(const string filepath) const {
+	ofstream file (filepath);
+	file << this->words.size() << "\n";
+	for (size_t rank = 0; rank < this->words.size(); ++rank) {
+		file << this->words[rank] << " " << (long) this->get_weight(rank) << "\n";
+	}
+
+	if (!file.good()) {
+		throw runtime_error("Error writing dictionary to '" + filepath + "'\n");
+	}
+}
+
+/* Writes the given number of sentences as plain text, five to a paragraph, one paragraph per line. */
+void SyntheticCorpus::write_text(const string filepath, int num_sentences) {
+	ofstream file (filepath);
+	for (int i = 0; i < num_sentences; ++i) {
+		file << to_text(this->sentence()) << (i % 5 == 4 || i == num_sentences - 1 ? "\n" : " ");
+	}
+
+	if (!file.good()) {
+		throw runtime_error("Error writing text to '" + filepath + "'\n");
+	}
+}
+
+/* Writes a Brown-format corpus of the given number of files, of the given number of sentences each, into the given
+ * directory, which is created if necessary. */
+void SyntheticCorpus::write_brown_corpus(const string directory, int num_files, int sentences_per_file) {
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		throw runtime_error("Unable to create directory '" + directory + "'\n");
+	}
+
+	for (int f = 0; f < num_files; ++f) {
+		string filepath = directory + "/cs" + (f < 10 ? "0" : "") + to_string(f);
+		ofstream file (filepath);
+		for (int s = 0; s < sentences_per_file; ++s) {
+			file << "\n\n\t";
+			for (const pair<string, string> &token : this->sentence()) {
+				file << token.first << "/" << token.second << " ";
+			}
+			file << "\n";
+		}
+
+		if (!file.good()) {
+			throw runtime_error("Error writing corpus file '" + filepath + "'\n");
+		}
+	}
+}
+
+/* End SyntheticCorpus class. */
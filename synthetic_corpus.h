@@ -0,0 +1,61 @@
+#ifndef SYNTHETIC_CORPUS_H
+#define SYNTHETIC_CORPUS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/* Deterministic generator of dictionaries, text and Brown-format corpora, so that benchmarks and tools run offline and
+ * give the same inputs on every machine. Words are pronounceable strings of syllables, weighted by a Zipf distribution
+ * over their rank (the weight of the word of rank r is 1000000 / r), and each has a fixed Brown corpus tag. Sentences
+ * draw words by weight, with commas, abbreviations and closing punctuation mixed in.
+ *
+ * Only the raw output of mt19937_64, whose sequence the standard fixes, is used; the standard distributions are not,
+ * since their algorithms differ between library implementations. */
+class SyntheticCorpus {
+	private:
+		mt19937_64 generator;
+		vector<string> words; // In order of rank
+		vector<string> tags;
+		vector<double> cumulative_weights;
+
+		size_t next_index(size_t);
+
+		double next_unit(void);
+
+	public:
+		// Constructors
+
+		SyntheticCorpus(int = 20000, uint64_t = 1);
+
+		// Getters
+
+		size_t vocabulary_size(void) const;
+
+		const string & get_word(size_t) const;
+
+		double get_weight(size_t) const;
+
+		// Functionality
+
+		size_t sample_word(void);
+
+		string typo(const string, int);
+
+		vector<pair<string, string>> sentence(void);
+
+		static string to_text(const vector<pair<string, string>> &);
+
+		void write_dictionary(const string) const;
+
+		void write_text(const string, int);
+
+		void write_brown_corpus(const string, int, int);
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include "thread_pool.h"
+
+using namespace std;
+
+/* Begin ThreadPool class. */
+
+ThreadPool::ThreadPool(int num_threads) : num_tasks(0), next_task(0), num_pending(0), generation(0), stopping(false) {
+	for (int i = 1; i < num_threads; ++i) {
+		this->workers.push_back(thread(&ThreadPool::worker_loop, this, i));
+	}
+}
+
+int ThreadPool::num_threads(void) const { return this->workers.size() + 1; }
+
+/* Claims and runs iterations of the current loop until none are left. */
+void ThreadPool::run_tasks(int worker) {
+	int i;
+	while ((i = this->next_task++) < this->num_tasks) {
+		try {
+			this->task(i, worker);
+		} catch (...) {
+			unique_lock<mutex> guard (this->lock);
+			if (!this->error) {
+				this->error = current_exception();
+			}
+		}
+	}
+}
+
+void ThreadPool::worker_loop(int worker) {
+	unsigned long seen = 0;
+	while (true) {
+		{
+			unique_lock<mutex> guard (this->lock);
+			this->work_available.wait(guard, [&] { return this->stopping || this->generation != seen; });
+			if (this->stopping) {
+				return;
+			}
+			seen = this->generation;
+		}
+
+		this->run_tasks(worker);
+
+		unique_lock<mutex> guard (this->lock);
+		if (--this->num_pending == 0) {
+			this->work_done.notify_one();
+		}
+	}
+}
+
+/* Runs f(i, worker) for every i in [0, n), spreading iterations dynamically over the pool, and returns once all of them
+ * have finished. worker identifies the executing thread and lies in [0, num_threads()), so it can index per-thread state. */
+void ThreadPool::parallel_for(int n, function<void(int, int)> f) {
+	{
+		unique_lock<mutex> guard (this->lock);
+		this->task = f;
+		this->num_tasks = n;
+		this->next_task = 0;
+		this->num_pending = this->workers.size();
+		this->error = nullptr;
+		++this->generation;
+	}
+	this->work_available.notify_all();
+
+	this->run_tasks(0);
+
+	unique_lock<mutex> guard (this->lock);
+	this->work_done.wait(guard, [&] { return this->num_pending == 0; });
+	this->task = nullptr;
+
+	if (this->error) {
+		rethrow_exception(this->error);
+	}
+}
+
+ThreadPool::~ThreadPool(void) {
+	{
+		unique_lock<mutex> guard (this->lock);
+		this->stopping = true;
+	}
+	this->work_available.notify_all();
+
+	for (thread &t : this->workers) {
+		t.join();
+	}
+}
+
+/* End ThreadPool class. */
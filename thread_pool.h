@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+using namespace std;
+
+/* A fixed set of worker threads which cooperatively execute the iterations of a parallel loop. The calling thread takes
+ * part in each loop as worker 0, so a pool of n threads spawns n - 1 workers. */
+class ThreadPool {
+	private:
+		vector<thread> workers;
+		mutex lock;
+		condition_variable work_available, work_done;
+
+		function<void(int, int)> task; // Body of the current loop, called with (iteration, worker index)
+		int num_tasks;
+		atomic<int> next_task;
+		int num_pending; // Workers which haven't yet finished the current loop
+		unsigned long generation; // Incremented once per loop so that workers can tell new work from spurious wakeups
+		bool stopping;
+		exception_ptr error; // First exception thrown by the current loop, rethrown on the calling thread
+
+		void run_tasks(int);
+
+		void worker_loop(int);
+
+	public:
+		// Constructors
+
+		ThreadPool(int = thread::hardware_concurrency());
+
+		ThreadPool(const ThreadPool &) = delete;
+
+		// Getters
+
+		int num_threads(void) const;
+
+		// Functionality
+
+		void parallel_for(int, function<void(int, int)>);
+
+		// Other
+
+		ThreadPool & operator =(const ThreadPool &) = delete;
+
+		~ThreadPool(void);
+};
+
+#endif
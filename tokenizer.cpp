@@ -0,0 +1,236 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "tokenizer.h"
+
+using namespace std;
+
+/* Character classes, each testable on a single byte or on a whole vector of bytes at once. A byte c lies in [lo, lo + n)
+ * iff (c - lo) < n as unsigned bytes; SSE2/AVX2 only have signed byte compares, so both sides are offset by 0x80. */
+
+#if defined(__SSE2__)
+static inline __m128i in_range(__m128i c, char lo, int n) {
+	__m128i shifted = _mm_xor_si128(_mm_sub_epi8(c, _mm_set1_epi8(lo)), _mm_set1_epi8((char) 0x80));
+	return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (n - 128)));
+}
+#endif
+
+#if defined(__AVX2__)
+static inline __m256i in_range(__m256i c, char lo, int n) {
+	__m256i shifted = _mm256_xor_si256(_mm256_sub_epi8(c, _mm256_set1_epi8(lo)), _mm256_set1_epi8((char) 0x80));
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (n - 128)), shifted);
+}
+#endif
+
+struct AlphaClass {
+	static bool test(char c) { return (unsigned char) ((c | 0x20) - 'a') < 26; }
+#if defined(__SSE2__)
+	static __m128i match(__m128i c) { return in_range(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 26); }
+#endif
+#if defined(__AVX2__)
+	static __m256i match(__m256i c) { return in_range(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 26); }
+#endif
+};
+
+struct DigitClass {
+	static bool test(char c) { return (unsigned char) (c - '0') < 10; }
+#if defined(__SSE2__)
+	static __m128i match(__m128i c) { return in_range(c, '0', 10); }
+#endif
+#if defined(__AVX2__)
+	static __m256i match(__m256i c) { return in_range(c, '0', 10); }
+#endif
+};
+
+/* Same set as isspace in the C locale: space, \t, \n, \v, \f and \r. */
+struct WhitespaceClass {
+	static bool test(char c) { return c == ' ' || (unsigned char) (c - '\t') < 5; }
+#if defined(__SSE2__)
+	static __m128i match(__m128i c) { return _mm_or_si128(in_range(c, '\t', 5), _mm_cmpeq_epi8(c, _mm_set1_epi8(' '))); }
+#endif
+#if defined(__AVX2__)
+	static __m256i match(__m256i c) { return _mm256_or_si256(in_range(c, '\t', 5), _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '))); }
+#endif
+};
+
+/* Returns the first position in [p, end) whose byte is not in the given class, or end. */
+template <class Class>
+static const char * skip_class(const char *p, const char *end) {
+#if defined(__AVX2__)
+	for (; end - p >= 32; p += 32) {
+		uint32_t outside = ~(uint32_t) _mm256_movemask_epi8(Class::match(_mm256_loadu_si256((const __m256i *) p)));
+		if (outside != 0) {
+			return p + __builtin_ctz(outside);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	for (; end - p >= 16; p += 16) {
+		uint32_t outside = ~_mm_movemask_epi8(Class::match(_mm_loadu_si128((const __m128i *) p))) & 0xffff;
+		if (outside != 0) {
+			return p + __builtin_ctz(outside);
+		}
+	}
+#endif
+	while (p < end && Class::test(*p)) {
+		++p;
+	}
+
+	return p;
+}
+
+/* Begin Tokenizer class. */
+
+Tokenizer::Tokenizer(const char *delims /* = " \t\n" */) : delimiters(delims) {
+	for (char c : this->delimiters) {
+		this->is_delimiter[(unsigned char) c] = true;
+	}
+}
+
+const char * Tokenizer::skip_alpha(const char *begin, const char *end) { return skip_class<AlphaClass>(begin, end); }
+
+const char * Tokenizer::skip_digits(const char *begin, const char *end) { return skip_class<DigitClass>(begin, end); }
+
+const char * Tokenizer::skip_whitespace(const char *begin, const char *end) { return skip_class<WhitespaceClass>(begin, end); }
+
+/* Returns the first position in [p, end) which isn't a delimiter, or end. Bytes are compared against every delimiter in
+ * parallel, so this is only vectorized for small delimiter sets. */
+const char * Tokenizer::skip_delimiters(const char *p, const char *end) const {
+	int num_delimiters = this->delimiters.length();
+	if (num_delimiters <= max_simd_delimiters) {
+#if defined(__AVX2__)
+		for (; end - p >= 32; p += 32) {
+			__m256i c = _mm256_loadu_si256((const __m256i *) p), match = _mm256_setzero_si256();
+			for (int i = 0; i < num_delimiters; ++i) {
+				match = _mm256_or_si256(match, _mm256_cmpeq_epi8(c, _mm256_set1_epi8(this->delimiters[i])));
+			}
+
+			uint32_t outside = ~(uint32_t) _mm256_movemask_epi8(match);
+			if (outside != 0) {
+				return p + __builtin_ctz(outside);
+			}
+		}
+#endif
+#if defined(__SSE2__)
+		for (; end - p >= 16; p += 16) {
+			__m128i c = _mm_loadu_si128((const __m128i *) p), match = _mm_setzero_si128();
+			for (int i = 0; i < num_delimiters; ++i) {
+				match = _mm_or_si128(match, _mm_cmpeq_epi8(c, _mm_set1_epi8(this->delimiters[i])));
+			}
+
+			uint32_t outside = ~_mm_movemask_epi8(match) & 0xffff;
+			if (outside != 0) {
+				return p + __builtin_ctz(outside);
+			}
+		}
+#endif
+	}
+
+	while (p < end && this->is_delimiter[(unsigned char) *p]) {
+		++p;
+	}
+
+	return p;
+}
+
+/* Returns the first position in [p, end) which is a delimiter, or end. */
+const char * Tokenizer::find_delimiter(const char *p, const char *end) const {
+	int num_delimiters = this->delimiters.length();
+	if (num_delimiters <= max_simd_delimiters) {
+#if defined(__AVX2__)
+		for (; end - p >= 32; p += 32) {
+			__m256i c = _mm256_loadu_si256((const __m256i *) p), match = _mm256_setzero_si256();
+			for (int i = 0; i < num_delimiters; ++i) {
+				match = _mm256_or_si256(match, _mm256_cmpeq_epi8(c, _mm256_set1_epi8(this->delimiters[i])));
+			}
+
+			uint32_t inside = _mm256_movemask_epi8(match);
+			if (inside != 0) {
+				return p + __builtin_ctz(inside);
+			}
+		}
+#endif
+#if defined(__SSE2__)
+		for (; end - p >= 16; p += 16) {
+			__m128i c = _mm_loadu_si128((const __m128i *) p), match = _mm_setzero_si128();
+			for (int i = 0; i < num_delimiters; ++i) {
+				match = _mm_or_si128(match, _mm_cmpeq_epi8(c, _mm_set1_epi8(this->delimiters[i])));
+			}
+
+			uint32_t inside = _mm_movemask_epi8(match);
+			if (inside != 0) {
+				return p + __builtin_ctz(inside);
+			}
+		}
+#endif
+	}
+
+	while (p < end && !this->is_delimiter[(unsigned char) *p]) {
+		++p;
+	}
+
+	return p;
+}
+
+/* Appends the maximal runs of non-delimiter characters in the given text to ret, like repeated calls to strtok but without
+ * modifying or copying the text. */
+void Tokenizer::split(string_view text, vector<string_view> *ret) const {
+	const char *p = text.data(), *end = p + text.size();
+
+	while ((p = this->skip_delimiters(p, end)) < end) {
+		const char *token_end = this->find_delimiter(p, end);
+		ret->push_back(string_view(p, token_end - p));
+		p = token_end;
+	}
+}
+
+/* Returns the first token of the given text (empty if there is none). If rest is given, it is set to the text following
+ * that token. */
+string_view Tokenizer::first_token(string_view text, string_view *rest /* = NULL */) const {
+	const char *end = text.data() + text.size();
+	const char *start = this->skip_delimiters(text.data(), end);
+	const char *token_end = this->find_delimiter(start, end);
+
+	if (rest != NULL) {
+		*rest = string_view(token_end, end - token_end);
+	}
+
+	return string_view(start, token_end - start);
+}
+
+/* Appends the tokens of the given text to ret. A token is a sequence of alphabetic characters, a sequence of digits
+ * (optionally preceded by a minus sign and including at most one decimal point), or any other single character. */
+void Tokenizer::tokenize(string_view text, vector<string_view> *ret) {
+	const char *p = text.data(), *end = p + text.size();
+
+	while (p < end) {
+		const char *start = p;
+
+		if (AlphaClass::test(*p)) {
+			p = skip_alpha(p + 1, end);
+		} else if (DigitClass::test(*p) || (*p == '-' && p + 1 < end && DigitClass::test(p[1]))) {
+			p = skip_digits(p + 1, end);
+			if (p < end && *p == '.') {
+				p = skip_digits(p + 1, end);
+			}
+		} else {
+			++p;
+		}
+
+		ret->push_back(string_view(start, p - start));
+	}
+}
+
+/* Returns whether the given text consists only of whitespace. */
+bool Tokenizer::is_whitespace(string_view text) {
+	return skip_whitespace(text.data(), text.data() + text.size()) == text.data() + text.size();
+}
+
+/* End Tokenizer class. */
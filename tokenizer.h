@@ -0,0 +1,51 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+
+using namespace std;
+
+/* Splits text into string_view spans without copying it. Character classes are tested 32 bytes at a time with AVX2 or
+ * 16 bytes at a time with SSE2 when the compiler targets them, falling back to a byte-at-a-time loop otherwise. Spans
+ * point into the input text and are appended to a caller-owned vector, which can be cleared and reused between calls. */
+class Tokenizer {
+	private:
+		static const int max_simd_delimiters = 8; // Delimiter sets larger than this are only tested through the lookup table
+
+		string delimiters;
+		bitset<256> is_delimiter;
+
+	public:
+		// Constructors
+
+		Tokenizer(const char * = " \t\n");
+
+		// Functionality
+
+		const char * skip_delimiters(const char *, const char *) const;
+
+		const char * find_delimiter(const char *, const char *) const;
+
+		void split(string_view, vector<string_view> *) const;
+
+		string_view first_token(string_view, string_view * = NULL) const;
+
+		// Character class scans. Each returns the first position in [begin, end) not in the class, or end.
+
+		static const char * skip_alpha(const char *, const char *);
+
+		static const char * skip_digits(const char *, const char *);
+
+		static const char * skip_whitespace(const char *, const char *);
+
+		// Other
+
+		static void tokenize(string_view, vector<string_view> *);
+
+		static bool is_whitespace(string_view);
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include <vector>
+#include <utility>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "trainer.h"
+
+using namespace std;
+
+/* Begin Optimizer class. */
+
+Optimizer::Optimizer(double learning_rate) : learning_rate(learning_rate) {}
+
+double Optimizer::get_learning_rate(void) const { return this->learning_rate; }
+
+/* Called after every epoch with the parameters and the epoch's mean loss, which an optimizer that adapts per epoch may
+ * change. Does nothing otherwise. */
+void Optimizer::end_epoch(double *, size_t, double) {}
+
+Optimizer::~Optimizer(void) {}
+
+/* End Optimizer class. */
+
+/* Begin SGD class. */
+
+SGD::SGD(double learning_rate) : Optimizer(learning_rate) {}
+
+void SGD::step(double *parameters, const double *gradient, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		parameters[i] -= this->learning_rate * gradient[i];
+	}
+}
+
+/* End SGD class. */
+
+/* Begin Momentum class. */
+
+Momentum::Momentum(double learning_rate, double momentum /* = 0.9 */, bool nesterov /* = false */)
+	: Optimizer(learning_rate), momentum(momentum), nesterov(nesterov) {}
+
+void Momentum::step(double *parameters, const double *gradient, size_t n) {
+	this->velocity.resize(n, 0.0);
+
+	for (size_t i = 0; i < n; ++i) {
+		double previous = this->velocity[i];
+		this->velocity[i] = this->momentum * previous - this->learning_rate * gradient[i];
+
+		if (this->nesterov) { // Look-ahead form: step from where the momentum alone would have taken the parameters
+			parameters[i] += -this->momentum * previous + (1 + this->momentum) * this->velocity[i];
+		} else {
+			parameters[i] += this->velocity[i];
+		}
+	}
+}
+
+/* End Momentum class. */
+
+/* Begin Adam class. */
+
+Adam::Adam(double learning_rate /* = 0.001 */, double beta1 /* = 0.9 */, double beta2 /* = 0.999 */, double epsilon /* = 1e-8 */)
+	: Optimizer(learning_rate), beta1(beta1), beta2(beta2), epsilon(epsilon), t(0) {}
+
+void Adam::step(double *parameters, const double *gradient, size_t n) {
+	this->m.resize(n, 0.0);
+	this->v.resize(n, 0.0);
+
+	++this->t;
+	double step_size = this->learning_rate * sqrt(1 - pow(this->beta2, this->t)) / (1 - pow(this->beta1, this->t));
+
+	for (size_t i = 0; i < n; ++i) {
+		this->m[i] = this->beta1 * this->m[i] + (1 - this->beta1) * gradient[i];
+		this->v[i] = this->beta2 * this->v[i] + (1 - this->beta2) * gradient[i] * gradient[i];
+		parameters[i] -= step_size * this->m[i] / (sqrt(this->v[i]) + this->epsilon);
+	}
+}
+
+/* End Adam class. */
+
+/* Begin BoldDriver class. */
+
+BoldDriver::BoldDriver(double learning_rate, double increase /* = 1.05 */, double decrease /* = 0.5 */)
+	: Optimizer(learning_rate), increase(increase), decrease(decrease), previous_loss(numeric_limits<double>::infinity()) {}
+
+void BoldDriver::step(double *parameters, const double *gradient, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		parameters[i] -= this->learning_rate * gradient[i];
+	}
+}
+
+/* Keeps the epoch if its loss fell, speeding up a little; otherwise puts the parameters back as they were after the last
+ * epoch kept, and slows down. The loss to beat stays that of the last epoch kept. */
+void BoldDriver::end_epoch(double *parameters, size_t n, double loss) {
+	if (loss < this->previous_loss) {
+		this->learning_rate *= this->increase;
+		this->previous_loss = loss;
+		this->kept.assign(parameters, parameters + n);
+	} else { // Overshot, so go back and take smaller steps
+		if (this->kept.size() == n) {
+			copy(this->kept.begin(), this->kept.end(), parameters);
+		}
+		this->learning_rate *= this->decrease;
+	}
+}
+
+/* End BoldDriver class. */
+
+/* Begin Trainer class. */
+
+Trainer::Trainer(NeuralNetwork &net, Optimizer &optimizer, int batch_size /* = 32 */, int num_threads /* = 1 */, double weight_decay /* = 0.0 */)
+	: net(net), optimizer(optimizer), batch_size(batch_size), weight_decay(weight_decay), pool(num_threads),
+	  workspaces(num_threads), inputs(num_threads), targets(num_threads), gradients(num_threads), losses(num_threads), generator(rand()) {
+	int shard_size = (batch_size + num_threads - 1) / num_threads;
+	for (int t = 0; t < num_threads; ++t) {
+		this->inputs[t].resize((size_t) shard_size * net.input_size());
+		this->targets[t].resize((size_t) shard_size * net.output_size());
+		this->gradients[t].resize(net.num_parameters());
+	}
+}
+
+/* Runs one epoch over the samples in a random order, returning the mean squared error seen during the epoch. */
+double Trainer::train_epoch(const vector<pair<ARRAY, ARRAY>> &samples) {
+	int num_threads = this->pool.num_threads(), inputs = this->net.input_size(), outputs = this->net.output_size();
+	size_t num_parameters = this->net.num_parameters();
+	double *parameters = this->net.get_parameters();
+
+	if (this->order.size() != samples.size()) {
+		this->order.resize(samples.size());
+		for (size_t i = 0; i < samples.size(); ++i) {
+			this->order[i] = i;
+		}
+	}
+	shuffle(this->order.begin(), this->order.end(), this->generator);
+
+	double epoch_loss = 0.0;
+	for (size_t start = 0; start < samples.size(); start += this->batch_size) {
+		int size = min((size_t) this->batch_size, samples.size() - start);
+		int shard_size = (size + num_threads - 1) / num_threads;
+
+		/* Each thread computes the gradient of its shard of the minibatch. */
+		this->pool.parallel_for(num_threads, [&](int shard, int) {
+			int first = shard * shard_size, last = min(size, first + shard_size);
+			if (first >= last) {
+				fill(this->gradients[shard].begin(), this->gradients[shard].end(), 0.0);
+				this->losses[shard] = 0.0;
+				return;
+			}
+
+			for (int b = first; b < last; ++b) {
+				const pair<ARRAY, ARRAY> &sample = samples[this->order[start + b]];
+				copy(sample.first.begin(), sample.first.end(), &this->inputs[shard][(size_t) (b - first) * inputs]);
+				copy(sample.second.begin(), sample.second.end(), &this->targets[shard][(size_t) (b - first) * outputs]);
+			}
+
+			this->net.forward(this->inputs[shard].data(), last - first, &this->workspaces[shard]);
+			this->losses[shard] = this->net.backward(this->targets[shard].data(), &this->workspaces[shard], this->gradients[shard].data());
+		});
+
+		/* Reduce into the first buffer, average, and add the weight decay term. */
+		AlignedArray &gradient = this->gradients[0];
+		for (int t = 1; t < num_threads; ++t) {
+			for (size_t i = 0; i < num_parameters; ++i) {
+				gradient[i] += this->gradients[t][i];
+			}
+		}
+
+		for (size_t i = 0; i < num_parameters; ++i) {
+			gradient[i] = gradient[i] / size + this->weight_decay * parameters[i];
+		}
+
+		for (double loss : this->losses) {
+			epoch_loss += 2 * loss; // backward returns half the summed squared error
+		}
+
+		this->optimizer.step(parameters, gradient.data(), num_parameters);
+	}
+
+	epoch_loss /= samples.size() * outputs;
+	this->optimizer.end_epoch(parameters, num_parameters, epoch_loss);
+
+	return epoch_loss;
+}
+
+/* Trains for the given number of epochs, returning the mean squared error seen during the last one. */
+double Trainer::train(const vector<pair<ARRAY, ARRAY>> &samples, int epochs) {
+	double loss = 0.0;
+	for (int epoch = 0; epoch < epochs; ++epoch) {
+		loss = this->train_epoch(samples);
+	}
+
+	return loss;
+}
+
+/* End Trainer class. */
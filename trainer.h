@@ -0,0 +1,118 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <vector>
+#include <utility>
+#include <random>
+#include <cstddef>
+#include "neural_network.h"
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/* Update rule applied to a network's parameters given the gradient of the loss averaged over a minibatch. */
+class Optimizer {
+	protected:
+		double learning_rate;
+
+	public:
+		// Constructors
+
+		Optimizer(double);
+
+		// Getters
+
+		double get_learning_rate(void) const;
+
+		// Functionality
+
+		virtual void step(double *, const double *, size_t) = 0;
+
+		virtual void end_epoch(double *, size_t, double);
+
+		// Other
+
+		virtual ~Optimizer(void);
+};
+
+/* Plain gradient descent. */
+class SGD : public Optimizer {
+	public:
+		SGD(double);
+
+		void step(double *, const double *, size_t);
+};
+
+/* Gradient descent with classical (or, if nesterov is set, Nesterov) momentum. */
+class Momentum : public Optimizer {
+	private:
+		double momentum;
+		bool nesterov;
+		vector<double> velocity;
+
+	public:
+		Momentum(double, double = 0.9, bool = false);
+
+		void step(double *, const double *, size_t);
+};
+
+/* Adam: per-parameter learning rates from bias-corrected estimates of the gradient's first and second moments. */
+class Adam : public Optimizer {
+	private:
+		double beta1, beta2, epsilon;
+		long t;
+		vector<double> m, v;
+
+	public:
+		Adam(double = 0.001, double = 0.9, double = 0.999, double = 1e-8);
+
+		void step(double *, const double *, size_t);
+};
+
+/* Gradient descent whose learning rate is adapted once per epoch: grown slightly while the loss keeps falling, and cut
+ * sharply when it rises, in which case the epoch's steps are undone as well. */
+class BoldDriver : public Optimizer {
+	private:
+		double increase, decrease;
+		double previous_loss; // Loss of the last epoch kept
+		vector<double> kept; // Parameters after the last epoch kept, restored when an epoch makes the loss worse
+
+	public:
+		BoldDriver(double, double = 1.05, double = 0.5);
+
+		void step(double *, const double *, size_t);
+
+		void end_epoch(double *, size_t, double);
+};
+
+/* Minibatch training engine for NeuralNetwork. Each minibatch is split into one shard per thread; every thread runs the
+ * forward and backward passes of its shard into its own gradient buffer, the buffers are summed, and the optimizer takes
+ * one step with the averaged gradient plus L2 weight decay. */
+class Trainer {
+	private:
+		NeuralNetwork &net;
+		Optimizer &optimizer;
+		int batch_size;
+		double weight_decay;
+
+		ThreadPool pool;
+		vector<NeuralNetwork::Workspace> workspaces; // One per thread
+		vector<AlignedArray> inputs, targets, gradients; // One per thread
+		vector<double> losses; // One per thread
+		vector<size_t> order; // Sample visiting order, reshuffled every epoch
+		mt19937 generator;
+
+	public:
+		// Constructors
+
+		Trainer(NeuralNetwork &, Optimizer &, int = 32, int = 1, double = 0.0);
+
+		// Training
+
+		double train_epoch(const vector<pair<ARRAY, ARRAY>> &);
+
+		double train(const vector<pair<ARRAY, ARRAY>> &, int);
+};
+
+#endif
@@ -1,482 +1,977 @@
-#include <string>
-#include <cstring>
-#include <map>
-#include <limits>
-#include <sstream>
-#include <exception>
-#include <queue>
-#include <vector>
-#include <fstream>
-#include <algorithm>
-#include <tuple>
-#include <utility>
-#include "trie.h"
-
-/* Begin Node class. */
-
-map<Node *, double> Node::max_weights;
-
-Node::Node(void) : end(false), weight(-1) {}
-
-Node::Node(bool e) : end(e), weight(-1) {}
-
-Node::Node(bool e, double w) : end(e), weight(w) {}
-
-Node::Node(const Node &n) { 
-	this->end = n.is_end();
-	this->weight = n.get_weight();
-	this->children = n.get_children();
-}
-
-/* Static function. */
-double Node::get_max_weight(Node *n) {
-	if (Node::max_weights.find(n) == Node::max_weights.end()) { // Node not found
-		return - numeric_limits<double>::infinity();
-	} else {
-		return Node::max_weights.find(n)->second;
-	}
-}
-
-/* Static function. */
-void Node::set_max_weight(Node *n, double w) { Node::max_weights[n] = w; }
-
-/* Static function. */
-void Node::remove_max_weight(Node *n) { Node::max_weights.erase(n); }
-
-bool Node::is_end(void) const { return this->end; }
-
-double Node::get_weight(void) const { return this->weight; }
-
-int Node::num_children(void) const { return this->children.size(); }
-
-Node * Node::get_child(char c) const {
-	if (!this->contains_key(c)) {
-		stringstream error_message;
-		error_message << "Node with key '" << c << "' not found";
-		throw runtime_error(error_message.str());
-	}
-	
-	return this->children.find(c)->second;
-}
-
-map<char, Node *> Node::get_children(void) const { return this->children; }
-
-void Node::set_child(char c, Node *n) { this->children[c] = n; }
-
-bool Node::contains_key(char c) const { return this->children.find(c) != this->children.end(); }
-
-void Node::set_end(bool e) { this->end = e; }
-
-void Node::set_weight(double w) { this->weight = w; }
-
-/* Inserts the word-weight pair into the trie beneath this node, returning whether or not the word was already present. */
-bool Node::insert(const string word, double weight) {
-	/* First, update max weight. */
-	if (weight > Node::get_max_weight(this)) {
-		Node::set_max_weight(this, weight);
-	}
-
-
-	/* Base case. */
-	if (word.length() == 1) {
-		if (this->contains_key(word[0])) { // If node already exists, just update weight
-			if (!this->get_child(word[0])->is_end()) {
-				this->get_child(word[0])->set_end(true);
-			}
-			
-			if (weight != this->get_child(word[0])->get_weight()) {
-				this->get_child(word[0])->set_weight(weight);
-			} else {
-				return false; // Word-weight pair already exists
-			}
-		} else { // Word not found, so insert
-			Node *n = new Node(true, weight);
-			this->set_child(word[0], n);
-		}
-
-		/* Update max weight of terminal node. */
-		Node::set_max_weight(this->get_child(word[0]), weight);
-		return true;
-	}
-
-	/* If necessary, create a new node with the first character of the word, and recursively insert. */
-	if (!this->contains_key(word[0])) {
-		Node *n = new Node(false);
-		bool ret = n->insert(word.substr(1), weight);
-		this->set_child(word[0], n);
-
-		return ret;
-	} else {
-		return this->get_child(word[0])->insert(word.substr(1), weight);
-	}
-}
-
-/* Returns if the word exists below this node. */
-bool Node::contains(const string word) { return this->get_weight(word) != -1; }
-
-/* Removes the word from beneath this node, returning if the word existed or not. */
-bool Node::remove(const string word) {
-	/* Base case. */
-	if (word.length() == 1) {
-		if (!this->contains_key(word[0])) {
-			return false;
-		}
-
-		/* Remove the node if it has no children; otherwise, simply set its 'end' flag to false. */
-		if (this->get_child(word[0])->num_children() == 0) {
-			delete this->get_child(word[0]);
-			this->children.erase(word[0]);
-			
-			/* Update max weights. */
-			if (this->num_children() == 0) {
-				if (this->is_end()) {
-					// If this node marks the end of a word, set its max weight to its own weight since it has no children
-					Node::set_max_weight(this, this->get_weight());
-				} else { // Otherwise, this node will be deleted in the parent frame, so remove from max weights
-					Node::remove_max_weight(this);
-				}
-			} else { // Set the max weight of this node to the maximum max weight of the children
-				double best = - numeric_limits<double>::infinity();
-				double temp;
-				for (auto const &it : this->children) {
-					temp = Node::get_max_weight(it.second);
-					if (temp > best) {
-						best = temp;
-					}
-				}
-
-				Node::set_max_weight(this, temp);
-			}
-		} else {
-			this->get_child(word[0])->set_end(false);
-			Node::remove_max_weight(this->get_child(word[0]));
-		}
-
-		return true;
-	}
-
-	/* Recursively remove from child, if word exists. */
-	if (!this->contains_key(word[0])) {
-		return false;
-	}
-
-	bool ret = this->get_child(word[0])->remove(word.substr(1));
-
-	/* If recursively removing the word from the child left the child an orphan, delete the child. */
-	if (!this->get_child(word[0])->is_end() && this->get_child(word[0])->num_children() == 0) {
-		Node::remove_max_weight(this->get_child(word[0]));
-		this->children.erase(word[0]);
-	}
-
-	/* Update max weights. */
-	if (this->num_children() == 0) {
-		if (this->is_end()) {
-			Node::set_max_weight(this, this->get_weight());
-		} else {
-			Node::remove_max_weight(this); // Node will be removed at parent frame anyways
-			delete this->get_child(word[0]);
-		}
-	} else {
-		double best = - numeric_limits<double>::infinity();
-		double temp;
-		for (auto const &it : this->children) {
-			temp = Node::get_max_weight(it.second);
-			if (temp > best) {
-				best = temp;
-			}
-		}
-
-		Node::set_max_weight(this, best);
-	}
-
-	return ret;
-}
-
-/* Returns the weight associated with the word in the trie beneath this node, or -1 if the word doesn't exist. */
-double Node::get_weight(const string word) const {
-	/* Base case. */
-	if (word.length() == 1) {
-		return this->get_child(word[0])->get_weight();
-	}
-
-	/* Recursively search the child. */
-	if (this->contains_key(word[0])) {
-		return this->get_child(word[0])->get_weight(word.substr(1));
-	} else {
-		return -1;
-	}
-}
-
-/* Given a weight update function, updates the weight of the given word in the trie beneath this node. */
-void Node::update_weight(const string word, double (*update_function)(double)) {
-	/* Base case. */
-	if (word.length() == 1) {
-		double old_weight = this->get_child(word[0])->get_weight();
-		this->get_child(word[0])->set_weight(update_function(old_weight));
-	} else {
-		this->get_child(word[0])->update_weight(word.substr(1), update_function);
-	}
-}
-
-Node Node::operator =(const Node &n) {
-	if (this != &n) { // Guard against self assignment.
-		this->end = n.is_end();
-		this->weight = n.get_weight();
-		this->children = n.get_children();
-	}
-
-	return *this;
-}
-
-Node::~Node(void) { this->children.~map(); }
-
-/* End Node class. */
-
-ostream& operator <<(ostream &stream, const Node &n) {
-	stream << "Node\n";
-	
-	stream << "\tEnd of word: ";
-	if (n.is_end()) {
-		stream << "Yes\n";
-		stream << "\tWeight: " << n.get_weight();
-	} else {
-		stream << "No\n";
-	}
-
-	if (n.num_children()) {
-		stream << "\tChildren:\n";
-		for (auto it : n.get_children()) {
-			stream << "\t\t" << it.first << "\n";
-		}		
-	}
-
-	return stream;
-}
-
-/* Begin Trie class. */
-
-Trie::Trie(void) { this->root = Node(false); }
-
-bool Trie::insert(const string word) { return this->root.insert(word, 0); }
-
-bool Trie::insert(const string word, double weight) { return this->root.insert(word, weight); }
-
-int Trie::levenschtein_distance(string s, string t) {
-	int dist[s.length() + 1][t.length() + 1];
-	for (int i = 0; i < s.length() + 1; ++i) {
-		dist[i][0] = i;
-	}
-	for (int j = 0; j < t.length() + 1; ++j) {
-		dist[0][j] = j;
-	}
-
-	int increment_weight, delete_cost, substitute_cost;
-	for (int i = 1; i < s.length() + 1; ++i) {
-		for (int j = 1; j < t.length() + 1; ++j) {
-			increment_weight = dist[i - 1][j] + 1;
-			delete_cost = dist[i][j - 1] + 1;
-			substitute_cost = dist[i - 1][j - 1] + ((s[i - 1] == t[j - 1]) ? 0 : 1);
-
-			dist[i][j] = min(min(increment_weight, delete_cost), substitute_cost);
-		}
-	}
-
-	return dist[s.length()][t.length()];
-}
-
-/* Inserts words from a given file into this trie. Uses given weights if the boolean flag is true.
- * Expected format: First line contains number of words, then one word per line. If weights are 
- * included, weight of word expected on same line as word, separated by whitespace. */
-void Trie::insert_from_file(const string filepath, bool has_weights /* = false */, const char *delims /* = " \n\t" */) {
-	ifstream dict (filepath);
-	string line; // Current line of file
-	char *word, *weight_str; // Parsed word and weight
-	double weight = 0.0;
-
-	getline(dict, line); // Skip first line which contains number of words
-	while (getline(dict, line)) {
-		word = strtok((char *) line.c_str(), delims);
-
-		if (has_weights) { // Retrieve the weight
-			weight_str = strtok(NULL, delims);
-			weight = atoi(weight_str);
-		}
-
-		this->insert(word, weight);
-	}
-
-	dict.close();
-}
-
-void Trie::insert_from_raw_text(const string filepath) {
-	ifstream words (filepath);
-	string line; // Current line of file
-	char *word, *weight_str; // Parsed word and weight
-	double weight = 0.0;
-
-	while (getline(words, line)) {
-		word = strtok((char *) line.c_str(),  "\n\t");
-
-		while (word != NULL) {
-			if (this->contains(word)) {
-				this->root.update_weight(word, increment_weight);
-			} else {
-				this->insert(word, 0.0);
-			}
-			word = strtok(NULL,  "\n\t");
-		}
-	}
-
-	words.close();
-}
-
-double Trie::increment_weight(double weight) { return weight + 1; }
-
-bool Trie::contains(const string word) { return this->root.contains(word); }
-
-bool Trie::remove(const string word) { return this->root.remove(word); }
-
-double Trie::get_weight(const string word) { return this->root.get_weight(word); }
-
-/* Returns the top k matches, ordered by weight, in this Trie which complete the given prefix. */
-vector<string> Trie::autocomplete(const string prefix, int k) {
-	/* First, iterate down to the node at the end of prefix. */
-	Node *initial = &(this->root);
-	for (int i = 0; i < prefix.length(); ++i) {
-		initial = initial->get_child(prefix[i]);
-	}
-
-	/* Initialize priority queue which orders nodes by maximum weight below a given node, for use in modified Dijkstra's 
-	 * algorithm below. */
-	class NodeComparator {
-		public:
-			bool operator () (Node *n1, Node *n2) { return Node::get_max_weight(n1) < Node::get_max_weight(n2); }		
-	};
-	priority_queue<Node *, vector<Node *>, NodeComparator> queue;
-	map<Node *, string> words;
-	vector<string> ret;
-
-	/* Main loop of the algorithm - at each iteration, pop the node with the highest maximum weight from the priority queue,
-	 * and push the node's children to the priority queue. If the node is the end of a word and its max weight matches its
-	 * own weight, add it to ret. */
-	Node *curr;
-	words[initial] = prefix;
-	queue.push(initial);
-	while (!queue.empty() && ret.size() < k) {
-		// Pop the highest-max-weight element
-		curr = queue.top();
-		queue.pop();
-
-		// If appropriate add to ret
-		if (curr->is_end() && Node::get_max_weight(curr) == curr->get_weight()) {
-			ret.push_back(words[curr]);
-		}
-
-		// Add children to queue
-		for (auto const &it : curr->get_children()) {
-			words[it.second] = words[curr] + it.first;
-			queue.push(it.second);
-		}
-	}
-
-	return ret;
-}
-
-/* Returns the top k matches, ordered by a combination of Levenshtein distance and word weight, which autocorrect the 
- * given word. */
-vector<string> Trie::autocorrect(const string word, int max_distance) {
-	int first_row[word.length() + 1];
-	for (int i = 0; i < word.length() + 1; ++i) {
-		first_row[i] = i;
-	}
-
-	vector<tuple<string, double, int>> suggestions;
-	for (const auto &it : this->root.get_children()) {
-		this->autocorrect_helper(&suggestions, word, it.second, "", it.first, first_row, max_distance);
-	}
-
-	// No need to free first_row; autocorrect_helper will free it
-	return rank_suggestions(word, suggestions);
-}
-
-/* Private helper function. Given a node and the key the parent maps to the node, uses the previous row of
-   the Levenshtein distance dynamic programming algorithm's table to build the current row in order tostore all
-   the words in the trie whose Levensthein distance to the given (possibly misspelled) word which are within the
-   specified threshold. */
-void Trie::autocorrect_helper(vector<tuple<string, double, int>> *v, string word, Node *n, string curr_word, char letter, int *prev_row, int max_distance) {
-	int num_columns = word.length() + 1;
-	int *curr_row = new int[num_columns]; // Allocate to heap since recursion depth may be very large
-
-	/* Build the next row of the Levenshtein distance table. The DP algorithm is based on the recurrence relation
-	 *     L(i, j) = min(L(i - 1, j) + 1, L(i, j - 1) + 1, L(i - 1, j - 1) + I(s[i - 1] == t[j - 1]))
-	 * where, given strings s, t, L(i, j) = Levenshtein distance between substrings s[0 : i], t[0 : j] and 
-	 * I(a == b) := 0 if (a == b) and 1 if not. */
-	curr_row[0] = prev_row[0] + 1;
-	int min_dist = curr_row[0];
-	int insert_cost, delete_cost, substitute_cost;
-	for (int i = 1; i < num_columns; ++i) {
-		insert_cost = curr_row[i - 1] + 1;
-		delete_cost = prev_row[i] + 1;
-		substitute_cost = prev_row[i - 1] + (word[i - 1] == letter ? 0 : 1);
-
-		curr_row[i] = min(min(insert_cost, delete_cost), substitute_cost);
-
-		if (curr_row[i] < min_dist) {
-			min_dist = curr_row[i];
-		}
-	}
-
-	 /* If the current node is the end of a word, and its Levensthein distance is within the threshold, add it. */
-	if (n->is_end() && curr_row[num_columns - 1] <= max_distance) {
-		v->push_back(make_tuple(curr_word + letter, n->get_weight(), curr_row[num_columns - 1]));
-	}
-
-	/* If there are nodes below this node with distance within the threshold, recursively add them. */
-	if (min_dist <= max_distance) {
-		for (const auto &it : n->get_children()) {
-			autocorrect_helper(v, word, it.second, curr_word + letter, it.first, curr_row, max_distance);
-		}
-	}
-
-	delete[] curr_row;
-}
-
-/* Ranks first by distances, then by weights. */
-vector<string> Trie::rank_suggestions(string word, vector<tuple<string, double, int>> suggestions) {
-	// First sort by Levenshtein distance, then by weight.
-	map<int, map<double, vector<string>>> m;
-
-	string suggestion;
-	double weight;
-	int dist;
-	for (tuple<string, double, int> t : suggestions) {
-		suggestion = get<0>(t);
-		weight = get<1>(t);
-		dist = get<2>(t);
-
-		/* If m doesn't contain the key dist, initialize. */
-		if (m.find(dist) == m.end()) {
-			m[dist] = map<double, vector<string>>();
-		}
-
-		/* If m[dist] doesn't contain the key weight, initialize. */
-		if (m[dist].find(weight) == m[dist].end()) {
-			m[dist][weight] = vector<string>();			
-		}
-
-		m[dist][weight].push_back(suggestion);
-	}
-
-	vector<string> ret;
-	for (map<int, map<double, vector<string>>>::iterator it1 = m.begin(); it1 != m.end(); ++it1) {
-		for (map<double, vector<string>>::iterator it2 = it1->second.begin(); it2 != it1->second.end(); ++it2) {
-			for (string s : it2->second) {
-				ret.push_back(s);				
-			}
-		}
-	}
-
-	return ret;
-}
-
-/* End Trie class. */
\ No newline at end of file
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <map>
+#include <limits>
+#include <sstream>
+#include <exception>
+#include <queue>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <cmath>
+#include <stdexcept>
+#include "trie.h"
+#include "tokenizer.h"
+#include "instrumentation.h"
+
+/* Begin Node class. */
+
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight>::BasicNode(void) : weight(no_weight), max_weight(), end(false), has_max_weight(false) {}
+
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight>::BasicNode(bool e) : weight(no_weight), max_weight(), end(e), has_max_weight(false) {}
+
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight>::BasicNode(bool e, Weight w) : weight(w), max_weight(), end(e), has_max_weight(false) {}
+
+/* Copies the whole subtrie below n, so that the copy shares no nodes with it. */
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight>::BasicNode(const BasicNode &n) : weight(n.weight), max_weight(n.max_weight), end(n.end),
+	has_max_weight(n.has_max_weight) {
+	n.for_each_child([this](char c, BasicNode *child) { this->children.set(c, new BasicNode(*child)); });
+}
+
+/* Static function. Returns the maximum weight at or below the node, or -infinity if there are no words there. */
+template <class Alphabet, class Weight>
+double BasicNode<Alphabet, Weight>::get_max_weight(const BasicNode *n) {
+	return n->has_max_weight ? (double) n->max_weight : - numeric_limits<double>::infinity();
+}
+
+/* Static function. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::set_max_weight(BasicNode *n, double w) {
+	n->max_weight = (Weight) w;
+	n->has_max_weight = true;
+}
+
+/* Static function. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::remove_max_weight(BasicNode *n) { n->has_max_weight = false; }
+
+template <class Alphabet, class Weight>
+bool BasicNode<Alphabet, Weight>::is_end(void) const { return this->end; }
+
+template <class Alphabet, class Weight>
+Weight BasicNode<Alphabet, Weight>::get_weight(void) const { return this->weight; }
+
+template <class Alphabet, class Weight>
+int BasicNode<Alphabet, Weight>::num_children(void) const { return this->children.size(); }
+
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight> * BasicNode<Alphabet, Weight>::get_child(char c) const {
+	BasicNode *child = this->children.get(c);
+	if (child == NULL) {
+		stringstream error_message;
+		error_message << "Node with key '" << c << "' not found";
+		throw runtime_error(error_message.str());
+	}
+
+	return child;
+}
+
+template <class Alphabet, class Weight>
+map<char, BasicNode<Alphabet, Weight> *> BasicNode<Alphabet, Weight>::get_children(void) const {
+	map<char, BasicNode *> ret;
+	this->for_each_child([&ret](char c, BasicNode *child) { ret[c] = child; });
+	return ret;
+}
+
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::set_child(char c, BasicNode *n) { this->children.set(c, n); }
+
+template <class Alphabet, class Weight>
+bool BasicNode<Alphabet, Weight>::contains_key(char c) const { return this->children.get(c) != NULL; }
+
+/* Returns an estimate of the heap bytes this node's children container takes, besides the children themselves. */
+template <class Alphabet, class Weight>
+size_t BasicNode<Alphabet, Weight>::heap_bytes(void) const { return this->children.heap_bytes(); }
+
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::set_end(bool e) { this->end = e; }
+
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::set_weight(Weight w) { this->weight = w; }
+
+/* Inserts the word-weight pair into the trie beneath this node, or reweights the word if it's already there, returning
+ * false only if the word was already there with this weight. Throws if the word has characters outside the alphabet. */
+template <class Alphabet, class Weight>
+bool BasicNode<Alphabet, Weight>::insert(const string word, Weight weight) {
+	if (word.empty()) {
+		return false;
+	}
+	for (char c : word) {
+		if (Alphabet::index(c) < 0) {
+			throw runtime_error("Word '" + word + "' has characters outside the trie's alphabet");
+		}
+	}
+
+	const BasicNode *n = this->find(word);
+	return this->place(word, weight, n == NULL || weight >= n->get_weight());
+}
+
+/* Private helper function. Inserts or reweights the word beneath this node, then brings the maximum weights along its
+ * path up to date: raised to the weight in one step per node if no weight on the path shrank, or recomputed from the
+ * children otherwise. */
+template <class Alphabet, class Weight>
+bool BasicNode<Alphabet, Weight>::place(const string word, Weight weight, bool grew) {
+	BasicNode *child = this->children.get(word[0]);
+	if (child == NULL) {
+		child = new BasicNode(false);
+		this->set_child(word[0], child);
+	}
+
+	bool ret;
+	if (word.length() == 1) {
+		ret = !child->is_end() || child->get_weight() != weight;
+		child->set_end(true);
+		child->set_weight(weight);
+		child->refresh_max_weight(weight, grew);
+	} else {
+		ret = child->place(word.substr(1), weight, grew);
+	}
+
+	this->refresh_max_weight(weight, grew);
+	return ret;
+}
+
+/* Private helper function. Brings this node's max weight up to date after a word below it took the given weight. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::refresh_max_weight(Weight weight, bool grew) {
+	if (!grew) {
+		this->update_max_weight();
+	} else if (!this->has_max_weight || weight > this->max_weight) {
+		this->max_weight = weight;
+		this->has_max_weight = true;
+	}
+}
+
+/* Returns if the word exists below this node. */
+template <class Alphabet, class Weight>
+bool BasicNode<Alphabet, Weight>::contains(const string word) const { return this->find(word) != NULL; }
+
+/* Removes the word from beneath this node, returning if the word existed or not. Nodes left leading to no word are
+ * deleted on the way back up, and maximum weights are recomputed along the word's path. */
+template <class Alphabet, class Weight>
+bool BasicNode<Alphabet, Weight>::remove(const string word) {
+	BasicNode *child = word.empty() ? NULL : this->children.get(word[0]);
+	if (child == NULL) {
+		return false;
+	}
+
+	if (word.length() == 1) {
+		if (!child->is_end()) {
+			return false;
+		}
+
+		child->set_end(false);
+		child->set_weight(no_weight);
+		child->update_max_weight();
+	} else if (!child->remove(word.substr(1))) {
+		return false;
+	}
+
+	/* If removing the word left the child an orphan, delete the child. */
+	if (!child->is_end() && child->num_children() == 0) {
+		this->children.erase(word[0]);
+		delete child;
+	}
+
+	this->update_max_weight();
+	return true;
+}
+
+/* Private helper function. Sets this node's max weight to the maximum of its own weight, if it ends a word, and its
+ * children's max weights, or forgets it if there are no words at or below this node. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::update_max_weight(void) {
+	this->has_max_weight = this->is_end();
+	this->max_weight = this->is_end() ? this->get_weight() : Weight();
+	this->for_each_child([this](char, BasicNode *child) {
+		if (child->has_max_weight && (!this->has_max_weight || child->max_weight > this->max_weight)) {
+			this->max_weight = child->max_weight;
+			this->has_max_weight = true;
+		}
+	});
+}
+
+/* Returns the weight associated with the word in the trie beneath this node, or -1 if the word doesn't exist. */
+template <class Alphabet, class Weight>
+double BasicNode<Alphabet, Weight>::get_weight(const string word) const {
+	const BasicNode *n = this->find(word);
+	return n != NULL ? (double) n->get_weight() : -1;
+}
+
+/* Private helper function. Returns the node ending the given nonempty word beneath this node, or NULL if the word isn't
+ * there. Walks down without get_child, which throws for a missing key, as most lookups of absent words would. */
+template <class Alphabet, class Weight>
+const BasicNode<Alphabet, Weight> * BasicNode<Alphabet, Weight>::find(const string word) const {
+	const BasicNode *n = this;
+	for (size_t i = 0; i < word.length() && n != NULL; ++i) {
+		n = n->children.get(word[i]);
+	}
+
+	return n != NULL && n != this && n->is_end() ? n : NULL;
+}
+
+/* Sets the weight of the given word in the trie beneath this node, throwing if the word isn't there. Costs O(length) if
+ * the weight grows, as counts do. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::set_weight(const string word, Weight weight) {
+	const BasicNode *n = this->find(word);
+	if (n == NULL) {
+		throw runtime_error("Word '" + word + "' not found");
+	}
+
+	this->place(word, weight, weight >= n->get_weight());
+}
+
+/* Given a weight update function, updates the weight of the given word in the trie beneath this node. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::update_weight(const string word, Weight (*update_function)(Weight)) {
+	const BasicNode *n = this->find(word);
+	if (n == NULL) {
+		throw runtime_error("Word '" + word + "' not found");
+	}
+
+	this->set_weight(word, update_function(n->get_weight()));
+}
+
+/* Replaces this node's subtrie with a copy of n's, deleting the old one. */
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight> & BasicNode<Alphabet, Weight>::operator =(const BasicNode &n) {
+	if (this != &n) { // Guard against self assignment.
+		BasicNode copy (n);
+		this->end = copy.end;
+		this->weight = copy.weight;
+		this->max_weight = copy.max_weight;
+		this->has_max_weight = copy.has_max_weight;
+		this->children.swap(copy.children); // The copy takes the old children with it when destroyed
+	}
+
+	return *this;
+}
+
+/* Exchanges the contents of this node, its subtrie included, with those of n, without copying either. */
+template <class Alphabet, class Weight>
+void BasicNode<Alphabet, Weight>::swap(BasicNode &n) {
+	std::swap(this->weight, n.weight);
+	std::swap(this->max_weight, n.max_weight);
+	std::swap(this->end, n.end);
+	std::swap(this->has_max_weight, n.has_max_weight);
+	this->children.swap(n.children);
+}
+
+/* Deletes the subtrie below this node, which owns its children. */
+template <class Alphabet, class Weight>
+BasicNode<Alphabet, Weight>::~BasicNode(void) {
+	this->for_each_child([](char, BasicNode *child) { delete child; });
+}
+
+/* End Node class. */
+
+template <class Alphabet, class Weight>
+ostream& operator <<(ostream &stream, const BasicNode<Alphabet, Weight> &n) {
+	stream << "Node\n";
+	
+	stream << "\tEnd of word: ";
+	if (n.is_end()) {
+		stream << "Yes\n";
+		stream << "\tWeight: " << n.get_weight();
+	} else {
+		stream << "No\n";
+	}
+
+	if (n.num_children()) {
+		stream << "\tChildren:\n";
+		for (auto it : n.get_children()) {
+			stream << "\t\t" << it.first << "\n";
+		}		
+	}
+
+	return stream;
+}
+
+/* Begin Trie class. */
+
+template <class Alphabet, class Weight>
+BasicTrie<Alphabet, Weight>::BasicTrie(void) : decay_rate(0), now(0), epoch(0) { this->root = Node(false); }
+
+/* Copies the words, the decay state and any deletion index or membership filter, so that the copy shares nothing with t. */
+template <class Alphabet, class Weight>
+BasicTrie<Alphabet, Weight>::BasicTrie(const BasicTrie &t) :
+	deletion_index(t.deletion_index ? new DeletionIndex(*t.deletion_index) : NULL),
+	membership_filter(t.membership_filter ? new CountingBloomFilter(*t.membership_filter) : NULL),
+	decay_rate(t.decay_rate), now(t.now), epoch(t.epoch), root(t.root) {}
+
+template <class Alphabet, class Weight>
+bool BasicTrie<Alphabet, Weight>::insert(const string word) { return this->insert(word, 0); }
+
+template <class Alphabet, class Weight>
+bool BasicTrie<Alphabet, Weight>::insert(const string word, double weight) {
+	if (word.empty()) { // Never stored, so kept out of the index and filter too
+		return false;
+	}
+	if (this->decay_rate != 0) {
+		if (weight < 0) {
+			throw runtime_error("Decaying weights can't be negative");
+		}
+		weight = log(weight) + this->decay_offset(); // -infinity for a word inserted without a weight
+	}
+
+	/* Insert into the trie first, since it rejects words outside the alphabet and weights out of range, and only then
+	 * index the word. */
+	bool is_new = this->membership_filter && !this->root.contains(word);
+	bool ret = this->root.insert(word, to_weight(weight));
+	if (this->deletion_index) {
+		this->deletion_index->insert(word);
+	}
+	if (is_new) {
+		this->membership_filter->add(word);
+	}
+
+	return ret;
+}
+
+/* Private helper function. Returns the words in this trie. */
+template <class Alphabet, class Weight>
+vector<string> BasicTrie<Alphabet, Weight>::words(void) const {
+	vector<string> ret;
+	vector<pair<const Node *, string>> stack (1, make_pair(&this->root, string()));
+	while (!stack.empty()) {
+		const Node *n = stack.back().first;
+		string prefix = stack.back().second;
+		stack.pop_back();
+
+		if (n->is_end()) {
+			ret.push_back(prefix);
+		}
+		n->for_each_child([&](char c, Node *child) { stack.push_back(make_pair(child, prefix + c)); });
+	}
+
+	return ret;
+}
+
+/* Builds a deletion index of the words in this trie, for autocorrect queries within the given distance, and keeps it in
+ * step with later inserts and removals. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::build_deletion_index(int max_distance /* = 2 */) {
+	this->deletion_index.reset(new DeletionIndex(max_distance));
+	this->deletion_index->build(this->words());
+}
+
+/* Builds a membership filter of the words in this trie, which contains and get_weight consult before walking the trie so
+ * that most absent words are rejected without one, and keeps it in step with later inserts and removals. The filter is
+ * sized for twice the words now in the trie; past that its false positive rate rises, and it should be rebuilt. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::build_membership_filter(double false_positive_rate /* = 0.01 */) {
+	vector<string> words = this->words();
+	this->membership_filter.reset(new CountingBloomFilter(max(2 * words.size(), (size_t) 1024), false_positive_rate));
+	for (const string &word : words) {
+		this->membership_filter->add(word);
+	}
+}
+
+/* Makes the weights of this trie decay, halving every half_life units of the time given to set_time, so that recent
+ * occurrences count for more than old ones. Weights are kept as natural logs relative to an epoch rather than as the
+ * weights themselves: a word recorded at time t gains exp(rate * (t - epoch)), the occurrence's worth scaled up by the
+ * decay since the epoch instead of every other weight being scaled down, so recording touches only the word's path.
+ * Scaling every weight alike keeps their order, so max weights and autocomplete stay correct as time passes, and
+ * get_weight divides the decay back out. The trie must be empty, and weights inserted from then on non-negative; a word
+ * inserted without a weight is stored with a log weight of -infinity until it is recorded. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::enable_decay(double half_life) {
+	if (half_life <= 0) {
+		throw runtime_error("Half life must be positive");
+	}
+	if (this->root.num_children() > 0) {
+		throw runtime_error("Decay must be enabled on an empty trie");
+	}
+	if (!is_floating_point<Weight>::value) {
+		throw runtime_error("Decay needs floating point weights");
+	}
+
+	this->decay_rate = log(2) / half_life;
+	this->epoch = this->now;
+}
+
+/* Advances the time weights decay to. Time never goes back. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::set_time(double time) {
+	if (time < this->now) {
+		throw runtime_error("Time can't go backwards");
+	}
+
+	this->now = time;
+	if (this->decay_offset() > max_decay_offset) {
+		this->renormalize();
+	}
+}
+
+template <class Alphabet, class Weight>
+double BasicTrie<Alphabet, Weight>::get_time(void) const { return this->now; }
+
+/* Private helper function. Returns how much the stored log weights exceed the logs of the current weights. */
+template <class Alphabet, class Weight>
+double BasicTrie<Alphabet, Weight>::decay_offset(void) const { return this->decay_rate * (this->now - this->epoch); }
+
+/* Private helper function. Returns the weight of the word ending at the given node, with any decay divided out. */
+template <class Alphabet, class Weight>
+double BasicTrie<Alphabet, Weight>::weight_of(const Node *n) const {
+	return this->decay_rate != 0 ? exp(n->get_weight() - this->decay_offset()) : n->get_weight();
+}
+
+/* Private helper function. Rebases the stored log weights to the current time, before their offset grows large enough to
+ * cost precision. Subtracting the offset from every weight and max weight keeps their order, so nothing else changes;
+ * the pass is linear in the size of the trie, but happens once every max_decay_offset / decay_rate units of time, about
+ * every 14 years for a half life of a week. It isn't spread over later calls: until the pass ended, nodes would hold
+ * weights relative to two epochs, and comparing them would need an epoch stored in every node. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::renormalize(void) {
+	double offset = this->decay_offset();
+	vector<Node *> stack (1, &this->root);
+	while (!stack.empty()) {
+		Node *n = stack.back();
+		stack.pop_back();
+
+		if (n->is_end()) {
+			n->set_weight((Weight) (n->get_weight() - offset));
+		}
+		double max_weight = Node::get_max_weight(n);
+		if (max_weight != - numeric_limits<double>::infinity()) {
+			Node::set_max_weight(n, max_weight - offset);
+		}
+		n->for_each_child([&](char, Node *child) { stack.push_back(child); });
+	}
+
+	this->epoch = this->now;
+}
+
+template <class Alphabet, class Weight>
+int BasicTrie<Alphabet, Weight>::levenschtein_distance(string s, string t) {
+	int dist[s.length() + 1][t.length() + 1];
+	for (int i = 0; i < (int) s.length() + 1; ++i) {
+		dist[i][0] = i;
+	}
+	for (int j = 0; j < (int) t.length() + 1; ++j) {
+		dist[0][j] = j;
+	}
+
+	int increment_weight, delete_cost, substitute_cost;
+	for (int i = 1; i < (int) s.length() + 1; ++i) {
+		for (int j = 1; j < (int) t.length() + 1; ++j) {
+			increment_weight = dist[i - 1][j] + 1;
+			delete_cost = dist[i][j - 1] + 1;
+			substitute_cost = dist[i - 1][j - 1] + ((s[i - 1] == t[j - 1]) ? 0 : 1);
+
+			dist[i][j] = min(min(increment_weight, delete_cost), substitute_cost);
+		}
+	}
+
+	return dist[s.length()][t.length()];
+}
+
+/* Inserts words from a given file into this trie. Uses given weights if the boolean flag is true.
+ * Expected format: First line contains number of words, then one word per line. If weights are 
+ * included, weight of word expected on same line as word, separated by whitespace. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::insert_from_file(const string filepath, bool has_weights /* = false */, const char *delims /* = " \n\t" */) {
+	ifstream dict (filepath);
+	Tokenizer tokenizer (delims);
+	string line; // Current line of file
+	string_view word, rest; // Parsed word, and the remainder of the line holding its weight
+	double weight = 0.0;
+
+	getline(dict, line); // Skip first line which contains number of words
+	while (getline(dict, line)) {
+		word = tokenizer.first_token(line, &rest);
+		if (word.empty()) {
+			continue;
+		}
+
+		if (has_weights) { // Retrieve the weight
+			weight = atoi(string(tokenizer.first_token(rest)).c_str());
+		}
+
+		this->insert(string(word), weight);
+	}
+
+	dict.close();
+}
+
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::insert_from_raw_text(const string filepath) {
+	ifstream words (filepath);
+	Tokenizer tokenizer ("\n\t");
+	string line; // Current line of file
+	vector<string_view> tokens; // Parsed words of the current line
+	string word;
+
+	while (getline(words, line)) {
+		tokens.clear();
+		tokenizer.split(line, &tokens);
+
+		for (string_view token : tokens) {
+			word = token;
+			if (this->decay_rate != 0) {
+				this->record(word);
+			} else if (this->contains(word)) {
+				this->root.update_weight(word, increment_weight);
+			} else {
+				this->insert(word, 0.0);
+			}
+		}
+	}
+
+	words.close();
+}
+
+template <class Alphabet, class Weight>
+Weight BasicTrie<Alphabet, Weight>::increment_weight(Weight weight) { return weight + 1; }
+
+/* Private helper function. Converts a weight to the weight type, throwing if the type can't hold it: for an integer type,
+ * one that is negative where the type is unsigned, too large or not a number, and for float, a finite weight beyond its
+ * range. A fractional weight is truncated to an integer type. */
+template <class Alphabet, class Weight>
+Weight BasicTrie<Alphabet, Weight>::to_weight(double weight) {
+	if (is_floating_point<Weight>::value) {
+		if (isfinite(weight) && fabs(weight) > (double) numeric_limits<Weight>::max()) {
+			throw runtime_error("Weight " + to_string(weight) + " is out of range for the trie's weight type");
+		}
+	} else if (!(weight > (double) numeric_limits<Weight>::min() - 1 && weight < (double) numeric_limits<Weight>::max() + 1)) {
+		throw runtime_error("Weight " + to_string(weight) + " is out of range for the trie's weight type");
+	}
+
+	return (Weight) weight;
+}
+
+/* Records amount occurrences of the word at the current time, adding amount to its weight, or inserting it with that
+ * weight if it's new. Costs O(length) whether or not weights decay. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::record(const string word, double amount /* = 1 */) {
+	if (!this->contains(word)) {
+		this->insert(word, amount);
+	} else if (this->decay_rate == 0) {
+		this->root.set_weight(word, to_weight(this->root.get_weight(word) + amount));
+	} else {
+		if (amount <= 0) {
+			throw runtime_error("Decaying weights must be positive");
+		}
+
+		/* Add in the log domain: log(e^a + e^b) = max(a, b) + log(1 + e^-|a - b|). */
+		double a = this->root.get_weight(word), b = log(amount) + this->decay_offset();
+		this->root.set_weight(word, to_weight(max(a, b) + log1p(exp(- fabs(a - b)))));
+	}
+}
+
+template <class Alphabet, class Weight>
+bool BasicTrie<Alphabet, Weight>::contains(const string word) const {
+	if (this->membership_filter && !this->membership_filter->possibly_contains(word)) {
+		return false;
+	}
+
+	return this->root.contains(word);
+}
+
+template <class Alphabet, class Weight>
+bool BasicTrie<Alphabet, Weight>::remove(const string word) {
+	if (!this->root.remove(word)) {
+		return false;
+	}
+
+	if (this->deletion_index) {
+		this->deletion_index->remove(word);
+	}
+	if (this->membership_filter) {
+		this->membership_filter->remove(word);
+	}
+
+	return true;
+}
+
+template <class Alphabet, class Weight>
+double BasicTrie<Alphabet, Weight>::get_weight(const string word) const {
+	if (this->membership_filter && !this->membership_filter->possibly_contains(word)) {
+		return -1;
+	}
+	if (this->decay_rate != 0) {
+		return this->root.contains(word) ? exp(this->root.get_weight(word) - this->decay_offset()) : -1;
+	}
+
+	return this->root.get_weight(word);
+}
+
+/* Returns the top k matches, heaviest first and alphabetically among equals, in this Trie which complete the given
+ * prefix, or none if no word starts with it. */
+template <class Alphabet, class Weight>
+vector<string> BasicTrie<Alphabet, Weight>::autocomplete(const string prefix, int k) const {
+	INSTRUMENT_QUERY(AUTOCOMPLETE_QUERY);
+
+	/* First, iterate down to the node at the end of prefix. */
+	const Node *initial = &(this->root);
+	for (int i = 0; i < (int) prefix.length(); ++i) {
+		if (!initial->contains_key(prefix[i])) {
+			return vector<string>();
+		}
+		initial = initial->get_child(prefix[i]);
+	}
+
+	/* Best-first search over a priority queue holding two kinds of entries: nodes, ranked by the maximum weight below
+	 * them, and words, ranked by their own weight. Popping a node pushes its word, if it ends one, and its children;
+	 * popping a word emits it, since nothing left in the queue leads to a heavier one. Ties go to the alphabetically
+	 * first entry, so equally weighted words come out in alphabetical order. */
+	struct Entry {
+		double priority;
+		string word;
+		const Node *node;
+		bool is_word;
+	};
+	class EntryComparator {
+		public:
+			bool operator () (const Entry &e1, const Entry &e2) {
+				if (e1.priority != e2.priority) {
+					return e1.priority < e2.priority;
+				} else if (e1.word != e2.word) {
+					return e1.word > e2.word;
+				}
+				return !e1.is_word && e2.is_word;
+			}
+	};
+	priority_queue<Entry, vector<Entry>, EntryComparator> queue;
+	vector<string> ret;
+
+	queue.push(Entry {Node::get_max_weight(initial), prefix, initial, false});
+	while (!queue.empty() && (int) ret.size() < k) {
+		Entry curr = queue.top();
+		queue.pop();
+
+		if (curr.is_word) {
+			ret.push_back(curr.word);
+			INSTRUMENT_COUNT(CANDIDATES, 1);
+			continue;
+		}
+
+		INSTRUMENT_COUNT(NODES_VISITED, 1);
+		if (curr.node->is_end()) {
+			queue.push(Entry {(double) curr.node->get_weight(), curr.word, curr.node, true});
+		}
+		curr.node->for_each_child([&](char c, Node *child) {
+			queue.push(Entry {Node::get_max_weight(child), curr.word + c, child, false});
+			INSTRUMENT_COUNT(HEAP_PUSHES, 1);
+			INSTRUMENT_COUNT(ALLOCATIONS, 1);
+			INSTRUMENT_COUNT(ALLOCATED_BYTES, curr.word.length() + 2);
+		});
+	}
+
+	return ret;
+}
+
+/* Returns the words within the given Levenshtein distance of the given word, ordered by distance, then by descending
+ * weight, then alphabetically. The deletion index looks up every string obtained by deleting up to max_distance characters of the word,
+ * sum(C(length, i), i <= max_distance) of them, so AUTOMATIC falls back to the trie walk when that number grows large. */
+template <class Alphabet, class Weight>
+vector<string> BasicTrie<Alphabet, Weight>::autocorrect(const string word, int max_distance, AutocorrectEngine engine /* = AUTOMATIC */) const {
+	INSTRUMENT_QUERY(AUTOCORRECT_QUERY);
+
+	if (engine == AUTOMATIC) {
+		engine = TRIE_WALK;
+		if (this->deletion_index && max_distance <= this->deletion_index->get_max_distance()) {
+			double variants = 0, binomial = 1;
+			for (int i = 0; i <= max_distance; ++i) {
+				variants += binomial;
+				binomial = binomial * ((double) word.length() - i) / (i + 1);
+			}
+			engine = variants <= deletion_index_max_variants ? DELETION_INDEX : TRIE_WALK;
+		}
+	}
+
+	if (engine == DELETION_INDEX) {
+		if (!this->deletion_index) {
+			throw runtime_error("No deletion index has been built");
+		}
+
+		/* Verify the candidates; rank_suggestions puts them in order. */
+		vector<string> candidates = this->deletion_index->candidates(word, max_distance);
+		INSTRUMENT_COUNT(CANDIDATES, candidates.size());
+
+		vector<tuple<string, double, int>> suggestions;
+		for (const string &candidate : candidates) {
+			int distance = levenschtein_distance(word, candidate);
+			INSTRUMENT_COUNT(DP_ROWS, word.length() + 1);
+			if (distance <= max_distance) {
+				suggestions.push_back(make_tuple(candidate, this->get_weight(candidate), distance));
+			}
+		}
+
+		return rank_suggestions(word, suggestions);
+	}
+
+	int first_row[word.length() + 1];
+	for (int i = 0; i < (int) word.length() + 1; ++i) {
+		first_row[i] = i;
+	}
+
+	vector<tuple<string, double, int>> suggestions;
+	this->root.for_each_child([&](char c, Node *child) {
+		this->autocorrect_helper(&suggestions, word, child, "", c, first_row, max_distance);
+	});
+
+	// No need to free first_row; autocorrect_helper will free it
+	return rank_suggestions(word, suggestions);
+}
+
+/* Returns the top k completions of a possibly misspelled prefix, as (completion, distance, weight) tuples: the words
+ * some prefix of which is within max_distance edits of the given prefix, nearest first, then heaviest, then
+ * alphabetically. This is what autocorrecting the prefix and autocompleting each correction gives, without the
+ * duplicates, in one traversal.
+ *
+ * A* search over the trie: each node carries the row of the Levenshtein table of the prefix against the node's path, as
+ * autocorrect_helper builds it, and the prefix distance of the path, the least last entry of any row on it. No word below
+ * a node can be nearer than the lesser of that distance and the least entry of its row, nor heavier than its max weight,
+ * so nodes are ranked by that distance bound and then by max weight, and words by their own distance and weight; a word
+ * popped is nearer or as near and heavier than anything left to find. */
+template <class Alphabet, class Weight>
+vector<tuple<string, int, double>> BasicTrie<Alphabet, Weight>::fuzzy_autocomplete(const string prefix, int max_distance, int k) const {
+	INSTRUMENT_QUERY(FUZZY_AUTOCOMPLETE_QUERY);
+
+	struct Entry {
+		int distance; // Prefix distance of a word, or its bound below a node
+		double weight; // Weight of a word, or max weight below a node
+		string word;
+		const Node *node;
+		bool is_word;
+		int prefix_distance;
+		vector<int> row;
+	};
+	class EntryComparator {
+		public:
+			bool operator () (const Entry &e1, const Entry &e2) {
+				if (e1.distance != e2.distance) {
+					return e1.distance > e2.distance;
+				} else if (e1.weight != e2.weight) {
+					return e1.weight < e2.weight;
+				} else if (e1.word != e2.word) {
+					return e1.word > e2.word;
+				}
+				return !e1.is_word && e2.is_word;
+			}
+	};
+	priority_queue<Entry, vector<Entry>, EntryComparator> queue;
+	vector<tuple<string, int, double>> ret;
+
+	int num_columns = prefix.length() + 1;
+	vector<int> first_row (num_columns);
+	for (int i = 0; i < num_columns; ++i) {
+		first_row[i] = i;
+	}
+	queue.push(Entry {0, Node::get_max_weight(&this->root), "", &this->root, false, (int) prefix.length(), first_row});
+
+	while (!queue.empty() && (int) ret.size() < k) {
+		Entry curr = queue.top();
+		queue.pop();
+
+		if (curr.is_word) {
+			ret.push_back(make_tuple(curr.word, curr.distance, this->weight_of(curr.node)));
+			INSTRUMENT_COUNT(CANDIDATES, 1);
+			continue;
+		}
+
+		INSTRUMENT_COUNT(NODES_VISITED, 1);
+		if (curr.node->is_end() && curr.prefix_distance <= max_distance) {
+			queue.push(Entry {curr.prefix_distance, (double) curr.node->get_weight(), curr.word, curr.node, true, 0, vector<int>()});
+		}
+		curr.node->for_each_child([&](char c, Node *child) {
+			/* Build the child's row as autocorrect_helper does. */
+			vector<int> row (num_columns);
+			row[0] = curr.row[0] + 1;
+			int min_dist = row[0];
+			for (int i = 1; i < num_columns; ++i) {
+				row[i] = min(min(row[i - 1] + 1, curr.row[i] + 1), curr.row[i - 1] + (prefix[i - 1] == c ? 0 : 1));
+				min_dist = min(min_dist, row[i]);
+			}
+			INSTRUMENT_COUNT(DP_ROWS, 1);
+
+			int prefix_distance = min(curr.prefix_distance, row[num_columns - 1]);
+			int bound = min(prefix_distance, min_dist);
+			if (bound <= max_distance) {
+				queue.push(Entry {bound, Node::get_max_weight(child), curr.word + c, child, false, prefix_distance, row});
+				INSTRUMENT_COUNT(HEAP_PUSHES, 1);
+			}
+		});
+	}
+
+	return ret;
+}
+
+/* Private helper function. Given a node and the key the parent maps to the node, uses the previous row of
+   the Levenshtein distance dynamic programming algorithm's table to build the current row in order tostore all
+   the words in the trie whose Levensthein distance to the given (possibly misspelled) word which are within the
+   specified threshold. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::autocorrect_helper(vector<tuple<string, double, int>> *v, string word, Node *n, string curr_word, char letter, int *prev_row, int max_distance) {
+	int num_columns = word.length() + 1;
+	int *curr_row = new int[num_columns]; // Allocate to heap since recursion depth may be very large
+	INSTRUMENT_COUNT(NODES_VISITED, 1);
+	INSTRUMENT_COUNT(DP_ROWS, 1);
+	INSTRUMENT_COUNT(ALLOCATIONS, 1);
+	INSTRUMENT_COUNT(ALLOCATED_BYTES, num_columns * sizeof(int));
+
+	/* Build the next row of the Levenshtein distance table. The DP algorithm is based on the recurrence relation
+	 *     L(i, j) = min(L(i - 1, j) + 1, L(i, j - 1) + 1, L(i - 1, j - 1) + I(s[i - 1] == t[j - 1]))
+	 * where, given strings s, t, L(i, j) = Levenshtein distance between substrings s[0 : i], t[0 : j] and 
+	 * I(a == b) := 0 if (a == b) and 1 if not. */
+	curr_row[0] = prev_row[0] + 1;
+	int min_dist = curr_row[0];
+	int insert_cost, delete_cost, substitute_cost;
+	for (int i = 1; i < num_columns; ++i) {
+		insert_cost = curr_row[i - 1] + 1;
+		delete_cost = prev_row[i] + 1;
+		substitute_cost = prev_row[i - 1] + (word[i - 1] == letter ? 0 : 1);
+
+		curr_row[i] = min(min(insert_cost, delete_cost), substitute_cost);
+
+		if (curr_row[i] < min_dist) {
+			min_dist = curr_row[i];
+		}
+	}
+
+	 /* If the current node is the end of a word, and its Levensthein distance is within the threshold, add it. */
+	if (n->is_end() && curr_row[num_columns - 1] <= max_distance) {
+		v->push_back(make_tuple(curr_word + letter, n->get_weight(), curr_row[num_columns - 1]));
+		INSTRUMENT_COUNT(CANDIDATES, 1);
+	}
+
+	/* If there are nodes below this node with distance within the threshold, recursively add them. */
+	if (min_dist <= max_distance) {
+		n->for_each_child([&](char c, Node *child) {
+			autocorrect_helper(v, word, child, curr_word + letter, c, curr_row, max_distance);
+		});
+	}
+
+	delete[] curr_row;
+}
+
+/* Ranks first by distance, then by descending weight, then alphabetically: the order every engine's autocorrect
+ * returns. */
+template <class Alphabet, class Weight>
+vector<string> BasicTrie<Alphabet, Weight>::rank_suggestions(string, vector<tuple<string, double, int>> suggestions) {
+	sort(suggestions.begin(), suggestions.end(), [](const tuple<string, double, int> &a, const tuple<string, double, int> &b) {
+		if (get<2>(a) != get<2>(b)) {
+			return get<2>(a) < get<2>(b);
+		} else if (get<1>(a) != get<1>(b)) {
+			return get<1>(a) > get<1>(b);
+		}
+		return get<0>(a) < get<0>(b);
+	});
+
+	vector<string> ret;
+	for (const tuple<string, double, int> &suggestion : suggestions) {
+		ret.push_back(get<0>(suggestion));
+	}
+
+	return ret;
+}
+
+/* Appends this trie's words, with their weights as stored, and its decay state to a model payload. Words are written in
+ * alphabetical order, each as a uint32 length, its bytes and a float64 weight, after the decay rate, time and epoch as
+ * float64s and the number of words as a uint64. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::write(ModelWriter *writer) const {
+	vector<string> words = this->words();
+	sort(words.begin(), words.end());
+
+	writer->write(this->decay_rate);
+	writer->write(this->now);
+	writer->write(this->epoch);
+	writer->write((uint64_t) words.size());
+	for (const string &word : words) {
+		writer->write((uint32_t) word.length());
+		writer->write_array(word.data(), word.length());
+		writer->write(this->root.get_weight(word));
+	}
+}
+
+/* Replaces this trie's words and decay state with those read from a model payload, as written by write. Any deletion
+ * index or membership filter is rebuilt. The trie is left unchanged if the payload is malformed. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::read(ModelReader *reader) {
+	double decay_rate = reader->read<double>(), now = reader->read<double>(), epoch = reader->read<double>();
+	uint64_t num_words = reader->read<uint64_t>();
+	if (decay_rate < 0 || epoch > now || num_words > reader->remaining() / (sizeof(uint32_t) + sizeof(double))) {
+		throw runtime_error("Malformed trie in model");
+	}
+
+	vector<pair<string, double>> words (num_words);
+	for (pair<string, double> &word : words) {
+		uint32_t length = reader->read<uint32_t>();
+		word.first.assign(reader->read_bytes(length), length);
+		word.second = reader->read<double>();
+		if (word.first.empty()) {
+			throw runtime_error("Malformed trie in model");
+		}
+	}
+
+	/* Build into a separate root, since a word outside the alphabet throws, and only then replace this trie's. */
+	Node root (false);
+	for (const pair<string, double> &word : words) {
+		root.insert(word.first, to_weight(word.second));
+	}
+	this->root.swap(root);
+	this->decay_rate = decay_rate;
+	this->now = now;
+	this->epoch = epoch;
+
+	if (this->deletion_index) {
+		this->build_deletion_index(this->deletion_index->get_max_distance());
+	}
+	if (this->membership_filter) {
+		this->build_membership_filter();
+	}
+}
+
+/* Writes this trie to a model file. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::save(const string filepath) const {
+	ModelWriter writer (TRIE_MODEL);
+	this->write(&writer);
+	writer.save(filepath);
+}
+
+/* Replaces this trie's contents with those of the given model file, as written by save. The trie is left unchanged if
+ * the file can't be loaded. */
+template <class Alphabet, class Weight>
+void BasicTrie<Alphabet, Weight>::load(const string filepath) {
+	ModelReader reader (filepath, TRIE_MODEL);
+	this->read(&reader);
+}
+
+template <class Alphabet, class Weight>
+BasicTrie<Alphabet, Weight> & BasicTrie<Alphabet, Weight>::operator =(const BasicTrie &t) {
+	if (this != &t) { // Guard against self assignment.
+		this->root = t.root;
+		this->deletion_index.reset(t.deletion_index ? new DeletionIndex(*t.deletion_index) : NULL);
+		this->membership_filter.reset(t.membership_filter ? new CountingBloomFilter(*t.membership_filter) : NULL);
+		this->decay_rate = t.decay_rate;
+		this->now = t.now;
+		this->epoch = t.epoch;
+	}
+
+	return *this;
+}
+
+/* End Trie class. */
+
+template class BasicNode<ByteAlphabet, double>;
+template class BasicTrie<ByteAlphabet, double>;
+template ostream& operator <<(ostream &, const BasicNode<ByteAlphabet, double> &);
+template class BasicNode<AsciiAlphabet, double>;
+template class BasicTrie<AsciiAlphabet, double>;
+template class BasicNode<LowercaseAlphabet, double>;
+template class BasicTrie<LowercaseAlphabet, double>;
+template class BasicNode<LowercaseAlphabet, float>;
+template class BasicTrie<LowercaseAlphabet, float>;
+template class BasicNode<LowercaseAlphabet, uint32_t>;
+template class BasicTrie<LowercaseAlphabet, uint32_t>;
\ No newline at end of file
@@ -1,119 +1,218 @@
-#ifndef TRIE_H
-#define TRIE_H
-
-#include <string>
-#include <map>
-#include <vector>
-#include <tuple>
-#include <utility>
-
-using namespace std;
-
-class Node {
-	private:
-		bool end;
-		double weight;
-		map<char, Node *> children;
-
-		static map<Node *, double> max_weights; // Stores the maximum weight below a node, for each node
-
-	public:
-		// Static functions
-
-		static double get_max_weight(Node *);
-
-		static void set_max_weight(Node *, double);
-
-		static void remove_max_weight(Node *);
-
-		// Constructors
-
-		Node(void);
-
-		Node(bool);
-
-		Node(bool, double);
-
-		Node(const Node &);
-
-		// Getters
-
-		bool is_end(void) const;
-
-		/* Getter function to retrieve weight at a node. */
-		double get_weight(void) const;
-
-		int num_children(void) const;
-
-		Node * get_child(char) const;
-
-		map<char, Node *> get_children(void) const;
-
-		bool contains_key(char) const;
-
-		// Setters
-
-		void set_child(char, Node *);
-
-		void set_end(bool);
-
-		void set_weight(double);
-
-		// Functionality
-
-		bool insert(const string word, double);
-
-		bool contains(const string word);
-
-		bool remove(const string word);
-
-		/* Function to recursively get weight in trie below this node. */
-		double get_weight(const string word) const;
-
-		void update_weight(const string, double (*)(double));
-
-		// Other
-
-		Node operator =(const Node &);
-
-		~Node(void);
-};
-
-ostream& operator <<(ostream &, const Node &);
-
-class Trie {
-	private:
-		static int levenschtein_distance(string, string);
-
-		static void autocorrect_helper(vector<tuple<string, double, int>> *, string, Node *, string, char, int *, int);
-
-		static vector<string> rank_suggestions(const string, vector<tuple<string, double, int>>);
-
-		static vector<string> rank_suggestions_by_keyboard_proximity(const string, vector<string>);
-
-		static double increment_weight(double);
-
-	public:
-		Node root; // Top of trie.
-		Trie(void);
-
-		bool insert(const string);
-
-		bool insert(const string, double);
-
-		void insert_from_file(const string, bool = false, const char * = " \n\t");
-
-		void insert_from_raw_text(const string);
-
-		bool contains(const string);
-
-		bool remove(const string);
-
-		double get_weight(const string);
-
-		vector<string> autocomplete(const string, int);
-
-		vector<string> autocorrect(const string, int);
-};
-
+#ifndef TRIE_H
+#define TRIE_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <memory>
+#include <type_traits>
+#include "trie_alphabet.h"
+#include "deletion_index.h"
+#include "bloom_filter.h"
+#include "model_file.h"
+
+using namespace std;
+
+/* A trie node over the given alphabet policy (see trie_alphabet.h), holding weights of the given type. Nodes over small
+ * alphabets find their children by direct index, and every node keeps the maximum weight at or below it alongside its
+ * own weight. */
+template <class Alphabet = ByteAlphabet, class Weight = double>
+class BasicNode {
+	private:
+		ChildrenFor<Alphabet, BasicNode> children;
+		Weight weight;
+		Weight max_weight; // Maximum weight at or below this node, if has_max_weight
+		bool end;
+		bool has_max_weight; // Whether there are words at or below this node
+
+		static constexpr Weight no_weight = is_signed<Weight>::value ? Weight(-1) : Weight(0); // Weight of a non-word
+
+		void update_max_weight(void);
+
+		void refresh_max_weight(Weight, bool);
+
+		bool place(const string, Weight, bool);
+
+		const BasicNode * find(const string) const;
+
+	public:
+		// Static functions
+
+		static double get_max_weight(const BasicNode *);
+
+		static void set_max_weight(BasicNode *, double);
+
+		static void remove_max_weight(BasicNode *);
+
+		// Constructors
+
+		BasicNode(void);
+
+		BasicNode(bool);
+
+		BasicNode(bool, Weight);
+
+		BasicNode(const BasicNode &);
+
+		// Getters
+
+		bool is_end(void) const;
+
+		/* Getter function to retrieve weight at a node. */
+		Weight get_weight(void) const;
+
+		int num_children(void) const;
+
+		BasicNode * get_child(char) const;
+
+		map<char, BasicNode *> get_children(void) const;
+
+		/* Calls f(character, child) for each child, in alphabetical order, without copying them out as get_children
+		 * does. */
+		template <class F>
+		void for_each_child(F f) const { this->children.for_each(f); }
+
+		bool contains_key(char) const;
+
+		size_t heap_bytes(void) const;
+
+		// Setters
+
+		void set_child(char, BasicNode *);
+
+		void set_end(bool);
+
+		void set_weight(Weight);
+
+		// Functionality
+
+		bool insert(const string word, Weight);
+
+		bool contains(const string word) const;
+
+		bool remove(const string word);
+
+		/* Function to recursively get weight in trie below this node. */
+		double get_weight(const string word) const;
+
+		void set_weight(const string, Weight);
+
+		void update_weight(const string, Weight (*)(Weight));
+
+		// Other
+
+		BasicNode & operator =(const BasicNode &);
+
+		void swap(BasicNode &);
+
+		~BasicNode(void);
+};
+
+typedef BasicNode<> Node;
+
+template <class Alphabet, class Weight>
+ostream& operator <<(ostream &, const BasicNode<Alphabet, Weight> &);
+
+/* Ways of answering Trie::autocorrect. AUTOMATIC uses the deletion index, if one has been built, for the queries it
+ * answers faster than the trie walk, and the trie walk otherwise. */
+enum AutocorrectEngine {AUTOMATIC, TRIE_WALK, DELETION_INDEX};
+
+/* A weighted dictionary over the given alphabet policy and weight type. Trie, over any byte with double weights, is the
+ * one the rest of the code uses; the others trade generality for smaller nodes found by direct index, and weights of the
+ * given type, though queries still take and return weights as doubles, and a weight the type can't hold is rejected.
+ * Decay needs floating point weights. Only the instantiations listed at the end of trie.cpp are compiled. */
+template <class Alphabet = ByteAlphabet, class Weight = double>
+class BasicTrie {
+	public:
+		typedef BasicNode<Alphabet, Weight> Node;
+
+	private:
+		static const int deletion_index_max_variants = 512; // Most deletion variants for which AUTOMATIC uses the index
+
+		unique_ptr<DeletionIndex> deletion_index; // NULL unless build_deletion_index has been called
+		unique_ptr<CountingBloomFilter> membership_filter; // NULL unless build_membership_filter has been called
+
+		static constexpr double max_decay_offset = 512; // Largest decay offset, in natural log units, before renormalizing
+
+		double decay_rate; // Natural log of the factor weights shrink by per unit of time, or 0 if they don't decay
+		double now; // Current time, for decaying weights
+		double epoch; // Time the stored log weights are relative to
+
+		vector<string> words(void) const;
+
+		static void autocorrect_helper(vector<tuple<string, double, int>> *, string, Node *, string, char, int *, int);
+
+		static vector<string> rank_suggestions_by_keyboard_proximity(const string, vector<string>);
+
+		static Weight increment_weight(Weight);
+
+		static Weight to_weight(double);
+
+		double decay_offset(void) const;
+
+		double weight_of(const Node *) const;
+
+		void renormalize(void);
+
+	public:
+		Node root; // Top of trie.
+		BasicTrie(void);
+
+		BasicTrie(const BasicTrie &);
+
+		static int levenschtein_distance(string, string);
+
+		static vector<string> rank_suggestions(const string, vector<tuple<string, double, int>>);
+
+		void build_deletion_index(int = 2);
+
+		void build_membership_filter(double = 0.01);
+
+		void enable_decay(double);
+
+		void set_time(double);
+
+		double get_time(void) const;
+
+		bool insert(const string);
+
+		bool insert(const string, double);
+
+		void insert_from_file(const string, bool = false, const char * = " \n\t");
+
+		void insert_from_raw_text(const string);
+
+		void record(const string, double = 1);
+
+		bool contains(const string) const;
+
+		bool remove(const string);
+
+		double get_weight(const string) const;
+
+		vector<string> autocomplete(const string, int) const;
+
+		vector<string> autocorrect(const string, int, AutocorrectEngine = AUTOMATIC) const;
+
+		vector<tuple<string, int, double>> fuzzy_autocomplete(const string, int, int) const;
+
+		// Persistence
+
+		void write(ModelWriter *) const;
+
+		void read(ModelReader *);
+
+		void save(const string) const;
+
+		void load(const string);
+
+		// Other
+
+		BasicTrie & operator =(const BasicTrie &);
+};
+
+typedef BasicTrie<> Trie;
+
 #endif
\ No newline at end of file
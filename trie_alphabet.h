@@ -0,0 +1,173 @@
+#ifndef TRIE_ALPHABET_H
+#define TRIE_ALPHABET_H
+
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+using namespace std;
+
+/* Alphabet policies for BasicTrie. Each gives the number of symbols, and constexpr maps between characters and symbol
+ * indices, which must keep characters in the order a map<char, ...> sorts them so that every alphabet lists children
+ * alike. index returns -1 for a character outside the alphabet. */
+
+/* Any byte. The default, whose nodes keep their children in a map as they always have. */
+struct ByteAlphabet {
+	static constexpr int size = 256;
+
+	static constexpr int index(char c) { return (int) c + 128; }
+
+	static constexpr char symbol(int i) { return (char) (i - 128); }
+};
+
+/* 7-bit ASCII. */
+struct AsciiAlphabet {
+	static constexpr int size = 128;
+
+	static constexpr int index(char c) { return c >= 0 ? c : -1; }
+
+	static constexpr char symbol(int i) { return (char) i; }
+};
+
+/* Lowercase letters a to z. */
+struct LowercaseAlphabet {
+	static constexpr int size = 26;
+
+	static constexpr int index(char c) { return c >= 'a' && c <= 'z' ? c - 'a' : -1; }
+
+	static constexpr char symbol(int i) { return (char) ('a' + i); }
+};
+
+/* Children of a node over a large alphabet, kept in a map from character to child. */
+template <class Alphabet, class Child>
+class MapChildren {
+	private:
+		map<char, Child *> children;
+
+	public:
+		Child * get(char c) const {
+			auto it = this->children.find(c);
+			return it != this->children.end() ? it->second : NULL;
+		}
+
+		void set(char c, Child *child) { this->children[c] = child; }
+
+		void erase(char c) { this->children.erase(c); }
+
+		size_t size(void) const { return this->children.size(); }
+
+		/* Calls f(character, child) for each child, in alphabetical order. */
+		template <class F>
+		void for_each(F f) const {
+			for (auto const &it : this->children) {
+				f(it.first, it.second);
+			}
+		}
+
+		/* Estimates the heap bytes taken, at a std::map entry per child. */
+		size_t heap_bytes(void) const { return this->children.size() * (32 + 16 + 16); }
+
+		void swap(MapChildren &other) { this->children.swap(other.children); }
+};
+
+/* Children of a node over a small alphabet, found by direct index: a bitmap of the symbols present, and an array of the
+ * children in symbol order, where a child's slot is the number of symbols present before its own. Lookup is a mask and a
+ * popcount per 64 symbols, and a node takes a pointer and the bitmap rather than a map. The array is resized on every
+ * insertion or removal of a child, which suits tries built once and queried often. */
+template <class Alphabet, class Child>
+class RankedChildren {
+	private:
+		static constexpr int num_words = (Alphabet::size + 63) / 64;
+
+		uint64_t present[num_words];
+		Child **slots;
+		uint16_t count;
+
+		int rank(int i) const {
+			int ret = 0;
+			for (int w = 0; w < i / 64; ++w) {
+				ret += __builtin_popcountll(this->present[w]);
+			}
+			return ret + __builtin_popcountll(this->present[i / 64] & ((1ULL << (i % 64)) - 1));
+		}
+
+		bool has(int i) const { return i >= 0 && (this->present[i / 64] >> (i % 64)) & 1; }
+
+	public:
+		RankedChildren(void) : slots(NULL), count(0) { memset(this->present, 0, sizeof(this->present)); }
+
+		RankedChildren(const RankedChildren &) = delete;
+
+		RankedChildren & operator =(const RankedChildren &) = delete;
+
+		~RankedChildren(void) { delete[] this->slots; }
+
+		Child * get(char c) const {
+			int i = Alphabet::index(c);
+			return this->has(i) ? this->slots[this->rank(i)] : NULL;
+		}
+
+		/* Sets the child for a character, which must be in the alphabet. */
+		void set(char c, Child *child) {
+			int i = Alphabet::index(c), r = this->rank(i);
+			if (this->has(i)) {
+				this->slots[r] = child;
+				return;
+			}
+
+			Child **slots = new Child *[this->count + 1];
+			copy(this->slots, this->slots + r, slots);
+			slots[r] = child;
+			copy(this->slots + r, this->slots + this->count, slots + r + 1);
+			delete[] this->slots;
+			this->slots = slots;
+			++this->count;
+			this->present[i / 64] |= 1ULL << (i % 64);
+		}
+
+		void erase(char c) {
+			int i = Alphabet::index(c);
+			if (!this->has(i)) {
+				return;
+			}
+
+			int r = this->rank(i);
+			copy(this->slots + r + 1, this->slots + this->count, this->slots + r);
+			--this->count;
+			this->present[i / 64] &= ~(1ULL << (i % 64));
+			if (this->count == 0) {
+				delete[] this->slots;
+				this->slots = NULL;
+			}
+		}
+
+		size_t size(void) const { return this->count; }
+
+		/* Calls f(character, child) for each child, in alphabetical order. */
+		template <class F>
+		void for_each(F f) const {
+			int k = 0;
+			for (int w = 0; w < num_words; ++w) {
+				for (uint64_t bits = this->present[w]; bits != 0; bits &= bits - 1) {
+					f(Alphabet::symbol(w * 64 + __builtin_ctzll(bits)), this->slots[k++]);
+				}
+			}
+		}
+
+		/* Estimates the heap bytes taken by the array of children and its allocation. */
+		size_t heap_bytes(void) const { return this->count > 0 ? this->count * sizeof(Child *) + 16 : 0; }
+
+		void swap(RankedChildren &other) {
+			std::swap(this->present, other.present);
+			std::swap(this->slots, other.slots);
+			std::swap(this->count, other.count);
+		}
+};
+
+/* The children container for nodes over the given alphabet: RankedChildren up to 128 symbols, MapChildren beyond. */
+template <class Alphabet, class Child>
+using ChildrenFor = typename conditional<(Alphabet::size <= 128), RankedChildren<Alphabet, Child>, MapChildren<Alphabet, Child>>::type;
+
+#endif
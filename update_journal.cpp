@@ -0,0 +1,520 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "update_journal.h"
+#include "model_file.h"
+
+using namespace std;
+
+static string error_message(const string what) { return what + ": " + strerror(errno); }
+
+/* Integers are written byte by byte, so the format is little-endian whatever the host. */
+static void put(string *out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; ++i) {
+		out->push_back((char) (value >> (8 * i)));
+	}
+}
+
+static void put_double(string *out, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put(out, bits, 8);
+}
+
+static void put_string(string *out, const string &s) {
+	put(out, s.length(), 4);
+	out->append(s);
+}
+
+/* Reads the fields of one record's body, throwing if they run past its end. */
+class RecordReader {
+	private:
+		const unsigned char *position, *end;
+
+		void check(size_t n) const {
+			if ((size_t) (this->end - this->position) < n) {
+				throw runtime_error("Malformed journal record: fields run past its end");
+			}
+		}
+
+	public:
+		RecordReader(const char *body, size_t size) : position((const unsigned char *) body), end(position + size) {}
+
+		uint64_t get(int bytes) {
+			this->check(bytes);
+			uint64_t value = 0;
+			for (int i = 0; i < bytes; ++i) {
+				value |= (uint64_t) this->position[i] << (8 * i);
+			}
+			this->position += bytes;
+			return value;
+		}
+
+		double get_double(void) {
+			uint64_t bits = this->get(8);
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		string get_string(void) {
+			size_t length = this->get(4);
+			this->check(length);
+			string ret ((const char *) this->position, length);
+			this->position += length;
+			return ret;
+		}
+
+		bool at_end(void) const { return this->position == this->end; }
+};
+
+/* Makes the creation, renaming or removal of files in the given directory durable. */
+static void sync_directory(const string directory) {
+	int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0 || fsync(fd) != 0) {
+		string message = error_message("Unable to sync directory '" + directory + "'");
+		if (fd >= 0) {
+			close(fd);
+		}
+		throw runtime_error(message);
+	}
+	close(fd);
+}
+
+/* Begin UpdateJournal class. */
+
+/* Opens the journal in the given directory, creating it if need be, and brings the trie and model up to date with it:
+ * they are replaced by the snapshot there and the records after it replayed. A directory without a snapshot starts with
+ * one of the trie and model as given. Compaction starts by itself once the current segment passes compact_after bytes. */
+UpdateJournal::UpdateJournal(const string directory, Trie *trie, NgramModel *model /* = NULL */,
+	size_t compact_after /* = default_compact_after */)
+	: directory(directory), trie(trie), model(model), compact_after(compact_after), next_sequence(1), durable_sequence(0),
+	  flushing(false), segment(-1), segment_bytes(0), num_syncs(0), compacting(false) {
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		throw runtime_error(error_message("Unable to create journal directory '" + directory + "'"));
+	}
+
+	uint64_t folded = 0;
+	if (model_file_exists(this->snapshot_path())) {
+		folded = this->load_snapshot(trie, model);
+	} else {
+		this->save_snapshot(0, *trie, model);
+	}
+
+	uint64_t last = folded;
+	vector<pair<uint64_t, string>> segments = this->segments();
+	for (size_t i = 0; i < segments.size(); ++i) {
+		last = max(last, replay(segments[i].second, folded, trie, model, i + 1 == segments.size()));
+	}
+
+	this->next_sequence = last + 1;
+	this->durable_sequence = last;
+	this->open_segment(this->next_sequence);
+}
+
+string UpdateJournal::snapshot_path(void) const { return this->directory + "/snapshot"; }
+
+string UpdateJournal::segment_path(uint64_t first_sequence) const {
+	return this->directory + "/journal-" + to_string(first_sequence) + ".log";
+}
+
+/* Private helper function. Returns the segments in the directory, with the first sequence number of each, in order. */
+vector<pair<uint64_t, string>> UpdateJournal::segments(void) const {
+	vector<pair<uint64_t, string>> ret;
+	DIR *dir = opendir(this->directory.c_str());
+	if (dir == NULL) {
+		throw runtime_error(error_message("Unable to list journal directory '" + this->directory + "'"));
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		string name = entry->d_name;
+		if (name.compare(0, 8, "journal-") == 0) {
+			uint64_t first = strtoull(name.c_str() + 8, NULL, 10);
+			if (name == "journal-" + to_string(first) + ".log") {
+				ret.push_back(make_pair(first, this->directory + "/" + name));
+			}
+		}
+	}
+	closedir(dir);
+
+	sort(ret.begin(), ret.end());
+	return ret;
+}
+
+/* Private helper function. Makes the segment starting at the given sequence number the one appended to. */
+void UpdateJournal::open_segment(uint64_t first_sequence) {
+	string path = this->segment_path(first_sequence);
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		throw runtime_error(error_message("Unable to open journal segment '" + path + "'"));
+	}
+	sync_directory(this->directory);
+
+	if (this->segment >= 0) {
+		close(this->segment);
+	}
+	this->segment = fd;
+	this->segment_bytes = lseek(fd, 0, SEEK_END);
+}
+
+uint64_t UpdateJournal::get_last_sequence(void) {
+	lock_guard<mutex> guard (this->lock);
+	return this->next_sequence - 1;
+}
+
+uint64_t UpdateJournal::get_num_syncs(void) {
+	lock_guard<mutex> guard (this->lock);
+	return this->num_syncs;
+}
+
+size_t UpdateJournal::get_segment_bytes(void) {
+	lock_guard<mutex> guard (this->lock);
+	return this->segment_bytes;
+}
+
+bool UpdateJournal::is_compacting(void) const { return this->compacting; }
+
+/* Private helper function. Appends a record of the given change, a record type followed by its fields, and returns its
+ * sequence number. Starts compaction if the segment has grown past compact_after. */
+uint64_t UpdateJournal::append(const string &change) {
+	uint64_t sequence;
+	bool start_compaction;
+	{
+		lock_guard<mutex> guard (this->lock);
+		sequence = this->next_sequence++;
+		string body;
+		put(&body, sequence, 8);
+		body.append(change);
+		put(&this->pending, body.length(), 4);
+		put(&this->pending, crc32c(body.data(), body.length()), 4);
+		this->pending.append(body);
+		this->segment_bytes += 8 + body.length();
+		start_compaction = this->segment_bytes > this->compact_after && !this->compacting;
+	}
+
+	if (start_compaction) {
+		this->compact();
+	}
+	return sequence;
+}
+
+/* Private helper function. Writes and syncs the pending records, with the lock released meanwhile so that others can
+ * keep appending. Called with the lock held and no other thread flushing. */
+void UpdateJournal::write_pending(unique_lock<mutex> *guard) {
+	string batch;
+	batch.swap(this->pending);
+	uint64_t last = this->next_sequence - 1;
+	int fd = this->segment;
+	this->flushing = true;
+	guard->unlock();
+
+	string failure;
+	for (size_t written = 0; failure.empty() && written < batch.length();) {
+		ssize_t n = write(fd, batch.data() + written, batch.length() - written);
+		if (n >= 0) {
+			written += n;
+		} else if (errno != EINTR) {
+			failure = error_message("Unable to write journal");
+		}
+	}
+	if (failure.empty() && fdatasync(fd) != 0) {
+		failure = error_message("Unable to sync journal");
+	}
+
+	guard->lock();
+	this->flushing = false;
+	if (failure.empty()) {
+		this->durable_sequence = max(this->durable_sequence, last);
+		++this->num_syncs;
+	}
+	this->synced.notify_all();
+	if (!failure.empty()) {
+		throw runtime_error(failure);
+	}
+}
+
+/* Inserts the word-weight pair into the trie, as Trie::insert does, and returns the sequence number of its record. */
+uint64_t UpdateJournal::insert(const string word, double weight) {
+	this->trie->insert(word, weight);
+	string change (1, (char) JOURNAL_INSERT);
+	put_string(&change, word);
+	put_double(&change, weight);
+	return this->append(change);
+}
+
+/* Removes the word from the trie, and returns the sequence number of its record, or of the last record if the word
+ * wasn't there and nothing was recorded. */
+uint64_t UpdateJournal::remove(const string word) {
+	if (!this->trie->remove(word)) {
+		return this->get_last_sequence();
+	}
+
+	string change (1, (char) JOURNAL_REMOVE);
+	put_string(&change, word);
+	return this->append(change);
+}
+
+/* Records occurrences of the word, as Trie::record does, and returns the sequence number of its record. */
+uint64_t UpdateJournal::record(const string word, double amount /* = 1 */) {
+	this->trie->record(word, amount);
+	string change (1, (char) JOURNAL_RECORD);
+	put_string(&change, word);
+	put_double(&change, amount);
+	return this->append(change);
+}
+
+uint64_t UpdateJournal::set_time(double time) {
+	this->trie->set_time(time);
+	string change (1, (char) JOURNAL_SET_TIME);
+	put_double(&change, time);
+	return this->append(change);
+}
+
+uint64_t UpdateJournal::enable_decay(double half_life) {
+	this->trie->enable_decay(half_life);
+	string change (1, (char) JOURNAL_ENABLE_DECAY);
+	put_double(&change, half_life);
+	return this->append(change);
+}
+
+/* Counts an occurrence of the n-gram in the model, as NgramModel::update_counts does, and returns the sequence number
+ * of its record. */
+uint64_t UpdateJournal::update_counts(const Ngram gram) {
+	if (this->model == NULL) {
+		throw runtime_error("Journal has no n-gram model");
+	}
+
+	this->model->update_counts(gram);
+	string change (1, (char) JOURNAL_NGRAM);
+	vector<string> words = gram.get_words();
+	put(&change, words.size(), 4);
+	for (const string &word : words) {
+		put_string(&change, word);
+	}
+	return this->append(change);
+}
+
+/* Returns once the records up to the given sequence number are on disk. If none is writing, this thread writes every
+ * record appended so far with one sync; otherwise it waits for the writing thread, whose sync may cover it. */
+void UpdateJournal::sync(uint64_t sequence) {
+	unique_lock<mutex> guard (this->lock);
+	sequence = min(sequence, this->next_sequence - 1);
+	while (this->durable_sequence < sequence) {
+		if (this->flushing) {
+			this->synced.wait(guard);
+		} else {
+			this->write_pending(&guard);
+		}
+	}
+}
+
+/* Returns once every record appended so far is on disk. */
+void UpdateJournal::sync(void) { this->sync(this->get_last_sequence()); }
+
+/* Starts folding the journal into a new snapshot on a background thread, unless that is already under way. The current
+ * segment is written out and a new one started, so that changes carry on while the old ones are folded. */
+void UpdateJournal::compact(void) {
+	if (this->compacting.exchange(true)) {
+		return;
+	}
+	if (this->compactor.joinable()) {
+		this->compactor.join();
+	}
+
+	vector<string> paths;
+	uint64_t last;
+	try {
+		unique_lock<mutex> guard (this->lock);
+		while (this->flushing || !this->pending.empty()) {
+			if (this->flushing) {
+				this->synced.wait(guard);
+			} else {
+				this->write_pending(&guard);
+			}
+		}
+
+		/* Fold every segment but the next one, which may already exist, empty, if nothing was appended since it started. */
+		for (const pair<uint64_t, string> &segment : this->segments()) {
+			if (segment.first != this->next_sequence) {
+				paths.push_back(segment.second);
+			}
+		}
+		last = this->next_sequence - 1;
+		this->open_segment(this->next_sequence);
+	} catch (const exception &e) {
+		this->compacting = false;
+		throw;
+	}
+
+	this->compactor = thread(&UpdateJournal::fold, this, last, paths);
+}
+
+/* Private helper function. Body of the compactor thread: builds the trie and model from the snapshot and the given
+ * segments, which hold the records up to the given sequence number, saves them as the new snapshot and deletes the
+ * segments. On failure the old snapshot and segments are left in place, so nothing is lost. */
+void UpdateJournal::fold(uint64_t last_sequence, vector<string> paths) {
+	try {
+		Trie trie;
+		NgramModel model (this->model != NULL ? this->model->get_n() : 1);
+		NgramModel *folded_model = this->model != NULL ? &model : NULL;
+
+		uint64_t folded = this->load_snapshot(&trie, folded_model);
+		for (const string &path : paths) {
+			replay(path, folded, &trie, folded_model, false);
+		}
+		this->save_snapshot(last_sequence, trie, folded_model);
+
+		for (const string &path : paths) {
+			unlink(path.c_str());
+		}
+		sync_directory(this->directory);
+	} catch (const exception &e) {
+		cerr << "Journal compaction failed: " << e.what() << endl;
+	}
+
+	this->compacting = false;
+}
+
+/* Returns once any compaction under way has finished. */
+void UpdateJournal::wait_for_compaction(void) {
+	if (this->compactor.joinable()) {
+		this->compactor.join();
+	}
+}
+
+/* Private helper function. Saves the trie and model as the snapshot, holding the records up to the given sequence
+ * number, and makes it durable. */
+void UpdateJournal::save_snapshot(uint64_t sequence, const Trie &trie, const NgramModel *model) const {
+	ModelWriter writer (JOURNAL_SNAPSHOT_MODEL);
+	writer.write(sequence);
+	writer.write((uint8_t) (model != NULL));
+	trie.write(&writer);
+	if (model != NULL) {
+		model->write(&writer);
+	}
+	writer.save(this->snapshot_path());
+	sync_directory(this->directory);
+}
+
+/* Private helper function. Replaces the trie and model with those of the snapshot, leaving the model alone if the
+ * snapshot has none, and returns the sequence number of the last record folded into it. */
+uint64_t UpdateJournal::load_snapshot(Trie *trie, NgramModel *model) const {
+	ModelReader reader (this->snapshot_path(), JOURNAL_SNAPSHOT_MODEL);
+	uint64_t sequence = reader.read<uint64_t>();
+	bool has_model = reader.read<uint8_t>() != 0;
+	trie->read(&reader);
+	if (has_model && model != NULL) {
+		model->read(&reader);
+	}
+
+	return sequence;
+}
+
+/* Static function. Applies the records of the given segment with sequence numbers above after to the trie and model,
+ * and returns the last sequence number in it, or after if it holds none above. A torn or corrupt record throws, unless
+ * the segment is the last, which is then cut short before it. */
+uint64_t UpdateJournal::replay(const string path, uint64_t after, Trie *trie, NgramModel *model, bool last) {
+	ifstream file (path, ios::binary);
+	if (!file) {
+		throw runtime_error("Unable to open journal segment '" + path + "'");
+	}
+	stringstream buffer;
+	buffer << file.rdbuf();
+	string contents = buffer.str();
+
+	uint64_t ret = after;
+	size_t position = 0;
+	while (position < contents.length()) {
+		size_t available = contents.length() - position;
+		bool whole = false;
+		if (available >= 8) {
+			RecordReader header (contents.data() + position, 8);
+			size_t size = header.get(4);
+			uint32_t checksum = header.get(4);
+			whole = size >= 9 && size <= available - 8 && crc32c(contents.data() + position + 8, size) == checksum;
+			if (whole) {
+				const char *body = contents.data() + position + 8;
+				uint64_t sequence = RecordReader(body, 8).get(8);
+				if (sequence > after) {
+					apply(body + 8, size - 8, trie, model);
+				}
+				ret = max(ret, sequence);
+				position += 8 + size;
+			}
+		}
+
+		if (!whole) {
+			if (!last) {
+				throw runtime_error("Journal segment '" + path + "' is corrupt at byte " + to_string(position));
+			}
+			if (truncate(path.c_str(), position) != 0) {
+				throw runtime_error(error_message("Unable to cut short journal segment '" + path + "'"));
+			}
+			break;
+		}
+	}
+
+	return ret;
+}
+
+/* Static function. Applies the change in a record's body, past its sequence number, to the trie and model. */
+void UpdateJournal::apply(const char *change, size_t size, Trie *trie, NgramModel *model) {
+	RecordReader reader (change, size);
+	uint8_t type = reader.get(1);
+	if (type == JOURNAL_INSERT) {
+		string word = reader.get_string();
+		trie->insert(word, reader.get_double());
+	} else if (type == JOURNAL_REMOVE) {
+		trie->remove(reader.get_string());
+	} else if (type == JOURNAL_RECORD) {
+		string word = reader.get_string();
+		trie->record(word, reader.get_double());
+	} else if (type == JOURNAL_SET_TIME) {
+		trie->set_time(reader.get_double());
+	} else if (type == JOURNAL_ENABLE_DECAY) {
+		trie->enable_decay(reader.get_double());
+	} else if (type == JOURNAL_NGRAM) {
+		if (model == NULL) {
+			throw runtime_error("Journal holds n-gram updates, but no n-gram model was given");
+		}
+		size_t n = reader.get(4);
+		vector<string> words;
+		for (size_t i = 0; i < n; ++i) {
+			words.push_back(reader.get_string());
+		}
+		model->update_counts(Ngram(n, words));
+	} else {
+		throw runtime_error("Malformed journal record: unknown type " + to_string(type));
+	}
+
+	if (!reader.at_end()) {
+		throw runtime_error("Malformed journal record: trailing bytes");
+	}
+}
+
+/* Waits for any compaction, and writes out the records not yet on disk. */
+UpdateJournal::~UpdateJournal(void) {
+	this->wait_for_compaction();
+	try {
+		this->sync();
+	} catch (const exception &e) {
+		cerr << "Journal sync failed: " << e.what() << endl;
+	}
+	close(this->segment);
+}
+
+/* End UpdateJournal class. */
@@ -0,0 +1,135 @@
+#ifndef UPDATE_JOURNAL_H
+#define UPDATE_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "trie.h"
+#include "ngram.h"
+
+using namespace std;
+
+/* Write-ahead journal of the changes made to a Trie and, optionally, an NgramModel, kept in a directory beside a snapshot
+ * of both. Changes go through the journal, which applies them and appends a record of each; sync makes the records up to
+ * a given one durable. Records are buffered and written by whichever thread syncs first, with one fdatasync covering
+ * every record appended before it, so concurrent writers waiting on sync share their syncs (group commit).
+ *
+ * The directory holds a snapshot file, a model file of kind JOURNAL_SNAPSHOT_MODEL holding the sequence number of the
+ * last record folded into it, the trie and the model, and journal segments named journal-<first sequence number>.log.
+ * A segment is a run of records, each
+ *     size       uint32   body length in bytes
+ *     checksum   uint32   CRC-32C of the body
+ *     body       sequence number (uint64), type (uint8, a JournalRecordType) and the change's fields
+ * where strings are a uint32 length followed by their bytes, and all numbers are little-endian. On opening, the
+ * snapshot is loaded and the records after it replayed; a torn or corrupt record ends the last segment, which is cut
+ * short there, since it can only be one whose sync never returned.
+ *
+ * compact folds the journal into a new snapshot on a background thread without touching the live trie: it starts a new
+ * segment for the changes that follow, rebuilds the trie and model from the old snapshot and segments on its own, saves
+ * the new snapshot and then deletes the segments it folded. It runs by itself once the current segment passes a given
+ * size, so that opening takes at most a snapshot load and a segment's replay.
+ *
+ * Changes must be made from one thread at a time, or under the caller's lock, as the trie and model themselves require;
+ * sync may be called from any thread. */
+
+enum JournalRecordType : uint8_t {
+	JOURNAL_INSERT = 1, JOURNAL_REMOVE = 2, JOURNAL_RECORD = 3, JOURNAL_SET_TIME = 4, JOURNAL_ENABLE_DECAY = 5,
+	JOURNAL_NGRAM = 6
+};
+
+class UpdateJournal {
+	private:
+		static constexpr size_t default_compact_after = 64 << 20; // Segment size past which compaction starts by itself
+
+		string directory;
+		Trie *trie;
+		NgramModel *model;
+		size_t compact_after;
+
+		mutex lock; // Guards the members below
+		condition_variable synced; // Notified whenever a sync ends
+		string pending; // Records appended but not yet written
+		uint64_t next_sequence; // Sequence number of the next record
+		uint64_t durable_sequence; // Every record up to this one is on disk
+		bool flushing; // Whether a thread is writing and syncing pending records
+		int segment; // Descriptor of the segment being appended to
+		size_t segment_bytes; // Size of that segment, counting pending records
+		uint64_t num_syncs;
+
+		thread compactor;
+		atomic<bool> compacting;
+
+		string snapshot_path(void) const;
+
+		string segment_path(uint64_t) const;
+
+		vector<pair<uint64_t, string>> segments(void) const;
+
+		void open_segment(uint64_t);
+
+		uint64_t append(const string &);
+
+		void write_pending(unique_lock<mutex> *);
+
+		void fold(uint64_t, vector<string>);
+
+		void save_snapshot(uint64_t, const Trie &, const NgramModel *) const;
+
+		uint64_t load_snapshot(Trie *, NgramModel *) const;
+
+		static uint64_t replay(const string, uint64_t, Trie *, NgramModel *, bool);
+
+		static void apply(const char *, size_t, Trie *, NgramModel *);
+
+	public:
+		// Constructors
+
+		UpdateJournal(const string, Trie *, NgramModel * = NULL, size_t = default_compact_after);
+
+		UpdateJournal(const UpdateJournal &) = delete;
+
+		// Getters
+
+		uint64_t get_last_sequence(void);
+
+		uint64_t get_num_syncs(void);
+
+		size_t get_segment_bytes(void);
+
+		bool is_compacting(void) const;
+
+		// Functionality
+
+		uint64_t insert(const string, double);
+
+		uint64_t remove(const string);
+
+		uint64_t record(const string, double = 1);
+
+		uint64_t set_time(double);
+
+		uint64_t enable_decay(double);
+
+		uint64_t update_counts(const Ngram);
+
+		void sync(uint64_t);
+
+		void sync(void);
+
+		void compact(void);
+
+		void wait_for_compaction(void);
+
+		// Other
+
+		UpdateJournal & operator =(const UpdateJournal &) = delete;
+
+		~UpdateJournal(void);
+};
+
+#endif